@@ -0,0 +1,149 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mb3/platform.hpp>
+
+/// @brief Bump allocator for memory that lives until the next @ref reset,
+/// e.g. one frame. The first block is internal RAM; when it runs out, further
+/// blocks come from PSRAM (if overflow is allowed) and are kept for later
+/// frames, so a steady state allocates nothing from the heap. Not thread safe.
+class BumpArena {
+public:
+    BumpArena(size_t size, bool overflow = true) : overflow(overflow) {
+        first = current = new_chunk(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+
+    ~BumpArena() {
+        while (first) {
+            Chunk * next = first->next;
+            heap_caps_free(first);
+            first = next;
+        }
+    }
+
+    BumpArena(const BumpArena &) = delete;
+    BumpArena & operator=(const BumpArena &) = delete;
+
+    /// @return nullptr when full and overflow isn't allowed, or PSRAM is out
+    void * allocate(size_t size, size_t align = alignof(max_align_t)) {
+        if (!current)
+            return nullptr;
+        for (;;) {
+            uintptr_t base = (uintptr_t)current->data();
+            size_t start = ((base + offset + align - 1) & ~(uintptr_t)(align - 1)) - base;
+            if (start + size <= current->size) {
+                offset = start + size;
+                _used += size;
+                if (current != first)
+                    _overflowed += size;
+                if (_used > high_water)
+                    high_water = _used;
+                _allocations++;
+                return current->data() + start;
+            }
+            // on to the next block, or a new one big enough
+            if (!current->next || current->next->size < size + align) {
+                if (!overflow)
+                    return nullptr;
+                size_t bytes = size + align > first->size ? size + align : first->size;
+                Chunk * chunk = new_chunk(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+                if (!chunk)
+                    return nullptr;
+                chunk->next = current->next;
+                current->next = chunk;
+            }
+            current = current->next;
+            offset = 0;
+        }
+    }
+
+    template <typename T>
+    T * allocate() {
+        return (T*)allocate(sizeof(T), alignof(T));
+    }
+
+    /// @brief Everything allocated is gone, the blocks stay
+    void reset() {
+        current = first;
+        offset = 0;
+        _used = 0;
+        _overflowed = 0;
+        _allocations = 0;
+    }
+
+    bool owns(const void * ptr) const {
+        for (Chunk * chunk = first; chunk; chunk = chunk->next) {
+            if ((const uint8_t*)ptr >= chunk->data() && (const uint8_t*)ptr < chunk->data() + chunk->size)
+                return true;
+        }
+        return false;
+    }
+
+    /// @brief The first block, all of the arena when overflow isn't allowed
+    const uint8_t * block() const {
+        return first ? first->data() : nullptr;
+    }
+
+    size_t blockSize() const {
+        return first ? first->size : 0;
+    }
+
+    /// @brief Bytes handed out since the last reset
+    size_t used() const {
+        return _used;
+    }
+
+    /// @brief Most bytes handed out between two resets
+    size_t highWater() const {
+        return high_water;
+    }
+
+    /// @brief Bytes handed out from PSRAM since the last reset
+    size_t overflowed() const {
+        return _overflowed;
+    }
+
+    size_t allocations() const {
+        return _allocations;
+    }
+
+    /// @brief Bytes held in all blocks
+    size_t capacity() const {
+        size_t bytes = 0;
+        for (Chunk * chunk = first; chunk; chunk = chunk->next) {
+            bytes += chunk->size;
+        }
+        return bytes;
+    }
+
+private:
+    struct Chunk {
+        Chunk * next;
+        size_t size;
+
+        uint8_t * data() const {
+            return (uint8_t*)(this + 1);
+        }
+    };
+
+    static Chunk * new_chunk(size_t size, uint32_t caps) {
+        auto chunk = (Chunk*)heap_caps_malloc(sizeof(Chunk) + size, caps);
+        if (!chunk) {
+            log_e("arena: %u bytes", (unsigned)size);
+            return nullptr;
+        }
+        chunk->next = nullptr;
+        chunk->size = size;
+        return chunk;
+    }
+
+    bool overflow;
+    Chunk * first = nullptr;
+    Chunk * current = nullptr;
+    size_t offset = 0;
+    size_t _used = 0;
+    size_t _overflowed = 0;
+    size_t _allocations = 0;
+    size_t high_water = 0;
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mb3/platform.hpp>
+
+/// @brief Reusable heap buffers, matched on a key (e.g. a color format), the
+/// memory they come from (heap_caps) and a size class. A released buffer
+/// waits for the next request of its kind instead of going back to the heap;
+/// when every slot is taken, the least recently used free buffer makes room.
+/// Size classes step by a quarter of a power of two, so a buffer is never
+/// more than 25% bigger than asked for. Not thread safe.
+template <size_t Slots>
+class BufferPool {
+public:
+    BufferPool(const char * name, size_t align = 64) : _name(name), align(align) {
+    }
+
+    ~BufferPool() {
+        for (auto & slot : slots) {
+            heap_caps_free(slot.data);
+        }
+    }
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool & operator=(const BufferPool &) = delete;
+
+    /// @return a buffer of at least size bytes, nullptr if the heap is out
+    void * acquire(size_t size, uint32_t key, uint32_t caps) {
+        size_t bytes = size_class(size);
+        clock++;
+        Slot * empty = nullptr;
+        Slot * oldest = nullptr;
+        for (auto & slot : slots) {
+            if (!slot.data) {
+                empty = empty ? empty : &slot;
+                continue;
+            }
+            if (slot.lent)
+                continue;
+            if (slot.size == bytes && slot.key == key && slot.caps == caps) {
+                slot.lent = true;
+                slot.last_used = clock;
+                _hits++;
+                return slot.data;
+            }
+            if (!oldest || slot.last_used < oldest->last_used)
+                oldest = &slot;
+        }
+
+        _misses++;
+        Slot * slot = empty;
+        if (!slot && oldest) {
+            heap_caps_free(oldest->data);
+            *oldest = Slot();
+            slot = oldest;
+            _evictions++;
+        }
+        void * data = heap_caps_aligned_alloc(align, bytes, caps);
+        if (!data) {
+            log_e("%s pool: %u bytes", _name, (unsigned)bytes);
+            return nullptr;
+        }
+        if (!slot) {
+            // every slot lent out: hand out an unpooled buffer
+            _unpooled++;
+            return data;
+        }
+        *slot = {(uint8_t*)data, bytes, key, caps, clock, true};
+        return data;
+    }
+
+    /// @brief Give a buffer back for reuse, buffers from outside the pool
+    /// (handed out when it was full) are freed
+    void release(void * data) {
+        if (!data)
+            return;
+        for (auto & slot : slots) {
+            if (slot.data == data) {
+                slot.lent = false;
+                return;
+            }
+        }
+        heap_caps_free(data);
+    }
+
+    bool owns(const void * data) const {
+        for (auto & slot : slots) {
+            if (slot.data && slot.data == data)
+                return true;
+        }
+        return false;
+    }
+
+    /// @brief Free the buffers nobody is using
+    void trim() {
+        for (auto & slot : slots) {
+            if (slot.data && !slot.lent) {
+                heap_caps_free(slot.data);
+                slot = Slot();
+            }
+        }
+    }
+
+    /// @brief Bytes held, optionally only those allocated with these caps
+    size_t memory(uint32_t caps = 0) const {
+        size_t bytes = 0;
+        for (auto & slot : slots) {
+            if (slot.data && (!caps || (slot.caps & caps)))
+                bytes += slot.size;
+        }
+        return bytes;
+    }
+
+    size_t lent() const {
+        size_t count = 0;
+        for (auto & slot : slots) {
+            count += slot.data && slot.lent;
+        }
+        return count;
+    }
+
+    uint32_t hits() const {
+        return _hits;
+    }
+
+    uint32_t misses() const {
+        return _misses;
+    }
+
+    uint32_t evictions() const {
+        return _evictions;
+    }
+
+    /// @brief Buffers handed out while every slot was lent
+    uint32_t unpooled() const {
+        return _unpooled;
+    }
+
+    const char * name() const {
+        return _name;
+    }
+
+    void report() const {
+        uint32_t requests = _hits + _misses;
+        log_i("%s pool: %u/%u buffers lent, %u bytes (%u internal, %u PSRAM), %u%% hits, %u evictions, %u unpooled",
+            _name, (unsigned)lent(), (unsigned)Slots, (unsigned)memory(),
+            (unsigned)memory(MALLOC_CAP_INTERNAL), (unsigned)memory(MALLOC_CAP_SPIRAM),
+            (unsigned)(requests ? (_hits * 100) / requests : 0), (unsigned)_evictions, (unsigned)_unpooled);
+    }
+
+    /// @brief size rounded up to a quarter of its power of two
+    static size_t size_class(size_t size) {
+        if (size <= 64)
+            return 64;
+        size_t power = 1;
+        while (power <= size / 2) {
+            power <<= 1;
+        }
+        size_t step = power / 4;
+        return ((size + step - 1) / step) * step;
+    }
+
+private:
+    struct Slot {
+        uint8_t * data = nullptr;
+        size_t size = 0;
+        uint32_t key = 0;
+        uint32_t caps = 0;
+        uint32_t last_used = 0;
+        bool lent = false;
+    };
+
+    const char * _name;
+    size_t align;
+    Slot slots[Slots];
+    uint32_t clock = 0;
+    uint32_t _hits = 0;
+    uint32_t _misses = 0;
+    uint32_t _evictions = 0;
+    uint32_t _unpooled = 0;
+};
@@ -4,12 +4,12 @@
 #include <vector>
 #include <map>
 #include <memory>
-#include <esp_heap_caps.h>
-#include <esp32-hal-log.h>
+#include <mb3/platform.hpp>
 #include <string>
 #include <functional>
 #include <cmath>
 #include <mb3/updatable.hpp>
+#include <mb3/subscription.hpp>
 #include <cxxabi.h>
 
 #define BYTE_CEILING(b) (((b - 1) / 8) + 1)
@@ -24,7 +24,7 @@ public:
 };
 
 /// @brief The base CAN signal interface
-class ICanSignal {
+class ICanSignal : public Subscribable {
 public:
     ICanSignal() {}
 
@@ -58,8 +58,15 @@ public:
     virtual operator SignalType() = 0;
 };
 
+/// @brief Reads the scaled value of a signal passed to @ref ICanFrame::each_signal
+using CanSignalReader = float (*)(Subscribable &);
+
 class ICanFrame {
 public:
+    using SignalVisitor = std::function<void(const char * name, Subscribable & signal, CanSignalReader read)>;
+
+    virtual ~ICanFrame() = default;
+
     virtual void update() = 0;
     virtual size_t size() = 0;
     virtual uint32_t id() = 0;
@@ -67,6 +74,8 @@ public:
     virtual void members() = 0;
     virtual const std::string& name() = 0;
     virtual void update_from_member(ICanSignal&) = 0;
+    /// @brief Enumerate signals by their name within the frame
+    virtual void each_signal(const SignalVisitor & visit) { }
 };
 
 /// @brief A CAN frame base class
@@ -75,7 +84,12 @@ template<typename FrameType>
 class CanFrame : public ICanFrame {
     using CanFrameCallbackType = std::function<void(FrameType&)>;
 protected:
-    static inline std::vector<std::shared_ptr<ICanSignal>> __members;
+    /// @brief The frame whose signals are being constructed: signals are
+    /// members, built right after this base, and register with it. Frames
+    /// are built one at a time (setup, UI task).
+    static inline CanFrame * constructing = nullptr;
+
+    std::vector<ICanSignal *> __members;
 
     size_t _size = 0;
     uint32_t _id = 0xFFFFFFFF;
@@ -103,7 +117,11 @@ public:
             _offset(offset) 
         {
             // FrameType::CanSignal?
-            __members.push_back(std::shared_ptr<CanSignal>(this));
+            // signals are members of the frame under construction, which owns them
+            if (constructing)
+                constructing->__members.push_back(this);
+            else
+                log_e("CanSignal outside of a CanFrame");
             _raw = (uint8_t*)heap_caps_calloc(1, BYTE_CEILING(size), MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
             // _raw = (uint8_t*)heap_caps_calloc(1, BYTE_CEILING(size), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
             if (_raw == nullptr) {
@@ -116,11 +134,12 @@ public:
         //     name = str;
         // }
 
-        // ~CanSignal() {
-        //     if (_raw) {
-        //         free(_raw);
-        //     }
-        // }
+        ~CanSignal() {
+            heap_caps_free(_raw);
+        }
+
+        CanSignal(const CanSignal &) = delete;
+        CanSignal & operator=(const CanSignal &) = delete;
 
         /// @brief size in bits
         virtual size_t size() {
@@ -212,6 +231,7 @@ public:
                 for (auto const & callback : callbacks) {
                     callback(*this);
                 }
+                notify();
             }
         }
 
@@ -227,17 +247,51 @@ public:
 
     CanFrame(const std::string& str, uint32_t id) : _id(id), _name(str)  {
         // log("CanFrame()");
+        constructing = this;
     }
 
-    inline std::shared_ptr<ICanFrame> init() {
+    virtual ~CanFrame() {
+        // log("~CanFrame()");
+        if (constructing == this)
+            constructing = nullptr;
+        heap_caps_free(_data);
+    }
+
+    CanFrame(const CanFrame &) = delete;
+    CanFrame & operator=(const CanFrame &) = delete;
+
+    /// @brief A frame on the heap, laid out and owned by the returned pointer
+    template <typename... Args>
+    static std::shared_ptr<FrameType> create(Args &&... args) {
+        auto frame = std::make_shared<FrameType>(std::forward<Args>(args)...);
+        frame->init();
+        return frame;
+    }
+
+    /// @brief Lay out the frame for registering without handing over
+    /// ownership: whoever created it (static, member, stack or new) keeps it
+    /// alive for as long as it is registered anywhere
+    /// @return a pointer that doesn't own the frame
+    inline std::shared_ptr<ICanFrame> unowned() {
+        init();
+        return std::shared_ptr<ICanFrame>(this, [](ICanFrame *) { });
+    }
+
+    /// @brief Lay out the signals and allocate the data, once. Returns
+    /// nothing, so registering needs @ref create or @ref unowned
+    inline void init() {
         // log("init()");
+        if (constructing == this)
+            constructing = nullptr;
+        if (allocated)
+            return;
         size_t pos = 0;
-        for (auto & member : __members) {
+        for (auto member : __members) {
             member->offset = pos;
             member->parent = this;
-            static char tmp[6] = {0};
             if (member->name.empty()) {
-                sprintf(tmp, "unk%02zX", pos);
+                char tmp[8];
+                snprintf(tmp, sizeof(tmp), "unk%02zX", pos);
                 member->name = tmp;
                 // log("Naming %s", member->name.c_str());
             } else {
@@ -245,7 +299,7 @@ public:
             }
             member->name = _name + "->" + member->name;
             pos += member->size();
-            _members.emplace_back(member);
+            _members.emplace_back(member, [](ICanSignal *) { });
         }
         _size = pos;
         auto byte_size = BYTE_CEILING(_size);
@@ -262,14 +316,14 @@ public:
         else {
             log_e("Error allocating %s", _name.c_str());
         }
-        return std::shared_ptr<ICanFrame>(this);
     }
 
     virtual void update() {
-        static size_t offset;
-        static size_t byte_off;
-        static size_t bit_off;
-        static size_t mem_size;
+        // not static: frames on different buses are decoded from different tasks
+        size_t offset;
+        size_t byte_off;
+        size_t bit_off;
+        size_t mem_size;
 
         // if (BYTE_CEILING(_size) == 1) {
         //     uint8_t d = *(uint8_t*)_data;
@@ -386,14 +440,15 @@ public:
         return _name;
     }
 
+    virtual void each_signal(const SignalVisitor & visit) {
+        for (auto const & member : _members) {
+            // skip the "Frame->" prefix added by init()
+            visit(member->name.c_str() + _name.size() + 2, *member, [](Subscribable & signal) {
+                return (float)static_cast<ICanSignal &>(signal);
+            });
+        }
+    }
+
     std::vector<CanFrameCallbackType> callbacks;
     bool updated = false;
-
-private:
-    // ~CanFrame() {
-    //     // log("~CanFrame()");
-    //     if (allocated) {
-    //         free(_data);
-    //     }
-    // }
 };
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <mb3/defaults.hpp>
+#include <mb3/can_table.hpp>
+
+#if MB3_CAN_ESP_DSP
+#include <dsps_math.h>
+#endif
+
+// Kernels are plain counted loops over restrict pointers so GCC vectorises them
+// (-O2 -ftree-vectorize on x86; esp-dsp's SIMD versions on the ESP32-S3).
+// Raw values are converted as int32, the fast conversion on every target, so
+// batch signals are limited to 31 bits.
+
+/// @brief out[i] = raw[i] * scale[i] + offset[i]
+inline void can_batch_convert(const int32_t * __restrict raw, const float * __restrict scale,
+    const float * __restrict offset, float * __restrict out, size_t count)
+{
+#if MB3_CAN_ESP_DSP
+    for (size_t i = 0; i < count; i++) {
+        out[i] = (float)raw[i];
+    }
+    dsps_mul_f32(out, scale, out, count, 1, 1, 1);
+    dsps_add_f32(out, offset, out, count, 1, 1, 1);
+#else
+    for (size_t i = 0; i < count; i++) {
+        out[i] = ((float)raw[i] * scale[i]) + offset[i];
+    }
+#endif
+}
+
+/// @brief Decode one signal out of many frames' payloads, for replays and log analysis
+inline void can_batch_column(const uint64_t * __restrict payloads, size_t count,
+    const CanSignalInfo & info, float * __restrict out)
+{
+    const unsigned start = info.start;
+    const uint64_t mask = info.mask();
+#if MB3_CAN_ESP_DSP
+    for (size_t done = 0; done < count; done += 64) {
+        size_t n = count - done < 64 ? count - done : 64;
+        for (size_t i = 0; i < n; i++) {
+            out[done + i] = (float)(int32_t)((payloads[done + i] >> start) & mask);
+        }
+        dsps_mulc_f32(out + done, out + done, n, info.scale, 1, 1);
+        dsps_addc_f32(out + done, out + done, n, info.offset, 1, 1);
+    }
+#else
+    const float scale = info.scale;
+    const float offset = info.offset;
+    for (size_t i = 0; i < count; i++) {
+        out[i] = ((float)(int32_t)((payloads[i] >> start) & mask) * scale) + offset;
+    }
+#endif
+}
+
+/// @brief Decode every signal of a table out of many payloads, one column per signal
+template <size_t N>
+void can_batch_decode(const CanSignalInfo (&table)[N], const uint64_t * payloads, size_t count, float * const (&columns)[N]) {
+    for (size_t signal = 0; signal < N; signal++) {
+        can_batch_column(payloads, count, table[signal], columns[signal]);
+    }
+}
+
+/// @brief A @ref CanTableFrame that converts all its signals in one pass over
+/// struct-of-arrays buffers whenever the frame changes, so readers get
+/// precomputed values instead of converting per access.
+/// Costs 16 bytes of RAM per signal on top of @ref CanTableFrame.
+///
+///     CanBatchFrame<8> engine{"Engine", 0x100, ENGINE};
+///     TObservable<float, const float> rpm(engine.value_ptr(RPM), engine[RPM]);
+template <size_t N>
+class CanBatchFrame : public CanTableFrame<N> {
+public:
+    CanBatchFrame(const char * name, uint32_t id, const CanSignalInfo (&table)[N]) : CanTableFrame<N>(name, id, table) {
+        for (size_t i = 0; i < N; i++) {
+            if (table[i].length > 31)
+                log_e("%s->%s: batch conversion is limited to 31 bits", name, table[i].name);
+            scales[i] = table[i].scale;
+            offsets[i] = table[i].offset;
+            values[i] = table[i].offset;
+        }
+    }
+
+    float value(size_t signal) const {
+        return values[signal];
+    }
+
+    const float * value_ptr(size_t signal) const {
+        return &values[signal];
+    }
+
+    /// @brief All values, in table order
+    const float * data_values() const {
+        return values;
+    }
+
+protected:
+    virtual void on_decoded() override {
+        for (size_t i = 0; i < N; i++) {
+            raw[i] = this->signals[i].raw();
+        }
+        can_batch_convert(raw, scales, offsets, values, N);
+    }
+
+private:
+    int32_t raw[N] = {0};
+    float scales[N];
+    float offsets[N];
+    float values[N];
+};
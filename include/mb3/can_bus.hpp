@@ -0,0 +1,481 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mb3/platform.hpp>
+#include <mb3/defaults.hpp>
+#include <mb3/can.hpp>
+#include <mb3/observable.hpp>
+#if MB3_CAN_J1939
+#include <mb3/j1939.hpp>
+#endif
+
+typedef struct {
+    int64_t timestamp;
+    twai_message_t frame;
+} CanLog;
+
+/// @brief The controller behind a @ref CanBus (TWAI, SPI CAN, simulated, ...)
+/// Mirrors the twai_* calls so the TWAI implementation stays a thin wrapper.
+class ICanDriver {
+public:
+    virtual ~ICanDriver() = default;
+
+    virtual esp_err_t install() = 0;
+    virtual esp_err_t uninstall() = 0;
+    virtual esp_err_t start() = 0;
+    virtual esp_err_t stop() = 0;
+    virtual esp_err_t receive(twai_message_t & frame, uint32_t timeout_ms) = 0;
+    virtual esp_err_t transmit(const twai_message_t & frame, uint32_t timeout_ms) = 0;
+    virtual esp_err_t read_alerts(uint32_t & alerts, uint32_t timeout_ms) = 0;
+    virtual esp_err_t get_status_info(twai_status_info_t & status) = 0;
+    virtual esp_err_t initiate_recovery() = 0;
+
+    /// @brief Uninstall and reinstall the driver
+    virtual bool reset() {
+        esp_err_t res = stop();
+        if (res != ESP_OK && res != ESP_ERR_INVALID_STATE)
+            return false;
+        return uninstall() == ESP_OK && install() == ESP_OK && start() == ESP_OK;
+    }
+};
+
+/// @brief Something that sees raw frames ahead of decode, e.g. @ref CanGateway
+class ICanReceiveStage {
+public:
+    virtual ~ICanReceiveStage() = default;
+
+    /// @return false to keep the frame from being decoded on this bus
+    virtual bool process(CanLog & message) = 0;
+};
+
+/// @brief Software acceptance filter, checked before a frame is decoded
+struct CanFilter {
+    uint32_t id = 0;
+    uint32_t mask = 0;
+
+    bool matches(uint32_t identifier) const {
+        return (identifier & mask) == (id & mask);
+    }
+};
+
+/// @brief Counters for one bus. Atomic, since a @ref CanGateway transmits
+/// (and counts tx) from the source bus's task.
+struct CanBusStats {
+    std::atomic<uint32_t> rx_frames{0};
+    std::atomic<uint32_t> rx_decoded{0};
+    std::atomic<uint32_t> rx_unknown{0};
+    std::atomic<uint32_t> rx_filtered{0};
+    std::atomic<uint32_t> rx_errors{0};
+    std::atomic<uint32_t> tx_frames{0};
+    std::atomic<uint32_t> tx_failed{0};
+    std::atomic<uint32_t> soft_recoveries{0};
+    std::atomic<uint32_t> hard_resets{0};
+};
+
+/// @brief Error recovery bookkeeping for one bus
+struct CanRecoveryState {
+    static constexpr uint32_t RECOVERY_DEBOUNCE_MS = 1000; // Minimum 1 second between recoveries to handle WiFi interference
+    static constexpr uint32_t HARD_RESET_DEBOUNCE_MS = 10000; // Minimum 10 seconds between hard resets to avoid thrashing
+    static constexpr uint32_t RECOVERY_ATTEMPTS_THRESHOLD = 5; // Trigger hard reset after 5 failed soft recoveries
+    static constexpr uint32_t BUS_ERROR_THRESHOLD = 10; // Trigger recovery after 10 consecutive BUS_ERROR alerts
+
+    // Startup grace period: suppress hard resets during boot while WiFi initializes
+    // WiFi RF interference during esp_wifi_init/start causes transient BUS_ERRORs that
+    // should be handled with soft recovery only. After 30s, normal hard reset logic applies.
+    static constexpr uint32_t STARTUP_GRACE_MS = 30000;
+    static constexpr uint32_t STARTUP_LOG_RATE_MS = 3000; // Rate-limit startup error logs
+
+    // Bus idle detection: when no other nodes are active (e.g. vehicle off),
+    // the controller enters error passive with no received frames.
+    // Recovery is pointless in this state — just wait quietly for the bus to come alive.
+    static constexpr uint32_t BUS_IDLE_TIMEOUT_MS = 10000;  // 10s with no RX = idle
+    static constexpr uint32_t IDLE_LOG_INTERVAL_MS = 60000; // Log idle status once per minute
+
+    static constexpr uint32_t STATUS_LOG_INTERVAL_MS = 5000;
+
+    uint32_t last_recovery_time = 0;
+    uint32_t last_hard_reset_time = 0;
+    uint32_t recovery_attempt_count = 0;
+    uint32_t consecutive_bus_errors = 0;
+    uint32_t startup_time_ms = 0;
+    uint32_t last_startup_log_ms = 0;
+    uint32_t last_rx_time_ms = 0;
+    bool bus_idle = false;
+    uint32_t last_idle_log_ms = 0;
+    uint32_t last_status_log_ms = 0;
+};
+
+/// @brief One CAN bus: a driver, its frame registry, filters, statistics and recovery state.
+/// Nothing here is shared between buses, so each can be serviced from its own task.
+class CanBus {
+public:
+    using FrameMap = std::map<uint32_t, std::shared_ptr<ICanFrame>>;
+
+    /// @param types registry to decode into, defaults to one owned by this bus
+    CanBus(const std::string & name, FrameMap * types = nullptr) :
+        name(name),
+        types(types ? *types : own_types)
+    {
+
+    }
+
+    CanBus(const std::string & name, std::shared_ptr<ICanDriver> driver, FrameMap * types = nullptr) : CanBus(name, types) {
+        this->driver = driver;
+    }
+
+    CanBus(const CanBus &) = delete;
+    CanBus & operator=(const CanBus &) = delete;
+
+    /// @brief Register a frame with this bus, keyed on its id
+    std::shared_ptr<ICanFrame> add(std::shared_ptr<ICanFrame> frame) {
+        types[frame->id()] = frame;
+        return frame;
+    }
+
+    bool setup(uint32_t now) {
+        if (!driver) {
+            MB3_LOG_NICE("[%s] No driver", name.c_str());
+            return false;
+        }
+
+        auto res = driver->install();
+        if (res == ESP_OK) {
+            MB3_LOG_NICE("[%s] Driver installed", name.c_str());
+        } else {
+            MB3_LOG_NICE("[%s] Failed to install driver: %d", name.c_str(), res);
+            return false;
+        }
+
+        if (driver->start() == ESP_OK) {
+            MB3_LOG_NICE("[%s] Driver started", name.c_str());
+        } else {
+            MB3_LOG_NICE("[%s] Failed to start driver", name.c_str());
+            return false;
+        }
+
+#if MB3_CAN_J1939
+        j1939.transport.transmit = [this](const twai_message_t & frame) {
+            return transmit(frame, 0);
+        };
+#endif
+
+        recovery.last_status_log_ms = now;
+        recovery.startup_time_ms = now;      // Grace period starts from CAN init
+        recovery.last_hard_reset_time = now; // Treat boot as a recent hard reset so debounce starts now
+        recovery.last_rx_time_ms = now;      // Assume bus might be active at start
+        return true;
+    }
+
+    bool transmit(const twai_message_t & frame, uint32_t timeout_ms = 0) {
+        if (driver && driver->transmit(frame, timeout_ms) == ESP_OK) {
+            stats.tx_frames++;
+            return true;
+        }
+        stats.tx_failed++;
+        return false;
+    }
+
+    bool accepts(uint32_t identifier) const {
+        if (filters.empty())
+            return true;
+        for (auto const & filter : filters) {
+            if (filter.matches(identifier))
+                return true;
+        }
+        return false;
+    }
+
+    bool perform_hard_reset(uint32_t now) {
+        MB3_LOG_NICE("[%s] *** HARD RESET: Uninstalling and reinstalling driver ***", name.c_str());
+        if (!driver->reset()) {
+            MB3_LOG_NICE("[%s] Hard reset failed", name.c_str());
+            return false;
+        }
+        MB3_LOG_NICE("[%s] *** HARD RESET COMPLETE: Driver back online ***", name.c_str());
+        stats.hard_resets++;
+        recovery.recovery_attempt_count = 0;
+        recovery.last_hard_reset_time = now;
+        recovery.last_recovery_time = now;
+        return true;
+    }
+
+    /// @brief One task cycle: alerts and recovery, then drain and decode received frames
+    void service(uint32_t current_time) {
+        // Check for CAN alerts immediately on each task cycle for fast error recovery
+        // But debounce recoveries to prevent constant cycling
+        bool in_startup_grace = (current_time - recovery.startup_time_ms) < CanRecoveryState::STARTUP_GRACE_MS;
+
+        // Bus idle detection: if no frames received for a while, the bus has no active nodes
+        if (!recovery.bus_idle && !in_startup_grace && (current_time - recovery.last_rx_time_ms) > CanRecoveryState::BUS_IDLE_TIMEOUT_MS) {
+            recovery.bus_idle = true;
+            MB3_LOG_NICE("[%s] Bus idle - no frames received for %ds, suppressing recovery", name.c_str(), CanRecoveryState::BUS_IDLE_TIMEOUT_MS / 1000);
+            recovery.last_idle_log_ms = current_time;
+            recovery.recovery_attempt_count = 0;
+            recovery.consecutive_bus_errors = 0;
+        }
+
+        if (handle_alerts(current_time, in_startup_grace))
+            return;
+
+        esp_err_t res;
+        while (res = driver->receive(message.frame, 0), res == ESP_OK) {
+            hasRX = true;
+            recovery.last_rx_time_ms = current_time;
+            if (recovery.bus_idle) {
+                recovery.bus_idle = false;
+                MB3_LOG_NICE("[%s] Bus active - resuming normal operation", name.c_str());
+                recovery.recovery_attempt_count = 0;
+                recovery.consecutive_bus_errors = 0;
+            }
+            o_status.update();
+            message.timestamp = esp_timer_get_time();
+            stats.rx_frames++;
+            if (log)
+                log(&message);
+            receive(message);
+        }
+
+#if MB3_CAN_J1939
+        j1939.poll(esp_timer_get_time());
+#endif
+
+        if (res == ESP_ERR_TIMEOUT) {
+            hasRX = false;
+        } else {
+            stats.rx_errors++;
+            MB3_LOG_NICE("[%s] Receive error: %d", name.c_str(), res);
+        }
+
+        if ((current_time - recovery.last_status_log_ms) > CanRecoveryState::STATUS_LOG_INTERVAL_MS) {
+            recovery.last_status_log_ms = current_time;
+            log_status(current_time, in_startup_grace);
+        }
+    }
+
+    /// @brief Run one frame through the receive stages and decode it into this bus' registry
+    void receive(CanLog & message) {
+        for (auto const & stage : stages) {
+            if (!stage->process(message))
+                return;
+        }
+
+        if (!accepts(message.frame.identifier)) {
+            stats.rx_filtered++;
+            return;
+        }
+
+#if MB3_CAN_J1939
+        // 29-bit traffic is J1939, dispatched by PGN instead of the full identifier
+        if (message.frame.extd) {
+            if (j1939.receive(message.frame, message.timestamp))
+                stats.rx_decoded++;
+            else
+                stats.rx_unknown++;
+            return;
+        }
+#endif
+
+        auto type = types.find(message.frame.identifier);
+        if (type != types.end()) {
+            auto & can_msg_type = type->second;
+            memcpy(can_msg_type->data(), message.frame.data, can_msg_type->size());
+            can_msg_type->update();
+            stats.rx_decoded++;
+        } else {
+            stats.rx_unknown++;
+            if (log_unknown) {
+                MB3_LOG_NICE("[%s] Unknown message: %08X (%u): %02X %02X %02X %02X %02X %02X %02X %02X", name.c_str(), message.frame.identifier, message.frame.data_length_code,
+                    message.frame.data[0],
+                    message.frame.data[1],
+                    message.frame.data[2],
+                    message.frame.data[3],
+                    message.frame.data[4],
+                    message.frame.data[5],
+                    message.frame.data[6],
+                    message.frame.data[7]
+                );
+            }
+        }
+    }
+
+    std::string name;
+    std::shared_ptr<ICanDriver> driver;
+    std::vector<std::shared_ptr<ICanReceiveStage>> stages;
+    std::vector<CanFilter> filters;
+    CanBusStats stats;
+    CanRecoveryState recovery;
+
+    /// @brief Called with every received frame, before decode
+    void (*log)(CanLog * message) = nullptr;
+    bool log_unknown = true;
+
+    bool hasRX = false;
+    IObservable o_status;
+
+#if MB3_CAN_J1939
+    J1939 j1939;
+#endif
+
+private:
+    FrameMap own_types;
+
+public:
+    FrameMap & types;
+
+private:
+    CanLog message = {};
+
+    /// @return true if a hard reset happened and the cycle should end
+    bool handle_alerts(uint32_t current_time, bool in_startup_grace) {
+        uint32_t alerts_triggered;
+        if (driver->read_alerts(alerts_triggered, 0) != ESP_OK)
+            return false;
+
+        // When bus is idle, skip all recovery logic — just consume and discard alerts
+        if (recovery.bus_idle) {
+            // Still check for bus recovery (car turned on)
+            if (alerts_triggered & TWAI_ALERT_BUS_RECOVERED) {
+                MB3_LOG_NICE("[%s] Bus recovered from idle", name.c_str());
+                recovery.bus_idle = false;
+                recovery.recovery_attempt_count = 0;
+                recovery.consecutive_bus_errors = 0;
+            }
+            return false;
+        }
+
+        // During startup grace, WiFi RF causes a flood of BUS_ERRORs.
+        // Skip recovery logic — just consume alerts and read any frames that arrive.
+        if (in_startup_grace)
+            return false;
+
+        bool should_recover = false;
+        bool escalating_bus_error = false;
+        const char* recovery_reason = nullptr;
+
+        // Check for error counters maxing out (indicates driver is stuck)
+        twai_status_info_t status_check;
+        if (driver->get_status_info(status_check) == ESP_OK) {
+            if ((status_check.tx_error_counter >= 255 || status_check.rx_error_counter >= 255) &&
+                (current_time - recovery.last_hard_reset_time) > CanRecoveryState::HARD_RESET_DEBOUNCE_MS) {
+                MB3_LOG_NICE("[%s] ERROR COUNTERS MAXED (TX:%d RX:%d) - triggering hard reset", name.c_str(), status_check.tx_error_counter, status_check.rx_error_counter);
+                perform_hard_reset(current_time);
+                return true;
+            }
+        }
+
+        // Natural bus recovery resets the attempt counter
+        if (alerts_triggered & TWAI_ALERT_BUS_RECOVERED) {
+            MB3_LOG_NICE("[%s] Bus recovered naturally - resetting recovery counters", name.c_str());
+            recovery.recovery_attempt_count = 0;
+            recovery.consecutive_bus_errors = 0;
+        }
+
+        // Track repeated BUS_ERROR alerts (WiFi interference pattern)
+        if (alerts_triggered & TWAI_ALERT_BUS_ERROR) {
+            recovery.consecutive_bus_errors++;
+            if (recovery.consecutive_bus_errors >= CanRecoveryState::BUS_ERROR_THRESHOLD &&
+                (current_time - recovery.last_recovery_time) > CanRecoveryState::RECOVERY_DEBOUNCE_MS) {
+                MB3_LOG_NICE("[%s] BUS_ERROR escalating (%d consecutive) - initiating recovery", name.c_str(), recovery.consecutive_bus_errors);
+                should_recover = true;
+                escalating_bus_error = true;
+                recovery_reason = "ESCALATING_BUS_ERROR";
+                recovery.consecutive_bus_errors = 0;
+            }
+        } else {
+            recovery.consecutive_bus_errors = 0; // Reset on other alerts
+        }
+
+        // Only check for critical states that require immediate action
+        if (alerts_triggered & TWAI_ALERT_BUS_OFF) {
+            should_recover = true;
+            escalating_bus_error = false;
+            recovery_reason = "BUS_OFF";
+            recovery.consecutive_bus_errors = 0;
+        } else if (alerts_triggered & TWAI_ALERT_ERR_PASS) {
+            // Only recover if we haven't recovered recently (debouncing)
+            if (current_time - recovery.last_recovery_time > CanRecoveryState::RECOVERY_DEBOUNCE_MS) {
+                should_recover = true;
+                escalating_bus_error = false;
+                recovery_reason = "ERR_PASS";
+            }
+            recovery.consecutive_bus_errors = 0;
+        }
+
+        if (!should_recover)
+            return false;
+
+        twai_status_info_t status;
+        if (driver->get_status_info(status) != ESP_OK)
+            return false;
+
+        // For escalating BUS_ERROR from WiFi, be more aggressive - go straight to hard reset
+        if (escalating_bus_error && recovery.recovery_attempt_count >= 2 &&
+            (current_time - recovery.last_hard_reset_time) > CanRecoveryState::HARD_RESET_DEBOUNCE_MS) {
+            MB3_LOG_NICE("[%s] Escalating BUS_ERROR after %d soft attempts - triggering hard reset", name.c_str(), recovery.recovery_attempt_count);
+            perform_hard_reset(current_time);
+            return true;
+        }
+
+        if (status.state == TWAI_STATE_BUS_OFF) {
+            MB3_LOG_NICE("[%s] RECOVERY: %s - Initiating recovery from BUS_OFF (TX:%d RX:%d)", name.c_str(), recovery_reason, status.tx_error_counter, status.rx_error_counter);
+            driver->initiate_recovery();
+        } else if (status.state == TWAI_STATE_STOPPED) {
+            MB3_LOG_NICE("[%s] RECOVERY: %s - Restarting from STOPPED state", name.c_str(), recovery_reason);
+            driver->start();
+        } else if (status.state == TWAI_STATE_RECOVERING) {
+            MB3_LOG_NICE("[%s] RECOVERY: %s - Already in recovery, error counters (TX:%d RX:%d)", name.c_str(), recovery_reason, status.tx_error_counter, status.rx_error_counter);
+        } else if (status.state == TWAI_STATE_RUNNING) {
+            // Bus seems to be running but BUS_ERROR keeps triggering - this is WiFi noise
+            // Just log it but try to recover anyway
+            MB3_LOG_NICE("[%s] RECOVERY: %s - Bus running but errors detected (TX:%d RX:%d)", name.c_str(), recovery_reason, status.tx_error_counter, status.rx_error_counter);
+        }
+        recovery.recovery_attempt_count++;
+        recovery.last_recovery_time = current_time;
+        stats.soft_recoveries++;
+
+        // Check if recovery attempts are escalating - trigger hard reset if stuck
+        if (recovery.recovery_attempt_count >= CanRecoveryState::RECOVERY_ATTEMPTS_THRESHOLD &&
+            (current_time - recovery.last_hard_reset_time) > CanRecoveryState::HARD_RESET_DEBOUNCE_MS) {
+            MB3_LOG_NICE("[%s] Recovery stuck after %d attempts, triggering hard reset", name.c_str(), recovery.recovery_attempt_count);
+            perform_hard_reset(current_time);
+        }
+        return false;
+    }
+
+    void log_status(uint32_t current_time, bool in_startup_grace) {
+        twai_status_info_t status;
+        // When bus is idle, log minimally — once per minute
+        if (recovery.bus_idle) {
+            if ((current_time - recovery.last_idle_log_ms) >= CanRecoveryState::IDLE_LOG_INTERVAL_MS) {
+                recovery.last_idle_log_ms = current_time;
+                if (driver->get_status_info(status) == ESP_OK) {
+                    MB3_LOG_NICE("[%s] Bus idle (TX:%d RX:%d, errors:%d)", name.c_str(), status.tx_error_counter, status.rx_error_counter, status.bus_error_count);
+                }
+            }
+        } else if (!in_startup_grace) {
+            // Note: alerts were already consumed by read_alerts() in handle_alerts().
+            // Read status directly - no second alert read needed.
+            if (driver->get_status_info(status) == ESP_OK) {
+                if (status.state == TWAI_STATE_STOPPED) {
+                    MB3_LOG_NICE("[%s] * TWAI_STATE_STOPPED (periodic check)", name.c_str());
+                } else if (status.state == TWAI_STATE_BUS_OFF) {
+                    MB3_LOG_NICE("[%s] * TWAI_STATE_BUS_OFF (periodic check)", name.c_str());
+                } else if (status.state == TWAI_STATE_RECOVERING) {
+                    MB3_LOG_NICE("[%s] * TWAI_STATE_RECOVERING (periodic check)", name.c_str());
+                }
+                if (status.tx_error_counter > 50 || status.rx_error_counter > 50) {
+                    MB3_LOG_NICE("[%s] Error counters: TX=%d RX=%d", name.c_str(), status.tx_error_counter, status.rx_error_counter);
+                }
+                if (status.bus_error_count > 1000) {
+                    MB3_LOG_NICE("[%s] High bus error count: %d", name.c_str(), status.bus_error_count);
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <vector>
+#include <mb3/can.hpp>
+
+/// @brief Read-only index of every registered signal by its "Frame->signal" name.
+///
+/// Add frames once they're registered, then @ref build. Names are interned into
+/// one buffer and hashed into an open addressing table, so @ref find doesn't
+/// allocate and the handles it returns stay valid for the directory's lifetime.
+///
+///     CanSignalDirectory directory;
+///     directory.add(CanFrameTypes::types);
+///     directory.build();
+///     auto rpm = directory.find("Engine->rpm");
+class CanSignalDirectory {
+    struct Entry {
+        uint32_t hash;
+        uint32_t name;
+        Subscribable * signal;
+        CanSignalReader read;
+    };
+
+    struct FrameEntry {
+        uint32_t name;
+        uint32_t first;
+        uint32_t count;
+    };
+
+public:
+    /// @brief A resolved signal, cheap to copy and compare
+    class Handle {
+    public:
+        Handle() = default;
+
+        explicit operator bool() const {
+            return entry != nullptr;
+        }
+
+        bool operator==(const Handle & other) const {
+            return entry == other.entry;
+        }
+
+        bool operator!=(const Handle & other) const {
+            return entry != other.entry;
+        }
+
+        /// @brief scaled value
+        float value() const {
+            return entry->read(*entry->signal);
+        }
+
+        Subscribable & signal() const {
+            return *entry->signal;
+        }
+
+        void subscribe(Subscription & subscription) const {
+            entry->signal->subscribe(subscription);
+        }
+
+        /// @brief "Frame->signal"
+        const char * name() const {
+            return directory->names.data() + entry->name;
+        }
+
+    private:
+        friend class CanSignalDirectory;
+        Handle(const CanSignalDirectory * directory, const Entry * entry) : directory(directory), entry(entry) { }
+
+        const CanSignalDirectory * directory = nullptr;
+        const Entry * entry = nullptr;
+    };
+
+    /// @brief Handles of one frame's signals, in frame order
+    class Range {
+    public:
+        class iterator {
+        public:
+            iterator(const CanSignalDirectory * directory, const Entry * entry) : directory(directory), entry(entry) { }
+            Handle operator*() const {
+                return Handle(directory, entry);
+            }
+            iterator & operator++() {
+                entry++;
+                return *this;
+            }
+            bool operator!=(const iterator & other) const {
+                return entry != other.entry;
+            }
+
+        private:
+            const CanSignalDirectory * directory;
+            const Entry * entry;
+        };
+
+        iterator begin() const {
+            return iterator(directory, first);
+        }
+
+        iterator end() const {
+            return iterator(directory, first + count);
+        }
+
+        size_t size() const {
+            return count;
+        }
+
+    private:
+        friend class CanSignalDirectory;
+        Range(const CanSignalDirectory * directory, const Entry * first, size_t count) : directory(directory), first(first), count(count) { }
+
+        const CanSignalDirectory * directory;
+        const Entry * first;
+        size_t count;
+    };
+
+    void add(ICanFrame & frame) {
+        if (built) {
+            log_e("Signal directory is already built, %s not added", frame.name().c_str());
+            return;
+        }
+        FrameEntry frame_entry = {intern(frame.name().c_str(), nullptr), (uint32_t)entries.size(), 0};
+        frame.each_signal([&](const char * name, Subscribable & signal, CanSignalReader read) {
+            auto offset = intern(frame.name().c_str(), name);
+            entries.push_back({hash(names.data() + offset), offset, &signal, read});
+            frame_entry.count++;
+        });
+        frames.push_back(frame_entry);
+    }
+
+    void add(const std::map<uint32_t, std::shared_ptr<ICanFrame>> & types) {
+        for (auto const & type : types) {
+            add(*type.second);
+        }
+    }
+
+    /// @brief Build the hash table, after which the directory is read-only
+    void build() {
+        size_t capacity = 8;
+        while (capacity < entries.size() * 2) {
+            capacity <<= 1;
+        }
+        slots.assign(capacity, EMPTY);
+        mask = capacity - 1;
+        for (uint32_t i = 0; i < entries.size(); i++) {
+            size_t slot = entries[i].hash & mask;
+            while (slots[slot] != EMPTY) {
+                if (strcmp(name_of(slots[slot]), name_of(i)) == 0) {
+                    log_w("Duplicate signal %s", name_of(i));
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+            if (slots[slot] == EMPTY)
+                slots[slot] = i;
+        }
+        names.shrink_to_fit();
+        entries.shrink_to_fit();
+        frames.shrink_to_fit();
+        built = true;
+    }
+
+    /// @brief Look up "Frame->signal", without allocating
+    Handle find(const char * name) const {
+        if (slots.empty())
+            return Handle();
+        for (size_t slot = hash(name) & mask; slots[slot] != EMPTY; slot = (slot + 1) & mask) {
+            auto const & entry = entries[slots[slot]];
+            if (strcmp(names.data() + entry.name, name) == 0)
+                return Handle(this, &entry);
+        }
+        return Handle();
+    }
+
+    /// @brief Signals of one frame, or an empty range
+    Range frame(const char * name) const {
+        // frames are few compared to signals, a scan is fine here
+        for (auto const & frame : frames) {
+            if (strcmp(names.data() + frame.name, name) == 0)
+                return Range(this, entries.data() + frame.first, frame.count);
+        }
+        return Range(this, nullptr, 0);
+    }
+
+    /// @brief Call visit for every signal whose name starts with prefix
+    template <typename Visitor>
+    void each(const char * prefix, Visitor visit) const {
+        size_t length = strlen(prefix);
+        for (auto const & entry : entries) {
+            if (strncmp(names.data() + entry.name, prefix, length) == 0)
+                visit(Handle(this, &entry));
+        }
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    /// @brief bytes used by names, entries and the hash table
+    size_t memory() const {
+        return names.capacity() + entries.capacity() * sizeof(Entry) + frames.capacity() * sizeof(FrameEntry) + slots.capacity() * sizeof(uint16_t);
+    }
+
+private:
+    static constexpr uint16_t EMPTY = 0xFFFF;
+
+    /// @brief FNV-1a
+    static uint32_t hash(const char * name) {
+        uint32_t hash = 2166136261u;
+        while (*name) {
+            hash = (hash ^ (uint8_t)*name++) * 16777619u;
+        }
+        return hash;
+    }
+
+    /// @brief Append "frame->signal" (or just "frame") to the name buffer
+    uint32_t intern(const char * frame, const char * signal) {
+        uint32_t offset = names.size();
+        names.insert(names.end(), frame, frame + strlen(frame));
+        if (signal) {
+            names.push_back('-');
+            names.push_back('>');
+            names.insert(names.end(), signal, signal + strlen(signal));
+        }
+        names.push_back('\0');
+        return offset;
+    }
+
+    const char * name_of(uint32_t entry) const {
+        return names.data() + entries[entry].name;
+    }
+
+    std::vector<char> names;
+    std::vector<Entry> entries;
+    std::vector<FrameEntry> frames;
+    std::vector<uint16_t> slots;
+    size_t mask = 0;
+    bool built = false;
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <mb3/can_bus.hpp>
+
+/// @brief In-memory @ref ICanDriver for replays and `env:native` tests.
+/// Frames transmitted on one driver are delivered to every driver it's wired to.
+class SimulatedCanDriver : public ICanDriver {
+public:
+    virtual esp_err_t install() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (installed)
+            return ESP_ERR_INVALID_STATE;
+        installed = true;
+        installs++;
+        return ESP_OK;
+    }
+
+    virtual esp_err_t uninstall() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!installed || status.state == TWAI_STATE_RUNNING || status.state == TWAI_STATE_RECOVERING)
+            return ESP_ERR_INVALID_STATE;
+        installed = false;
+        rx.clear();
+        return ESP_OK;
+    }
+
+    virtual esp_err_t start() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!installed)
+            return ESP_ERR_INVALID_STATE;
+        status = {};
+        status.state = TWAI_STATE_RUNNING;
+        return ESP_OK;
+    }
+
+    virtual esp_err_t stop() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (status.state != TWAI_STATE_RUNNING)
+            return ESP_ERR_INVALID_STATE;
+        status.state = TWAI_STATE_STOPPED;
+        return ESP_OK;
+    }
+
+    virtual esp_err_t receive(twai_message_t & frame, uint32_t timeout_ms) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (rx.empty() || status.state != TWAI_STATE_RUNNING)
+            return ESP_ERR_TIMEOUT;
+        frame = rx.front();
+        rx.pop_front();
+        return ESP_OK;
+    }
+
+    virtual esp_err_t transmit(const twai_message_t & frame, uint32_t timeout_ms) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (status.state != TWAI_STATE_RUNNING)
+                return ESP_ERR_INVALID_STATE;
+            if (tx_queue_len && tx.size() >= tx_queue_len)
+                return ESP_ERR_TIMEOUT;
+            tx.push_back(frame);
+        }
+        for (auto peer : peers) {
+            peer->inject(frame);
+        }
+        return ESP_OK;
+    }
+
+    virtual esp_err_t read_alerts(uint32_t & alerts, uint32_t timeout_ms) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending_alerts == 0)
+            return ESP_ERR_TIMEOUT;
+        alerts = pending_alerts;
+        pending_alerts = 0;
+        return ESP_OK;
+    }
+
+    virtual esp_err_t get_status_info(twai_status_info_t & status) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        status = this->status;
+        status.msgs_to_rx = rx.size();
+        status.msgs_to_tx = tx.size();
+        return ESP_OK;
+    }
+
+    virtual esp_err_t initiate_recovery() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (status.state != TWAI_STATE_BUS_OFF)
+            return ESP_ERR_INVALID_STATE;
+        // recovery completes instantly, the controller comes back stopped
+        status.state = TWAI_STATE_STOPPED;
+        status.tx_error_counter = 0;
+        status.rx_error_counter = 0;
+        pending_alerts |= TWAI_ALERT_BUS_RECOVERED;
+        recoveries++;
+        return ESP_OK;
+    }
+
+    /// @brief Put a frame in the receive queue, as if it arrived on the wire
+    void inject(const twai_message_t & frame) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (rx_queue_len && rx.size() >= rx_queue_len) {
+            status.rx_missed_count++;
+            return;
+        }
+        rx.push_back(frame);
+    }
+
+    void raise(uint32_t alerts) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending_alerts |= alerts;
+    }
+
+    void set_state(twai_state_t state, uint32_t tx_error_counter = 0, uint32_t rx_error_counter = 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        status.state = state;
+        status.tx_error_counter = tx_error_counter;
+        status.rx_error_counter = rx_error_counter;
+    }
+
+    /// @brief Deliver this driver's transmissions to other
+    void connect(SimulatedCanDriver & other) {
+        peers.push_back(&other);
+    }
+
+    /// @brief Remove and return everything transmitted so far
+    std::vector<twai_message_t> take_transmitted() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<twai_message_t> frames(tx.begin(), tx.end());
+        tx.clear();
+        return frames;
+    }
+
+    size_t rx_pending() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return rx.size();
+    }
+
+    size_t rx_queue_len = MB3_CAN_RX_QUEUE_LEN;
+    size_t tx_queue_len = 0;
+    uint32_t installs = 0;
+    uint32_t recoveries = 0;
+
+private:
+    std::mutex mutex;
+    bool installed = false;
+    twai_status_info_t status = {};
+    uint32_t pending_alerts = 0;
+    std::deque<twai_message_t> rx;
+    std::deque<twai_message_t> tx;
+    std::vector<SimulatedCanDriver *> peers;
+};
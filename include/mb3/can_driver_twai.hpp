@@ -0,0 +1,46 @@
+#pragma once
+
+#include <mb3/can_bus.hpp>
+#include "driver/twai.h"
+#include "esp_idf_version.h"
+
+// ESP-IDF 5.2 added handle based twai_*_v2 calls for chips with several controllers
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0)
+#define MB3_TWAI_V2 1
+#else
+#define MB3_TWAI_V2 0
+#endif
+
+/// @brief @ref ICanDriver for the on-chip TWAI controller(s)
+class TwaiCanDriver : public ICanDriver {
+public:
+    struct Config {
+        int controller = 0;
+        twai_general_config_t general;
+        twai_timing_config_t timing;
+        twai_filter_config_t filter;
+    };
+
+    /// @brief Controller 0 configured from the MB3_CAN_* defines
+    static Config defaults();
+
+    TwaiCanDriver(const Config & config) : config(config) { }
+
+    virtual esp_err_t install() override;
+    virtual esp_err_t uninstall() override;
+    virtual esp_err_t start() override;
+    virtual esp_err_t stop() override;
+    virtual esp_err_t receive(twai_message_t & frame, uint32_t timeout_ms) override;
+    virtual esp_err_t transmit(const twai_message_t & frame, uint32_t timeout_ms) override;
+    virtual esp_err_t read_alerts(uint32_t & alerts, uint32_t timeout_ms) override;
+    virtual esp_err_t get_status_info(twai_status_info_t & status) override;
+    virtual esp_err_t initiate_recovery() override;
+    virtual bool reset() override;
+
+    Config config;
+
+private:
+#if MB3_TWAI_V2
+    twai_handle_t handle = nullptr;
+#endif
+};
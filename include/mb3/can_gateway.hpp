@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <mb3/can_bus.hpp>
+
+/// @brief One forwarding rule of a @ref CanGateway
+struct CanRoute {
+    enum class Remap : uint8_t {
+        None,
+        Replace,    // identifier = remap_id
+        Offset,     // identifier += remap_id, keeps ranges contiguous
+    };
+
+    /// @brief Match exactly one identifier
+    static CanRoute id(uint32_t identifier, CanBus * destination, bool extd = false) {
+        return range(identifier, identifier, destination, extd);
+    }
+
+    /// @brief Match first..last (inclusive)
+    static CanRoute range(uint32_t first, uint32_t last, CanBus * destination, bool extd = false) {
+        CanRoute route;
+        route.first = first;
+        route.last = last;
+        route.extd = extd;
+        route.destination = destination;
+        return route;
+    }
+
+    /// @brief Match (identifier & mask) == id
+    static CanRoute masked(uint32_t id, uint32_t mask, CanBus * destination, bool extd = false) {
+        CanRoute route = range(id & mask, id & mask, destination, extd);
+        route.mask = mask;
+        return route;
+    }
+
+    CanRoute & replace_id(uint32_t identifier) {
+        remap = Remap::Replace;
+        remap_id = identifier;
+        return *this;
+    }
+
+    CanRoute & offset_id(int32_t offset) {
+        remap = Remap::Offset;
+        remap_id = offset;
+        return *this;
+    }
+
+    /// @brief data[byte] = (data[byte] & and_mask) | or_mask
+    CanRoute & mask_byte(uint8_t byte, uint8_t and_mask, uint8_t or_mask = 0) {
+        if (byte < 8) {
+            this->and_mask[byte] = and_mask;
+            this->or_mask[byte] = or_mask;
+            masks_payload = true;
+        }
+        return *this;
+    }
+
+    /// @brief Token bucket: on average per_second frames, up to burst back to back
+    CanRoute & limit(uint32_t per_second, uint32_t burst = 1) {
+        interval_us = per_second ? 1000000 / per_second : 0;
+        this->burst = burst ? burst : 1;
+        return *this;
+    }
+
+    /// @brief Don't decode matching frames on the source bus
+    CanRoute & consume() {
+        decode = false;
+        return *this;
+    }
+
+    bool matches(const twai_message_t & frame) const {
+        if (frame.extd != extd)
+            return false;
+        uint32_t identifier = frame.identifier & mask;
+        return identifier >= first && identifier <= last;
+    }
+
+    uint32_t first = 0;
+    uint32_t last = 0;
+    uint32_t mask = 0x1FFFFFFF;
+    bool extd = false;
+    bool decode = true;
+
+    CanBus * destination = nullptr;
+
+    Remap remap = Remap::None;
+    uint32_t remap_id = 0;
+
+    bool masks_payload = false;
+    uint8_t and_mask[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    uint8_t or_mask[8] = {0};
+
+    uint32_t interval_us = 0;
+    uint32_t burst = 1;
+};
+
+struct CanRouteStats {
+    uint32_t matched = 0;
+    uint32_t forwarded = 0;
+    uint32_t rate_limited = 0;
+    uint32_t tx_dropped = 0;
+    // receive timestamp to destination TX queue, us
+    uint64_t latency_total = 0;
+    uint32_t latency_max = 0;
+
+    float latency_average() const {
+        return forwarded ? (float)latency_total / forwarded : 0.f;
+    }
+};
+
+/// @brief Receive stage that forwards raw frames to other buses' TX queues,
+/// ahead of (and independent from) signal decode on the source bus.
+/// Add to the source bus with `bus.stages.push_back(gateway)`.
+class CanGateway : public ICanReceiveStage {
+public:
+    /// @return index for @ref stats
+    size_t add(const CanRoute & route) {
+        routes.push_back({route, CanRouteStats{}, 0, -1});
+        return routes.size() - 1;
+    }
+
+    virtual bool process(CanLog & message) override {
+        bool decode = true;
+        for (auto & entry : routes) {
+            auto const & route = entry.route;
+            if (!route.matches(message.frame))
+                continue;
+            entry.stats.matched++;
+            decode &= route.decode;
+
+            if (!admit(entry, message.timestamp)) {
+                entry.stats.rate_limited++;
+                continue;
+            }
+
+            twai_message_t frame = message.frame;
+            switch (route.remap) {
+                case CanRoute::Remap::Replace:
+                    frame.identifier = route.remap_id;
+                    break;
+                case CanRoute::Remap::Offset:
+                    frame.identifier += route.remap_id;
+                    break;
+                default:
+                    break;
+            }
+            frame.identifier &= frame.extd ? 0x1FFFFFFF : 0x7FF;
+            if (route.masks_payload) {
+                for (size_t i = 0; i < 8; i++) {
+                    frame.data[i] = (frame.data[i] & route.and_mask[i]) | route.or_mask[i];
+                }
+            }
+
+            if (route.destination == nullptr || !route.destination->transmit(frame, 0)) {
+                entry.stats.tx_dropped++;
+                continue;
+            }
+            uint32_t latency = esp_timer_get_time() - message.timestamp;
+            entry.stats.forwarded++;
+            entry.stats.latency_total += latency;
+            if (latency > entry.stats.latency_max)
+                entry.stats.latency_max = latency;
+        }
+        return decode;
+    }
+
+    const CanRouteStats & stats(size_t route) const {
+        return routes[route].stats;
+    }
+
+    size_t size() const {
+        return routes.size();
+    }
+
+    void reset_stats() {
+        for (auto & entry : routes) {
+            entry.stats = {};
+        }
+    }
+
+private:
+    struct Entry {
+        CanRoute route;
+        CanRouteStats stats;
+        // token bucket, in us of credit
+        uint64_t credit;
+        int64_t last;
+    };
+
+    static bool admit(Entry & entry, int64_t now) {
+        auto const & route = entry.route;
+        if (route.interval_us == 0)
+            return true;
+        uint64_t capacity = (uint64_t)route.interval_us * route.burst;
+        if (entry.last < 0) {
+            entry.credit = capacity;
+        } else if (now > entry.last) {
+            entry.credit = std::min<uint64_t>(capacity, entry.credit + (now - entry.last));
+        }
+        entry.last = now;
+        if (entry.credit < route.interval_us)
+            return false;
+        entry.credit -= route.interval_us;
+        return true;
+    }
+
+    std::vector<Entry> routes;
+};
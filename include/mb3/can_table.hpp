@@ -0,0 +1,233 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <string>
+#include <mb3/can.hpp>
+#include <mb3/subscription.hpp>
+
+/// @brief Layout and scaling of one signal. Declare tables of these `constexpr`
+/// so they're placed in flash (.rodata) rather than copied into RAM:
+///
+///     constexpr CanSignalInfo ENGINE[] = {
+///         {"rpm", "rpm", 0, 16, 0.25f},
+///         {"coolant", "C", 16, 8, 1.f, -40.f},
+///     };
+///     CanTableFrame<2> engine{"Engine", 0x100, ENGINE};
+struct CanSignalInfo {
+    const char * name;
+    const char * unit;
+    /// @brief first bit, little endian
+    uint8_t start;
+    /// @brief in bits, up to 32
+    uint8_t length;
+    float scale = 1.f;
+    float offset = 0.f;
+
+    constexpr uint32_t mask() const {
+        return length >= 32 ? 0xFFFFFFFF : (1UL << length) - 1;
+    }
+
+    constexpr float apply(uint32_t raw) const {
+        return (raw * scale) + offset;
+    }
+
+    uint32_t encode(float value) const {
+        float raw = std::round((value - offset) / scale);
+        if (raw <= 0.f)
+            return 0;
+        if (raw >= (float)mask())
+            return mask();
+        return (uint32_t)raw;
+    }
+};
+
+/// @brief Bits used by a signal table, for static_asserts on the layout
+template <size_t N>
+constexpr size_t can_table_bits(const CanSignalInfo (&table)[N]) {
+    size_t bits = 0;
+    for (size_t i = 0; i < N; i++) {
+        if (table[i].start + table[i].length > bits)
+            bits = table[i].start + table[i].length;
+    }
+    return bits;
+}
+
+/// @brief The RAM side of a table signal: its raw value and its subscribers.
+/// Everything else is read from the @ref CanSignalInfo in flash.
+class CanTableSignal : public Subscribable {
+public:
+    const CanSignalInfo & info() const {
+        return *_info;
+    }
+
+    const char * name() const {
+        return _info->name;
+    }
+
+    uint32_t raw() const {
+        return _raw;
+    }
+
+    operator float() const {
+        return _info->apply(_raw);
+    }
+
+private:
+    template <size_t> friend class CanTableFrame;
+
+    const CanSignalInfo * _info = nullptr;
+    uint32_t _raw = 0;
+};
+
+/// @brief A CAN frame decoded from a constexpr @ref CanSignalInfo table.
+/// Frames are usually static, so @ref unowned returns a non-owning pointer for
+/// registering with a @ref CanBus.
+/// @tparam N number of signals
+template <size_t N>
+class CanTableFrame : public ICanFrame {
+    static_assert(N > 0 && N <= 64, "a CAN frame holds 1 to 64 signals");
+public:
+    using CallbackType = std::function<void(CanTableFrame&)>;
+
+    CanTableFrame(const char * name, uint32_t id, const CanSignalInfo (&table)[N]) :
+        _name(name),
+        _id(id),
+        _size(BYTE_CEILING(can_table_bits(table)))
+    {
+        for (size_t i = 0; i < N; i++) {
+            signals[i]._info = &table[i];
+        }
+        if (can_table_bits(table) > 64) {
+            log_e("%s signals exceed 64 bits", name);
+            _size = 8;
+        }
+    }
+
+    /// @brief For registering: the returned pointer doesn't own the frame
+    inline std::shared_ptr<ICanFrame> unowned() {
+        return std::shared_ptr<ICanFrame>(this, [](ICanFrame *) { });
+    }
+
+    virtual void update() override {
+        uint64_t data = 0;
+        memcpy(&data, _data, sizeof(_data));
+
+        changed = 0;
+        for (size_t i = 0; i < N; i++) {
+            auto & signal = signals[i];
+            uint32_t raw = (data >> signal._info->start) & signal._info->mask();
+            if (raw != signal._raw) {
+                signal._raw = raw;
+                changed |= 1ULL << i;
+            }
+        }
+        updated = true;
+        if (changed)
+            on_decoded();
+
+        // notify once every value is current, so subscribers see a consistent frame
+        for (auto pending = changed; pending; pending &= pending - 1) {
+            signals[__builtin_ctzll(pending)].notify();
+        }
+        for (const auto & callback : callbacks) {
+            callback(*this);
+        }
+    }
+
+    /// @brief Encode a scaled value into the frame data, for transmitting
+    void set(size_t signal, float value) {
+        set_raw(signal, signals[signal]._info->encode(value));
+    }
+
+    void set_raw(size_t signal, uint32_t raw) {
+        auto const & info = *signals[signal]._info;
+        raw &= info.mask();
+        uint64_t data = 0;
+        memcpy(&data, _data, sizeof(_data));
+        data &= ~((uint64_t)info.mask() << info.start);
+        data |= (uint64_t)raw << info.start;
+        memcpy(_data, &data, sizeof(_data));
+        signals[signal]._raw = raw;
+    }
+
+    /// @brief Linear search by signal name, for setup code
+    CanTableSignal * find(const char * name) {
+        for (auto & signal : signals) {
+            if (strcmp(signal.name(), name) == 0)
+                return &signal;
+        }
+        return nullptr;
+    }
+
+    CanTableSignal & operator[](size_t signal) {
+        return signals[signal];
+    }
+
+    bool has_changed(size_t signal) const {
+        return changed & (1ULL << signal);
+    }
+
+    // size in bytes
+    virtual size_t size() override {
+        return _size;
+    }
+
+    virtual uint32_t id() override {
+        return _id;
+    }
+
+    virtual uint8_t * data() override {
+        return _data;
+    }
+
+    virtual void members() override {
+        log_d("%s: %zu members, %zu bytes RAM (%zu per signal)", _name.c_str(), N, ram(), signal_ram);
+        for (auto const & signal : signals) {
+            log_d("* %02X: %s [%s]", signal._info->start, signal.name(), signal._info->unit ? signal._info->unit : "");
+        }
+    }
+
+    virtual const std::string& name() override {
+        return _name;
+    }
+
+    virtual void update_from_member(ICanSignal&) override {
+        // table signals are written with set()
+    }
+
+    virtual void each_signal(const SignalVisitor & visit) override {
+        for (auto & signal : signals) {
+            visit(signal.name(), signal, [](Subscribable & signal) {
+                return (float)static_cast<CanTableSignal &>(signal);
+            });
+        }
+    }
+
+    /// @brief RAM used per signal, the table itself stays in flash
+    static constexpr size_t signal_ram = sizeof(CanTableSignal);
+
+    /// @brief RAM used by the whole frame, excluding callbacks
+    size_t ram() const {
+        return sizeof(*this);
+    }
+
+    static constexpr size_t count = N;
+
+    std::vector<CallbackType> callbacks;
+    bool updated = false;
+
+protected:
+    /// @brief Called after raw values changed, before anyone is notified
+    virtual void on_decoded() { }
+
+    CanTableSignal signals[N];
+    uint64_t changed = 0;
+    std::string _name;
+    uint32_t _id;
+    size_t _size;
+    uint8_t _data[8] = {0};
+};
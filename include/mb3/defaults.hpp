@@ -5,13 +5,20 @@
 #include <Arduino.h>
 #define MB3_LOG(...) log_printf(__VA_ARGS__)
 
-#else
+#elif defined(ESP_PLATFORM)
 
 #include "esp_log.h"
 #define MB3_LOG(...) ESP_LOGD("MB3", __VA_ARGS__)
 #define micros() esp_timer_get_time()
 #define millis() (esp_time_get_time() / 1000)
 
+#else
+
+#include <mb3/platform.hpp>
+#define MB3_LOG(...) printf(__VA_ARGS__)
+#define micros() esp_timer_get_time()
+#define millis() (esp_timer_get_time() / 1000)
+
 #endif
 
 #define MB3_LOG_NICE(format, ...) MB3_LOG("[%6u][D]" format "\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL) __VA_OPT__(,) __VA_ARGS__);
@@ -49,4 +56,103 @@
 
 #ifndef MB3_CAN_TX_QUEUE_LEN
 #define MB3_CAN_TX_QUEUE_LEN 500
-#endif
\ No newline at end of file
+#endif
+
+// Text buffer each TextWidget owns, including the terminator
+#ifndef MB3_TEXT_WIDGET_LENGTH
+#define MB3_TEXT_WIDGET_LENGTH 32
+#endif
+
+// Parents a WidgetBatch scope can reserve children for, more parents are built unbatched
+#ifndef MB3_WIDGET_BATCH_PARENTS
+#define MB3_WIDGET_BATCH_PARENTS 8
+#endif
+
+// Rectangles a CanvasDirtyTracker keeps per frame before merging the closest
+#ifndef MB3_DIRTY_RECTS
+#define MB3_DIRTY_RECTS 8
+#endif
+
+// Internal RAM for the drawing helpers' per-frame arena (FrameArena), and
+// whether it may spill into PSRAM when a frame needs more
+#ifndef MB3_FRAME_ARENA_SIZE
+#define MB3_FRAME_ARENA_SIZE 8192
+#endif
+
+#ifndef MB3_FRAME_ARENA_OVERFLOW
+#define MB3_FRAME_ARENA_OVERFLOW 1
+#endif
+
+// Vector paths the FrameArena pools, further paths per frame use lv_malloc
+#ifndef MB3_FRAME_ARENA_PATHS
+#define MB3_FRAME_ARENA_PATHS 32
+#endif
+
+// Bump allocate Widgets from per-screen arenas (ScreenArena), needs the link
+// flag -Wl,--wrap=lv_free_core; internal RAM for each arena's first block
+#ifndef MB3_SCREEN_ARENA
+#define MB3_SCREEN_ARENA 0
+#endif
+
+#ifndef MB3_SCREEN_ARENA_SIZE
+#define MB3_SCREEN_ARENA_SIZE 16384
+#endif
+
+// Screens that can hold an arena at once, further screens use lv_malloc
+#ifndef MB3_SCREEN_ARENAS
+#define MB3_SCREEN_ARENAS 4
+#endif
+
+// Offscreen layer buffers the Layer helper keeps for reuse (LayerPool), and
+// the size in bytes up to which they come from internal RAM instead of PSRAM
+#ifndef MB3_LAYER_POOL_SLOTS
+#define MB3_LAYER_POOL_SLOTS 16
+#endif
+
+#ifndef MB3_LAYER_POOL_INTERNAL
+#define MB3_LAYER_POOL_INTERNAL 8192
+#endif
+
+// Draw buffers DrawBuffers can hold at once (lent or free), and the PSRAM
+// they may take in bytes (0: no limit)
+#ifndef MB3_DRAW_BUFFERS
+#define MB3_DRAW_BUFFERS 32
+#endif
+
+#ifndef MB3_DRAW_BUFFERS_PSRAM_BUDGET
+#define MB3_DRAW_BUFFERS_PSRAM_BUDGET 0
+#endif
+
+// Use esp-dsp's SIMD kernels (ESP32-S3) for batch signal conversion, when the component is available
+#ifndef MB3_CAN_ESP_DSP
+#if defined(ESP_PLATFORM) && __has_include(<dsps_math.h>)
+#define MB3_CAN_ESP_DSP 1
+#else
+#define MB3_CAN_ESP_DSP 0
+#endif
+#endif
+
+// Decode 29-bit frames as J1939 (PGN dispatch, transport protocol, address claim)
+#ifndef MB3_CAN_J1939
+#define MB3_CAN_J1939 0
+#endif
+
+// Our own source address, only used to answer RTS/CTS transfers addressed to us.
+// 0xFE (null address) keeps the J1939 layer purely passive.
+#ifndef MB3_J1939_ADDRESS
+#define MB3_J1939_ADDRESS 0xFE
+#endif
+
+// Concurrent BAM/CMDT reassemblies, each holds MB3_J1939_TP_MAX_SIZE bytes of PSRAM
+#ifndef MB3_J1939_TP_SESSIONS
+#define MB3_J1939_TP_SESSIONS 8
+#endif
+
+#ifndef MB3_J1939_TP_MAX_SIZE
+#define MB3_J1939_TP_MAX_SIZE 1785
+#endif
+
+// Packets requested per CTS when we are the CMDT destination
+#ifndef MB3_J1939_CTS_PACKETS
+#define MB3_J1939_CTS_PACKETS 16
+#endif
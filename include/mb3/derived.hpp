@@ -0,0 +1,192 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <mb3/subscription.hpp>
+
+/// @brief A value computed from signals (or other derived signals) by a pure
+/// function. It's recomputed by @ref DerivedGraph::update only when one of its
+/// inputs changed, and notifies its subscribers only when its value changed,
+/// so it can be observed and chained like an ordinary signal.
+class IDerivedSignal : public Subscribable {
+public:
+    inline IDerivedSignal(uint8_t rank);
+    virtual inline ~IDerivedSignal();
+
+    float value() const {
+        return _value;
+    }
+
+    operator float() const {
+        return _value;
+    }
+
+    /// @brief Depth in the graph: 0 when every input is a signal,
+    /// otherwise one more than the deepest derived input
+    uint8_t rank() const {
+        return _rank;
+    }
+
+    /// @brief Recompute on the next @ref DerivedGraph::update, safe from any task
+    inline void markDirty();
+
+protected:
+    virtual float compute() = 0;
+
+    float _value = 0.f;
+
+private:
+    friend class DerivedGraph;
+
+    IDerivedSignal * graph_prev = nullptr;
+    IDerivedSignal * graph_next = nullptr;
+    // computed once on the first update
+    std::atomic<bool> dirty{true};
+    uint8_t _rank;
+};
+
+/// @brief All live derived signals, in topological order.
+/// Nodes register on construction, sorted by rank, so the order is fixed once
+/// rather than worked out every cycle; a node's inputs always come before it.
+/// Registration and @ref update happen on the UI task.
+class DerivedGraph {
+public:
+    /// @brief Recompute the nodes downstream of changed inputs, each at most once.
+    /// Called by @ref ObservableManager::update before observables update.
+    static void update() {
+        if (!pending.exchange(false, std::memory_order_acquire))
+            return;
+        for (auto node = head; node; node = node->graph_next) {
+            if (!node->dirty.exchange(false, std::memory_order_acq_rel))
+                continue;
+            float value = node->compute();
+            bool same = value == node->_value || (std::isnan(value) && std::isnan(node->_value));
+            if (!same) {
+                node->_value = value;
+                // marks dependants dirty, they come later in the list
+                node->notify();
+            }
+        }
+    }
+
+    /// @brief Visit nodes in evaluation order
+    template <typename Visitor>
+    static void each(Visitor visit) {
+        for (auto node = head; node; node = node->graph_next) {
+            visit(*node);
+        }
+    }
+
+    static size_t size() {
+        return count;
+    }
+
+private:
+    friend class IDerivedSignal;
+
+    static void add(IDerivedSignal * node) {
+        // after the last node of the same or lower rank, usually the tail
+        auto before = tail;
+        while (before && before->_rank > node->_rank) {
+            before = before->graph_prev;
+        }
+        node->graph_prev = before;
+        node->graph_next = before ? before->graph_next : head;
+        if (node->graph_next)
+            node->graph_next->graph_prev = node;
+        else
+            tail = node;
+        if (before)
+            before->graph_next = node;
+        else
+            head = node;
+        count++;
+    }
+
+    static void remove(IDerivedSignal * node) {
+        if (node->graph_prev)
+            node->graph_prev->graph_next = node->graph_next;
+        else
+            head = node->graph_next;
+        if (node->graph_next)
+            node->graph_next->graph_prev = node->graph_prev;
+        else
+            tail = node->graph_prev;
+        count--;
+    }
+
+    static inline IDerivedSignal * head = nullptr;
+    static inline IDerivedSignal * tail = nullptr;
+    static inline size_t count = 0;
+    static inline std::atomic<bool> pending{false};
+};
+
+IDerivedSignal::IDerivedSignal(uint8_t rank) : _rank(rank) {
+    DerivedGraph::add(this);
+    DerivedGraph::pending.store(true, std::memory_order_release);
+}
+
+IDerivedSignal::~IDerivedSignal() {
+    DerivedGraph::remove(this);
+}
+
+void IDerivedSignal::markDirty() {
+    dirty.store(true, std::memory_order_release);
+    DerivedGraph::pending.store(true, std::memory_order_release);
+}
+
+/// @brief Rank of a node reading inputs
+template <typename... Inputs>
+uint8_t derived_rank(const Inputs &... inputs) {
+    uint8_t rank = 0;
+    auto visit = [&rank](const auto & input) {
+        if constexpr (std::is_base_of<IDerivedSignal, std::decay_t<decltype(input)>>::value) {
+            const IDerivedSignal & node = input;
+            if (node.rank() + 1 > rank)
+                rank = node.rank() + 1;
+        }
+    };
+    (visit(inputs), ...);
+    return rank;
+}
+
+/// @brief A derived signal over any Subscribable inputs that convert to float
+/// (frame signals, table signals, other derived signals).
+///
+///     TDerivedSignal power([](float torque, float rpm) { return torque * rpm / 9549.f; }, engine[TORQUE], engine[RPM]);
+///     TDerivedSignal economy([](float speed, float flow) { return flow > 0.f ? speed / flow : 0.f; }, abs[SPEED], engine[FUEL_FLOW]);
+///     TObservable<float, IDerivedSignal> o_power(&power);
+template <typename Function, typename... Inputs>
+class TDerivedSignal : public IDerivedSignal {
+    static_assert(sizeof...(Inputs) > 0, "a derived signal needs inputs");
+    static_assert((std::is_base_of<Subscribable, Inputs>::value && ...), "derived signal inputs must be signals or derived signals");
+public:
+    TDerivedSignal(Function function, Inputs &... inputs) :
+        IDerivedSignal(derived_rank(inputs...)),
+        function(function),
+        inputs(inputs...)
+    {
+        size_t i = 0;
+        auto subscribe = [this, &i](Subscribable & input) {
+            subscriptions[i].callback = [](void * node) { static_cast<IDerivedSignal*>(node)->markDirty(); };
+            subscriptions[i].context = static_cast<IDerivedSignal*>(this);
+            input.subscribe(subscriptions[i++]);
+        };
+        (subscribe(inputs), ...);
+    }
+
+    virtual ~TDerivedSignal() override = default;
+
+protected:
+    virtual float compute() override {
+        return std::apply([this](auto &... input) { return (float)function(static_cast<float>(input)...); }, inputs);
+    }
+
+private:
+    Function function;
+    std::tuple<Inputs &...> inputs;
+    Subscription subscriptions[sizeof...(Inputs)];
+};
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <lvgl.h>
+#include <stdint.h>
+#include <string.h>
+#include <memory>
+#include <mb3/platform.hpp>
+#include <mb3/lvgl_mb3.hpp>
+#include <mb3/widget.hpp>
+#include <mb3/number_format.hpp>
+
+/// @brief A font's digits, '.', '-' and a few unit glyphs, rasterised once
+/// into a PSRAM atlas. Each glyph is a band of the atlas, exposed as its own
+/// draw buffer (sharing the atlas memory), so drawing a character is a plain
+/// image blit with no font rendering. Share one atlas between readouts using
+/// the same font. Create it once the display exists, it renders through LVGL.
+///
+///     auto big_digits = new GlyphAtlas(&font_big, "km/h");
+class GlyphAtlas {
+public:
+    static constexpr size_t MAX_GLYPHS = 32;
+
+    /// @param extra unit glyphs to add to "0123456789.-" (ASCII)
+    GlyphAtlas(const lv_font_t * font, const char * extra = "", lv_color_format_t format = LV_COLOR_FORMAT_A8) : font(font) {
+        memset(index, -1, sizeof(index));
+        add_glyphs("0123456789.-");
+        add_glyphs(extra);
+
+        line_height = lv_font_get_line_height(font);
+        // digits share one width so values don't wobble
+        for (char c = '0'; c <= '9'; c++) {
+            digit_width = LV_MAX(digit_width, (int32_t)lv_font_get_glyph_width(font, c, 0));
+        }
+        int32_t width = digit_width;
+        for (size_t i = 0; i < count; i++) {
+            widths[i] = is_digit(glyphs[i]) ? digit_width : lv_font_get_glyph_width(font, glyphs[i], 0);
+            width = LV_MAX(width, widths[i]);
+        }
+
+        uint32_t stride = LV_DRAW_BUF_STRIDE(width, format);
+        size_t band = stride * line_height;
+        data_size = band * count;
+        data = (uint8_t*)heap_caps_aligned_alloc(LV_DRAW_BUF_ALIGN, data_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!data) {
+            log_e("glyph atlas: %u bytes", (unsigned)data_size);
+            count = 0;
+            return;
+        }
+        memset(data, 0, data_size);
+        lv_draw_buf_init(&atlas, width, line_height * count, format, stride, data, data_size);
+        for (size_t i = 0; i < count; i++) {
+            lv_draw_buf_init(&cells[i], widths[i], line_height, format, stride, data + (band * i), band);
+        }
+        render();
+    }
+
+    ~GlyphAtlas() {
+        heap_caps_free(data);
+    }
+
+    GlyphAtlas(const GlyphAtlas &) = delete;
+    GlyphAtlas & operator=(const GlyphAtlas &) = delete;
+
+    /// @return nullptr for characters not in the atlas
+    const lv_draw_buf_t * glyph(char c) const {
+        int8_t i = (uint8_t)c < 128 ? index[(uint8_t)c] : -1;
+        return i < 0 ? nullptr : &cells[i];
+    }
+
+    /// @brief Advance of c, spaces and missing glyphs take a digit's width
+    int32_t width(char c) const {
+        int8_t i = (uint8_t)c < 128 ? index[(uint8_t)c] : -1;
+        return i < 0 ? digit_width : widths[i];
+    }
+
+    int32_t height() const {
+        return line_height;
+    }
+
+    /// @brief PSRAM used by the glyphs
+    size_t memory() const {
+        return data_size;
+    }
+
+    const lv_font_t * const font;
+
+private:
+    static bool is_digit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    void add_glyphs(const char * text) {
+        for (; *text; text++) {
+            uint8_t c = *text;
+            if (c >= 128 || c == ' ' || index[c] >= 0 || count >= MAX_GLYPHS)
+                continue;
+            index[c] = count;
+            glyphs[count++] = c;
+        }
+    }
+
+    /// @brief Draw every glyph in white through a throwaway canvas, once. The
+    /// software renderer can't target A8, so an A8 atlas is drawn into an
+    /// ARGB8888 scratch buffer and keeps only its alpha.
+    void render() {
+        bool alpha_only = atlas.header.cf == LV_COLOR_FORMAT_A8;
+        lv_draw_buf_t scratch;
+        lv_draw_buf_t * target = &atlas;
+        uint8_t * scratch_data = nullptr;
+        if (alpha_only) {
+            uint32_t stride = LV_DRAW_BUF_STRIDE(atlas.header.w, LV_COLOR_FORMAT_ARGB8888);
+            size_t size = LV_DRAW_BUF_SIZE(atlas.header.w, atlas.header.h, LV_COLOR_FORMAT_ARGB8888);
+            scratch_data = (uint8_t*)heap_caps_aligned_alloc(LV_DRAW_BUF_ALIGN, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            if (!scratch_data) {
+                log_e("glyph atlas: %u bytes to render", (unsigned)size);
+                return;
+            }
+            memset(scratch_data, 0, size);
+            lv_draw_buf_init(&scratch, atlas.header.w, atlas.header.h, LV_COLOR_FORMAT_ARGB8888, stride, scratch_data, size);
+            lv_draw_buf_set_flag(&scratch, LV_IMAGE_FLAGS_MODIFIABLE);
+            target = &scratch;
+        }
+
+        lv_obj_t * canvas = lv_canvas_create(lv_layer_top());
+        lv_obj_add_flag(canvas, LV_OBJ_FLAG_HIDDEN);
+        lv_canvas_set_draw_buf(canvas, target);
+        {
+            CanvasLayer layer(canvas);
+            lv_draw_label_dsc_t dsc;
+            lv_draw_label_dsc_init(&dsc);
+            dsc.font = font;
+            dsc.color = lv_color_white();
+            dsc.align = LV_TEXT_ALIGN_CENTER;
+            char text[2] = {0};
+            for (size_t i = 0; i < count; i++) {
+                text[0] = glyphs[i];
+                dsc.text = text;
+                dsc.text_local = 1;
+                lv_area_t area = {0, (int32_t)(line_height * i), widths[i] - 1, (int32_t)(line_height * (i + 1)) - 1};
+                lv_draw_label(layer, &dsc, &area);
+            }
+        }
+        lv_obj_delete(canvas);
+
+        if (alpha_only) {
+            extractAlpha(&scratch, &atlas);
+            heap_caps_free(scratch_data);
+        }
+    }
+
+    lv_draw_buf_t atlas;
+    lv_draw_buf_t cells[MAX_GLYPHS];
+    int32_t widths[MAX_GLYPHS];
+    char glyphs[MAX_GLYPHS];
+    int8_t index[128];
+    size_t count = 0;
+    int32_t digit_width = 0;
+    int32_t line_height = 0;
+    uint8_t * data = nullptr;
+    size_t data_size = 0;
+};
+
+/// @brief Numeric readout drawn from a @ref GlyphAtlas. A value change
+/// re-formats the text (@ref NumberFormat) and invalidates only the cells of
+/// the characters that changed, which are then blitted from the atlas.
+/// Text color and alignment come from the object's style.
+///
+///     auto speed = new DigitReadout<float, CanTableSignal>(screen, *big_digits, "%3.0f", &abs[SPEED]);
+template <typename D, typename T = D>
+class DigitReadout : public Widget<DigitReadout<D, T>> {
+    using Base = Widget<DigitReadout<D, T>>;
+public:
+    DigitReadout(lv_obj_t * parent, const GlyphAtlas & atlas, const char * format, T * p_value, float scalar = 1.f, float offset = 0.f) :
+        Base(parent),
+        o_value(p_value, scalar, offset),
+        atlas(atlas),
+        number(format)
+    {
+        lv_obj_set_height(this, atlas.height() + lv_obj_get_style_pad_top(this, LV_PART_MAIN) + lv_obj_get_style_pad_bottom(this, LV_PART_MAIN));
+        length = number.format(text, sizeof(text), o_value.get());
+        layout(text, length, x);
+        lv_obj_add_event_cb(this, on_resized, LV_EVENT_SIZE_CHANGED, nullptr);
+        if (o_value.isNotified())
+            o_value.subscribe(subscription);
+    }
+
+    /// @brief Call from the UI task for values without a signal to notify us
+    void update() {
+        if (!o_value.isNotified())
+            o_value.update();
+        if (o_value.hasChanged())
+            refresh();
+    }
+
+    TAdjustedObservable<D, T> o_value;
+
+private:
+    void refresh() {
+        char next[MB3_TEXT_WIDGET_LENGTH];
+        int32_t next_x[MB3_TEXT_WIDGET_LENGTH];
+        size_t next_length = number.format(next, sizeof(next), o_value.get());
+        layout(next, next_length, next_x);
+
+        // union of the old and new cells of every character that moved or changed
+        lv_area_t dirty = {INT32_MAX, 0, INT32_MIN, atlas.height() - 1};
+        for (size_t i = 0; i < LV_MAX(length, next_length); i++) {
+            bool same = i < length && i < next_length && text[i] == next[i] && x[i] == next_x[i];
+            if (same)
+                continue;
+            if (i < length) {
+                dirty.x1 = LV_MIN(dirty.x1, x[i]);
+                dirty.x2 = LV_MAX(dirty.x2, x[i] + atlas.width(text[i]) - 1);
+            }
+            if (i < next_length) {
+                dirty.x1 = LV_MIN(dirty.x1, next_x[i]);
+                dirty.x2 = LV_MAX(dirty.x2, next_x[i] + atlas.width(next[i]) - 1);
+            }
+        }
+        memcpy(text, next, next_length + 1);
+        memcpy(x, next_x, sizeof(x[0]) * next_length);
+        length = next_length;
+        if (dirty.x1 <= dirty.x2)
+            this->invalidate_rel_area(dirty);
+    }
+
+    static void on_resized(lv_event_t * e) {
+        auto self = static_cast<DigitReadout*>((lv_obj_t*)lv_event_get_current_target(e));
+        self->layout(self->text, self->length, self->x);
+        lv_obj_invalidate(self);
+    }
+
+    /// @brief x of each character, relative to the content area
+    void layout(const char * string, size_t count, int32_t * positions) {
+        int32_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            total += atlas.width(string[i]);
+        }
+        int32_t start = 0;
+        int32_t content = lv_obj_get_content_width(this);
+        switch (lv_obj_get_style_text_align(this, LV_PART_MAIN)) {
+            case LV_TEXT_ALIGN_RIGHT: start = content - total; break;
+            case LV_TEXT_ALIGN_CENTER: start = (content - total) / 2; break;
+            default: break;
+        }
+        for (size_t i = 0; i < count; i++) {
+            positions[i] = start;
+            start += atlas.width(string[i]);
+        }
+    }
+
+    virtual void draw(lv_layer_t * layer) override {
+        lv_area_t content;
+        lv_obj_get_content_coords(this, &content);
+        lv_draw_image_dsc_t dsc;
+        lv_draw_image_dsc_init(&dsc);
+        // A8 glyphs take their color from recolor
+        dsc.recolor = lv_obj_get_style_text_color(this, LV_PART_MAIN);
+        dsc.recolor_opa = LV_OPA_COVER;
+        dsc.opa = lv_obj_get_style_text_opa(this, LV_PART_MAIN);
+        for (size_t i = 0; i < length; i++) {
+            auto glyph = atlas.glyph(text[i]);
+            if (!glyph)
+                continue;
+            lv_area_t area = {content.x1 + x[i], content.y1, content.x1 + x[i] + (int32_t)glyph->header.w - 1, content.y1 + atlas.height() - 1};
+            // skip cells outside the invalidated area
+            lv_area_t visible;
+            if (!lv_area_intersect(&visible, &area, &layer->_clip_area))
+                continue;
+            dsc.src = glyph;
+            lv_draw_image(layer, &dsc, &area);
+        }
+    }
+
+    virtual void on_destruct() override {
+        // LVGL frees our memory without running C++ destructors, so unlink
+        // from the signal and the ObservableManager here
+        std::destroy_at(&subscription);
+        std::destroy_at(&o_value);
+    }
+
+    const GlyphAtlas & atlas;
+    NumberFormat number;
+    // o_value notifies from ObservableManager::update on the UI task, and
+    // Subscribable::notify runs callbacks outside its lock, so redrawing here
+    // is fine
+    Subscription subscription{[](void * readout) { static_cast<DigitReadout*>(readout)->update(); }, this};
+    char text[MB3_TEXT_WIDGET_LENGTH] = {0};
+    int32_t x[MB3_TEXT_WIDGET_LENGTH] = {0};
+    size_t length = 0;
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief Inclusive pixel rectangle, laid out like lv_area_t
+struct DirtyRect {
+    int32_t x1;
+    int32_t y1;
+    int32_t x2;
+    int32_t y2;
+
+    bool empty() const {
+        return x2 < x1 || y2 < y1;
+    }
+
+    int64_t area() const {
+        return empty() ? 0 : (int64_t)(x2 - x1 + 1) * (y2 - y1 + 1);
+    }
+
+    bool contains(const DirtyRect & other) const {
+        return other.x1 >= x1 && other.y1 >= y1 && other.x2 <= x2 && other.y2 <= y2;
+    }
+
+    DirtyRect join(const DirtyRect & other) const {
+        return {x1 < other.x1 ? x1 : other.x1, y1 < other.y1 ? y1 : other.y1,
+                x2 > other.x2 ? x2 : other.x2, y2 > other.y2 ? y2 : other.y2};
+    }
+
+    DirtyRect intersect(const DirtyRect & other) const {
+        return {x1 > other.x1 ? x1 : other.x1, y1 > other.y1 ? y1 : other.y1,
+                x2 < other.x2 ? x2 : other.x2, y2 < other.y2 ? y2 : other.y2};
+    }
+};
+
+/// @brief A region as at most MaxRects rectangles. Adding a rectangle merges
+/// it with any it overlaps when their bounding box costs no more pixels than
+/// the two apart; once full, the pair whose merge wastes the fewest pixels is
+/// merged. The rectangles may overlap a little, never miss a pixel.
+template <size_t MaxRects = 8>
+class DirtyRegion {
+public:
+    static_assert(MaxRects >= 1, "DirtyRegion needs room for a rectangle");
+
+    void add(DirtyRect rect) {
+        if (rect.empty())
+            return;
+        // absorb whatever merges cheaply, the grown rect may absorb more
+        for (bool merged = true; merged;) {
+            merged = false;
+            for (size_t i = 0; i < count; i++) {
+                if (rects[i].contains(rect))
+                    return;
+                if (rect.join(rects[i]).area() <= rect.area() + rects[i].area()) {
+                    rect = rect.join(rects[i]);
+                    remove(i);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+        if (count < MaxRects) {
+            rects[count++] = rect;
+            return;
+        }
+
+        // full: merge the cheapest pair among the rects and the new one
+        size_t best_i = 0, best_j = MaxRects;
+        int64_t best_waste = INT64_MAX;
+        for (size_t i = 0; i <= MaxRects; i++) {
+            const DirtyRect & a = i < MaxRects ? rects[i] : rect;
+            for (size_t j = i + 1; j <= MaxRects; j++) {
+                const DirtyRect & b = j < MaxRects ? rects[j] : rect;
+                int64_t waste = a.join(b).area() - a.area() - b.area();
+                if (waste < best_waste) {
+                    best_waste = waste;
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+        }
+        DirtyRect a = rects[best_i];
+        DirtyRect b = best_j < MaxRects ? rects[best_j] : rect;
+        if (best_j < MaxRects) {
+            // the new rect takes the freed slot
+            remove(best_j);
+            rects[count++] = rect;
+        }
+        remove(best_i);
+        add(a.join(b));
+    }
+
+    template <size_t N>
+    void add(const DirtyRegion<N> & other) {
+        for (size_t i = 0; i < other.size(); i++) {
+            add(other[i]);
+        }
+    }
+
+    void clear() {
+        count = 0;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    const DirtyRect & operator[](size_t i) const {
+        return rects[i];
+    }
+
+    /// @brief Pixels covered, counting overlaps twice
+    int64_t pixels() const {
+        int64_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            total += rects[i].area();
+        }
+        return total;
+    }
+
+    DirtyRect bounds() const {
+        DirtyRect box = {0, 0, -1, -1};
+        for (size_t i = 0; i < count; i++) {
+            box = i ? box.join(rects[i]) : rects[i];
+        }
+        return box;
+    }
+
+private:
+    void remove(size_t i) {
+        rects[i] = rects[--count];
+    }
+
+    DirtyRect rects[MaxRects];
+    size_t count = 0;
+};
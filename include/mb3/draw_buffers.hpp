@@ -0,0 +1,270 @@
+#pragma once
+
+#include <lvgl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mb3/platform.hpp>
+#include <mb3/defaults.hpp>
+
+/// @brief Where a draw buffer lives
+enum class BufferPlacement {
+    Dma,        ///< internal, DMA capable: flush buffers and anything the panel reads
+    Internal,   ///< internal RAM, for small buffers drawn every frame
+    Psram,      ///< large, mostly static content
+};
+
+/// @brief Draw buffers lent to screens instead of allocated per call site.
+/// Buffers are pooled by dimensions, color format and placement. A screen
+/// borrows what it needs while it is built and everything goes back when the
+/// screen is deleted (or on @ref giveBack), so screens that are never shown
+/// together share the same memory. A free buffer of another size is reused
+/// when it is big enough, before anything new is allocated. PSRAM allocations
+/// are held to MB3_DRAW_BUFFERS_PSRAM_BUDGET, so going over the budget shows
+/// up as soon as a screen is built.
+///
+///     lv_obj_t * screen = lv_obj_create(nullptr);
+///     lv_obj_t * canvas = lv_canvas_create(screen);
+///     lv_canvas_set_draw_buf(canvas, DrawBuffers::borrow(screen, 200, 120, LV_COLOR_FORMAT_RGB565));
+class DrawBuffers {
+public:
+    /// @brief A cleared buffer, returned when owner is deleted, or kept forever
+    /// without one
+    /// @return nullptr when the heap, the budget or the entries are exhausted
+    static lv_draw_buf_t * borrow(lv_obj_t * owner, int32_t w, int32_t h, lv_color_format_t format,
+            BufferPlacement placement = BufferPlacement::Psram) {
+        uint32_t stride = LV_DRAW_BUF_STRIDE(w, format);
+        size_t size = LV_DRAW_BUF_SIZE(w, h, format);
+
+        // the same kind first, then the smallest free buffer big enough
+        Entry * entry = nullptr;
+        Entry * empty = nullptr;
+        for (auto & item : entries) {
+            if (!item.data) {
+                empty = empty ? empty : &item;
+                continue;
+            }
+            if (item.lent || item.placement != placement || item.capacity < size)
+                continue;
+            if (item.same(w, h, format)) {
+                entry = &item;
+                break;
+            }
+            if (!entry || item.capacity < entry->capacity)
+                entry = &item;
+        }
+
+        if (entry) {
+            _reused++;
+        }
+        else {
+            if (!empty) {
+                log_e("draw buffers: all %u in use", (unsigned)MB3_DRAW_BUFFERS);
+                return nullptr;
+            }
+            if (placement == BufferPlacement::Psram && MB3_DRAW_BUFFERS_PSRAM_BUDGET
+                    && memory(BufferPlacement::Psram) + size > MB3_DRAW_BUFFERS_PSRAM_BUDGET) {
+                log_e("draw buffers: %dx%d over the PSRAM budget (%u of %u bytes held)", (int)w, (int)h,
+                    (unsigned)memory(BufferPlacement::Psram), (unsigned)MB3_DRAW_BUFFERS_PSRAM_BUDGET);
+                return nullptr;
+            }
+            auto data = (uint8_t*)heap_caps_aligned_alloc(LV_DRAW_BUF_ALIGN, size, caps(placement));
+            if (!data) {
+                log_e("draw buffers: %dx%d, %u bytes", (int)w, (int)h, (unsigned)size);
+                return nullptr;
+            }
+            entry = empty;
+            entry->data = data;
+            entry->capacity = size;
+            entry->placement = placement;
+            _allocated++;
+        }
+
+        if (owner && !lends_to(owner))
+            lv_obj_add_event_cb(owner, on_owner_delete, LV_EVENT_DELETE, nullptr);
+        entry->lent = true;
+        entry->owner = owner;
+        memset(entry->data, 0, size);
+        lv_draw_buf_init(&entry->buf, w, h, format, stride, entry->data, size);
+        lv_draw_buf_set_flag(&entry->buf, LV_IMAGE_FLAGS_MODIFIABLE);
+        return &entry->buf;
+    }
+
+    /// @brief A buffer kept for the whole run, for LV_DRAW_BUF_CREATE. Its call
+    /// site can't draw without one, so running out stops here, naming it.
+    static lv_draw_buf_t & keep(const char * name, int32_t w, int32_t h, lv_color_format_t format,
+            BufferPlacement placement) {
+        lv_draw_buf_t * buf = borrow(nullptr, w, h, format, placement);
+        if (!buf) {
+            log_e("draw buffers: no buffer for %s (%dx%d)", name, (int)w, (int)h);
+            abort();
+        }
+        return *buf;
+    }
+
+    /// @brief Return one buffer before its owner goes
+    static void giveBack(lv_draw_buf_t * buf) {
+        for (auto & entry : entries) {
+            if (entry.lent && &entry.buf == buf) {
+                lv_obj_t * owner = entry.owner;
+                take_back(entry);
+                if (owner && !lends_to(owner))
+                    lv_obj_remove_event_cb(owner, on_owner_delete);
+                return;
+            }
+        }
+    }
+
+    /// @brief Return everything owner borrowed
+    static void giveBack(lv_obj_t * owner) {
+        if (!owner)
+            return;
+        take_back(owner);
+        lv_obj_remove_event_cb(owner, on_owner_delete);
+    }
+
+    /// @brief Free the buffers no screen is using
+    static void trim() {
+        for (auto & entry : entries) {
+            if (entry.data && !entry.lent) {
+                heap_caps_free(entry.data);
+                entry = Entry();
+            }
+        }
+    }
+
+    /// @brief Bytes held in a placement, lent or not
+    static size_t memory(BufferPlacement placement) {
+        size_t bytes = 0;
+        for (auto & entry : entries) {
+            if (entry.data && entry.placement == placement)
+                bytes += entry.capacity;
+        }
+        return bytes;
+    }
+
+    static size_t memory() {
+        return memory(BufferPlacement::Dma) + memory(BufferPlacement::Internal) + memory(BufferPlacement::Psram);
+    }
+
+    /// @brief Borrows served by a buffer that was already there
+    static uint32_t reused() {
+        return _reused;
+    }
+
+    static uint32_t allocated() {
+        return _allocated;
+    }
+
+    /// @brief One line per pool (dimensions, format, placement), then the totals
+    static void report() {
+        for (size_t i = 0; i < MB3_DRAW_BUFFERS; i++) {
+            const Entry & entry = entries[i];
+            if (!entry.data || first_of_pool(i) != i)
+                continue;
+            size_t count = 0, lent = 0, bytes = 0;
+            for (size_t j = i; j < MB3_DRAW_BUFFERS; j++) {
+                if (entries[j].data && entries[j].same(entry)) {
+                    count++;
+                    lent += entries[j].lent;
+                    bytes += entries[j].capacity;
+                }
+            }
+            log_i("draw buffers %ux%u cf %u %s: %u lent of %u, %u bytes", (unsigned)entry.buf.header.w,
+                (unsigned)entry.buf.header.h, (unsigned)entry.buf.header.cf, name(entry.placement),
+                (unsigned)lent, (unsigned)count, (unsigned)bytes);
+        }
+        log_i("draw buffers: %u bytes DMA, %u internal, %u PSRAM (budget %u), %u reused, %u allocated",
+            (unsigned)memory(BufferPlacement::Dma), (unsigned)memory(BufferPlacement::Internal),
+            (unsigned)memory(BufferPlacement::Psram), (unsigned)MB3_DRAW_BUFFERS_PSRAM_BUDGET,
+            (unsigned)_reused, (unsigned)_allocated);
+    }
+
+    static uint32_t caps(BufferPlacement placement) {
+        switch (placement) {
+        case BufferPlacement::Dma:
+            return MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+        case BufferPlacement::Internal:
+            return MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+        default:
+            return MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+        }
+    }
+
+    /// @brief The placement heap_caps flags ask for
+    static BufferPlacement placement(uint32_t caps) {
+        if (caps & MALLOC_CAP_SPIRAM)
+            return BufferPlacement::Psram;
+        if (caps & MALLOC_CAP_DMA)
+            return BufferPlacement::Dma;
+        return BufferPlacement::Internal;
+    }
+
+private:
+    struct Entry {
+        lv_draw_buf_t buf;
+        uint8_t * data;
+        size_t capacity;
+        BufferPlacement placement;
+        lv_obj_t * owner;
+        bool lent;
+
+        bool same(int32_t w, int32_t h, lv_color_format_t format) const {
+            return (int32_t)buf.header.w == w && (int32_t)buf.header.h == h && (lv_color_format_t)buf.header.cf == format;
+        }
+
+        bool same(const Entry & other) const {
+            return placement == other.placement && same(other.buf.header.w, other.buf.header.h, (lv_color_format_t)other.buf.header.cf);
+        }
+    };
+
+    static size_t first_of_pool(size_t index) {
+        for (size_t i = 0; i < index; i++) {
+            if (entries[i].data && entries[i].same(entries[index]))
+                return i;
+        }
+        return index;
+    }
+
+    static bool lends_to(lv_obj_t * owner) {
+        for (auto & entry : entries) {
+            if (entry.lent && entry.owner == owner)
+                return true;
+        }
+        return false;
+    }
+
+    static const char * name(BufferPlacement placement) {
+        switch (placement) {
+        case BufferPlacement::Dma:
+            return "DMA";
+        case BufferPlacement::Internal:
+            return "internal";
+        default:
+            return "PSRAM";
+        }
+    }
+
+    static void take_back(Entry & entry) {
+        lv_image_cache_drop(&entry.buf);
+        entry.lent = false;
+        entry.owner = nullptr;
+    }
+
+    static void take_back(lv_obj_t * owner) {
+        for (auto & entry : entries) {
+            if (entry.lent && entry.owner == owner)
+                take_back(entry);
+        }
+    }
+
+    // registered once per owner while it holds buffers, and removed when it
+    // gives the last one back
+    static void on_owner_delete(lv_event_t * e) {
+        take_back((lv_obj_t*)lv_event_get_target(e));
+    }
+
+    static inline Entry entries[MB3_DRAW_BUFFERS] = {};
+    static inline uint32_t _reused = 0;
+    static inline uint32_t _allocated = 0;
+};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ratio>
+
+/// @brief A Q-format number: value / 2^F, in 32 bits
+/// @tparam F fraction bits
+template <int F>
+struct Fixed {
+    static_assert(F >= 0 && F < 31, "fraction bits out of range");
+    static constexpr int fraction_bits = F;
+    static constexpr int32_t one = 1L << F;
+
+    int32_t value = 0;
+
+    static constexpr Fixed from_q(int32_t q) {
+        Fixed fixed;
+        fixed.value = q;
+        return fixed;
+    }
+
+    static constexpr Fixed from_int(int32_t i) {
+        return from_q(i * one);
+    }
+
+    constexpr float to_float() const {
+        return (float)value / one;
+    }
+
+    /// @brief rounded to the nearest integer
+    constexpr int32_t round() const {
+        return (value + (one >> 1)) >> F;
+    }
+
+    constexpr bool operator==(const Fixed & rhs) const { return value == rhs.value; }
+    constexpr bool operator!=(const Fixed & rhs) const { return value != rhs.value; }
+    constexpr bool operator<(const Fixed & rhs) const { return value < rhs.value; }
+    constexpr bool operator>(const Fixed & rhs) const { return value > rhs.value; }
+    constexpr Fixed operator+(const Fixed & rhs) const { return from_q(value + rhs.value); }
+    constexpr Fixed operator-(const Fixed & rhs) const { return from_q(value - rhs.value); }
+};
+
+/// @brief A scale given as a Q-format constant, eg QRatio<0x40, 8> = 0.25
+template <int64_t Q, int Bits>
+using QRatio = std::ratio<Q, (1LL << Bits)>;
+
+/// @brief Raw CAN value to engineering value (raw * Scale + Offset) in Q-format,
+/// with integer multiply and shift only.
+///
+///     using Coolant = FixedConversion<std::ratio<1>, std::ratio<-40>>;
+///     Coolant::value_type t = Coolant::decode(130);   // 90.0 in Q24.8
+///     Coolant::encode(t) == 130;
+///
+/// @tparam Scale std::ratio
+/// @tparam Offset std::ratio
+/// @tparam F fraction bits of the result
+/// @tparam Bits width of the raw value
+template <typename Scale, typename Offset = std::ratio<0>, int F = 8, int Bits = 16>
+struct FixedConversion {
+    static_assert(Scale::num > 0, "scale must be positive");
+    static_assert(Bits > 0 && Bits <= 32, "raw values are up to 32 bits");
+
+    using value_type = Fixed<F>;
+    using scale_ratio = Scale;
+    using offset_ratio = Offset;
+
+private:
+    // largest shift <= 24 that keeps the multiplier in 31 bits
+    static constexpr int shift() {
+        int k = 24;
+        while (k > 0 && (Scale::num << (F + k)) / Scale::den >= (1LL << 31))
+            k--;
+        return k;
+    }
+
+public:
+    static constexpr int K = shift();
+    /// @brief scale * 2^(F + K), rounded
+    static constexpr int64_t multiplier = ((Scale::num << (F + K)) + Scale::den / 2) / Scale::den;
+    /// @brief offset * 2^F, rounded
+    static constexpr int64_t bias = ((Offset::num * (1LL << F)) + (Offset::num < 0 ? -Offset::den : Offset::den) / 2) / Offset::den;
+    static constexpr uint32_t raw_max = Bits == 32 ? 0xFFFFFFFF : (1ULL << Bits) - 1;
+
+    // one raw step must be at least one LSB for decode to be invertible
+    static_assert(multiplier >= (1LL << K), "increase F: resolution is coarser than the signal's");
+    static_assert(((int64_t)raw_max * multiplier >> K) + bias < (1LL << 31), "result overflows Q-format, decrease F");
+    static_assert(bias >= -(1LL << 31), "offset overflows Q-format, decrease F");
+
+    static constexpr value_type decode(uint32_t raw) {
+        return value_type::from_q((int32_t)((((int64_t)raw * multiplier + (1LL << K >> 1)) >> K) + bias));
+    }
+
+    /// @brief The raw value whose decode is nearest to value, clamped to the raw range.
+    /// encode(decode(raw)) == raw for every raw value.
+    static constexpr uint32_t encode(value_type value) {
+        int64_t target = (int64_t)value.value - bias;
+        if (target <= 0)
+            return 0;
+        int64_t raw = ((target << K) + multiplier / 2) / multiplier;
+        if (raw > (int64_t)raw_max)
+            return raw_max;
+        // the multiplier is rounded, so step to the neighbour whose decode is closest
+        auto distance = [&](int64_t r) {
+            int64_t d = (int64_t)decode((uint32_t)r).value - value.value;
+            return d < 0 ? -d : d;
+        };
+        if (raw > 0 && distance(raw - 1) < distance(raw))
+            return raw - 1;
+        if (raw < (int64_t)raw_max && distance(raw + 1) < distance(raw))
+            return raw + 1;
+        return raw;
+    }
+
+    static constexpr float scale = (float)Scale::num / Scale::den;
+    static constexpr float offset = (float)Offset::num / Offset::den;
+};
+
+/// @brief Write value with a fixed number of decimals (rounded half away from zero)
+/// without floats or printf.
+/// @return length written, excluding the terminator
+template <int F>
+size_t fixed_format(char * buffer, size_t size, Fixed<F> value, uint8_t decimals) {
+    static constexpr uint32_t powers[] = {1, 10, 100, 1000, 10000, 100000};
+    if (size == 0)
+        return 0;
+    if (decimals > 5)
+        decimals = 5;
+    bool negative = value.value < 0;
+    uint64_t magnitude = negative ? -(int64_t)value.value : value.value;
+    uint64_t scaled = ((magnitude * powers[decimals]) + (1ULL << F >> 1)) >> F;
+    uint32_t integer = scaled / powers[decimals];
+    uint32_t fraction = scaled % powers[decimals];
+
+    char digits[24];
+    size_t n = 0;
+    for (uint8_t i = 0; i < decimals; i++) {
+        digits[n++] = '0' + fraction % 10;
+        fraction /= 10;
+    }
+    if (decimals)
+        digits[n++] = '.';
+    do {
+        digits[n++] = '0' + integer % 10;
+        integer /= 10;
+    } while (integer);
+    if (negative && scaled)
+        digits[n++] = '-';
+
+    size_t length = 0;
+    while (n && length + 1 < size) {
+        buffer[length++] = digits[--n];
+    }
+    buffer[length] = '\0';
+    return length;
+}
@@ -0,0 +1,360 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <mb3/platform.hpp>
+#include <mb3/subscription.hpp>
+
+/// @brief Sizes of one signal's history. The defaults keep 256 raw samples
+/// and four levels of 256 buckets (100 ms, 500 ms, 2.5 s, 12.5 s), covering
+/// roughly 25 s, 2 min, 10 min and 50 min, in about 22 KB of PSRAM.
+struct HistoryConfig {
+    uint16_t samples = 256;
+    uint16_t buckets = 256;
+    uint32_t bucket_ms = 100;
+    uint8_t levels = 4;
+    /// @brief Each level's buckets are this many times longer than the previous level's
+    uint8_t factor = 5;
+};
+
+/// @brief One chart point: everything recorded in [time_ms, time_ms + step)
+struct HistoryPoint {
+    uint32_t time_ms;
+    float min;
+    float max;
+    float mean;
+    /// @brief samples merged, 0 for a gap
+    uint32_t count;
+};
+
+/// @brief Fixed-capacity history of one signal, kept in PSRAM: raw timestamped
+/// samples plus min/max/mean decimation levels updated incrementally as samples
+/// arrive, so @ref fetch costs O(points) whatever the time span.
+/// Recording happens in the task that updates the signal and fetching in the
+/// UI task; a sequence counter lets fetch retry instead of locking.
+class SignalHistory {
+public:
+    static constexpr uint8_t MAX_LEVELS = 6;
+
+    inline SignalHistory(const char * name, const HistoryConfig & config = HistoryConfig());
+    virtual inline ~SignalHistory();
+
+    SignalHistory(const SignalHistory &) = delete;
+    SignalHistory & operator=(const SignalHistory &) = delete;
+
+    void record(float value) {
+        record(value, now_ms());
+    }
+
+    void record(float value, uint32_t time_ms) {
+        if (!storage || std::isnan(value))
+            return;
+        uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+        _sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        Sample & sample = samples[sample_head];
+        sample.time_ms = time_ms;
+        sample.value = value;
+        sample_head = (sample_head + 1) % config.samples;
+        if (sample_count < config.samples)
+            sample_count++;
+
+        for (uint8_t i = 0; i < config.levels; i++) {
+            Level & level = levels[i];
+            Bucket * bucket = level.count ? &level.ring[(level.head + config.buckets - 1) % config.buckets] : nullptr;
+            if (!bucket || (int32_t)(time_ms - bucket->start_ms) >= (int32_t)level.duration_ms) {
+                bucket = &level.ring[level.head];
+                level.head = (level.head + 1) % config.buckets;
+                if (level.count < config.buckets)
+                    level.count++;
+                bucket->start_ms = time_ms - (time_ms % level.duration_ms);
+                bucket->min = bucket->max = value;
+                bucket->sum = 0.f;
+                bucket->count = 0;
+            }
+            if (value < bucket->min)
+                bucket->min = value;
+            if (value > bucket->max)
+                bucket->max = value;
+            bucket->sum += value;
+            bucket->count++;
+        }
+
+        _sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    /// @brief Fill points evenly spaced over the last duration_ms, up to and
+    /// including end_ms (now by default), oldest first. Points with no samples
+    /// have count 0.
+    /// @return points filled, 0 if there's nothing recorded
+    size_t fetch(uint32_t duration_ms, HistoryPoint * out, size_t points) const {
+        return fetch(duration_ms, out, points, now_ms());
+    }
+
+    size_t fetch(uint32_t duration_ms, HistoryPoint * out, size_t points, uint32_t end_ms) const {
+        if (!storage || points == 0 || duration_ms == 0)
+            return 0;
+        uint32_t step = duration_ms / points ? duration_ms / points : 1;
+        uint32_t start_ms = end_ms + 1 - (step * points);
+
+        // the coarsest level that still resolves a step, and reaches back far enough
+        int level = -1;
+        for (int i = 0; i < config.levels; i++) {
+            if (levels[i].duration_ms > step)
+                break;
+            level = i;
+        }
+        while (level < config.levels - 1 && !covers(level, duration_ms)) {
+            level++;
+        }
+
+        // a sample recorded meanwhile means a retry; give up on a consistent
+        // read after a few, a chart glitch beats stalling the UI
+        for (int attempt = 0; ; attempt++) {
+            uint32_t sequence = _sequence.load(std::memory_order_acquire);
+            reset_points(out, points, start_ms, step);
+            _scanned = level < 0 ? scan_samples(out, points, start_ms, step) : scan_level(levels[level], out, points, start_ms, step);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            bool consistent = !(sequence & 1) && _sequence.load(std::memory_order_relaxed) == sequence;
+            if (consistent || attempt >= 8)
+                break;
+        }
+        for (size_t i = 0; i < points; i++) {
+            if (out[i].count)
+                out[i].mean /= out[i].count;
+        }
+        return points;
+    }
+
+    /// @brief PSRAM used by this history
+    size_t memory() const {
+        return storage ? size_for(config) : 0;
+    }
+
+    static size_t size_for(const HistoryConfig & config) {
+        return (config.samples * sizeof(Sample)) + (config.levels * config.buckets * sizeof(Bucket));
+    }
+
+    /// @brief Bucket length of a level, for picking chart spans that line up
+    uint32_t level_duration(uint8_t level) const {
+        return levels[level].duration_ms;
+    }
+
+    /// @brief Samples or buckets the last fetch walked through
+    size_t last_scanned() const {
+        return _scanned;
+    }
+
+    const char * name() const {
+        return _name;
+    }
+
+    /// @brief Time source, for tests and replays
+    static inline int64_t (*clock)() = esp_timer_get_time;
+
+private:
+    friend class HistoryStore;
+
+    struct Sample {
+        uint32_t time_ms;
+        float value;
+    };
+
+    struct Bucket {
+        uint32_t start_ms;
+        float min;
+        float max;
+        float sum;
+        uint32_t count;
+    };
+
+    struct Level {
+        Bucket * ring;
+        uint32_t duration_ms;
+        uint16_t head;
+        uint16_t count;
+    };
+
+    static uint32_t now_ms() {
+        return (uint32_t)(clock() / 1000);
+    }
+
+    /// @brief Whether a level (-1 for raw samples) still holds duration_ms,
+    /// or everything recorded so far
+    bool covers(int level, uint32_t duration_ms) const {
+        if (level < 0) {
+            if (sample_count < config.samples)
+                return true;
+            uint32_t newest = samples[(sample_head + config.samples - 1) % config.samples].time_ms;
+            return newest - samples[sample_head].time_ms >= duration_ms;
+        }
+        return levels[level].count < config.buckets || levels[level].duration_ms * (config.buckets - 1) >= duration_ms;
+    }
+
+    static void reset_points(HistoryPoint * out, size_t points, uint32_t start_ms, uint32_t step) {
+        for (size_t i = 0; i < points; i++) {
+            out[i] = {start_ms + (uint32_t)(i * step), INFINITY, -INFINITY, 0.f, 0};
+        }
+    }
+
+    static void merge(HistoryPoint * out, size_t points, uint32_t start_ms, uint32_t step, uint32_t time_ms, float min, float max, float sum, uint32_t count) {
+        int32_t offset = (int32_t)(time_ms - start_ms);
+        size_t i = offset < 0 ? 0 : offset / step;
+        if (i >= points)
+            return;
+        HistoryPoint & point = out[i];
+        if (min < point.min)
+            point.min = min;
+        if (max > point.max)
+            point.max = max;
+        point.mean += sum;
+        point.count += count;
+    }
+
+    size_t scan_samples(HistoryPoint * out, size_t points, uint32_t start_ms, uint32_t step) const {
+        size_t scanned = 0;
+        uint32_t end_ms = start_ms + (step * points);
+        for (uint16_t k = 0; k < sample_count; k++) {
+            const Sample & sample = samples[(sample_head + config.samples - 1 - k) % config.samples];
+            scanned++;
+            if ((int32_t)(sample.time_ms - start_ms) < 0)
+                break;
+            if ((int32_t)(sample.time_ms - end_ms) >= 0)
+                continue;
+            merge(out, points, start_ms, step, sample.time_ms, sample.value, sample.value, sample.value, 1);
+        }
+        return scanned;
+    }
+
+    size_t scan_level(const Level & level, HistoryPoint * out, size_t points, uint32_t start_ms, uint32_t step) const {
+        size_t scanned = 0;
+        uint32_t end_ms = start_ms + (step * points);
+        for (uint16_t k = 0; k < level.count; k++) {
+            const Bucket & bucket = level.ring[(level.head + config.buckets - 1 - k) % config.buckets];
+            scanned++;
+            if ((int32_t)(bucket.start_ms + level.duration_ms - start_ms) <= 0)
+                break;
+            if ((int32_t)(bucket.start_ms - end_ms) >= 0)
+                continue;
+            merge(out, points, start_ms, step, bucket.start_ms, bucket.min, bucket.max, bucket.sum, bucket.count);
+        }
+        return scanned;
+    }
+
+    const char * _name;
+    HistoryConfig config;
+    uint8_t * storage = nullptr;
+    Sample * samples = nullptr;
+    Level levels[MAX_LEVELS] = {};
+    uint16_t sample_head = 0;
+    uint16_t sample_count = 0;
+    std::atomic<uint32_t> _sequence{0};
+    mutable size_t _scanned = 0;
+
+    SignalHistory * store_next = nullptr;
+};
+
+/// @brief Every signal history, for memory reports
+class HistoryStore {
+public:
+    template <typename Visitor>
+    static void each(Visitor visit) {
+        for (auto history = head; history; history = history->store_next) {
+            visit(*history);
+        }
+    }
+
+    static size_t size() {
+        return count;
+    }
+
+    /// @brief PSRAM used by all histories
+    static size_t memory() {
+        size_t bytes = 0;
+        each([&bytes](SignalHistory & history) { bytes += history.memory(); });
+        return bytes;
+    }
+
+    static void report() {
+        each([](SignalHistory & history) {
+            log_i("history %s: %u bytes", history.name(), (unsigned)history.memory());
+        });
+        log_i("history: %u signals, %u bytes", (unsigned)count, (unsigned)memory());
+    }
+
+private:
+    friend class SignalHistory;
+
+    static void add(SignalHistory * history) {
+        history->store_next = head;
+        head = history;
+        count++;
+    }
+
+    static void remove(SignalHistory * history) {
+        for (SignalHistory ** link = &head; *link; link = &(*link)->store_next) {
+            if (*link == history) {
+                *link = history->store_next;
+                count--;
+                return;
+            }
+        }
+    }
+
+    static inline SignalHistory * head = nullptr;
+    static inline size_t count = 0;
+};
+
+SignalHistory::SignalHistory(const char * name, const HistoryConfig & config) : _name(name), config(config) {
+    if (this->config.levels > MAX_LEVELS)
+        this->config.levels = MAX_LEVELS;
+    if (this->config.samples && this->config.buckets > 1)
+        storage = (uint8_t*)heap_caps_calloc(1, size_for(this->config), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!storage) {
+        log_e("%s history: %u bytes", name, (unsigned)size_for(this->config));
+    } else {
+        samples = (Sample*)storage;
+        auto buckets = (Bucket*)(storage + (this->config.samples * sizeof(Sample)));
+        uint32_t duration = this->config.bucket_ms ? this->config.bucket_ms : 1;
+        for (uint8_t i = 0; i < this->config.levels; i++) {
+            levels[i].ring = buckets + (i * this->config.buckets);
+            levels[i].duration_ms = duration;
+            duration *= this->config.factor > 1 ? this->config.factor : 2;
+        }
+    }
+    HistoryStore::add(this);
+}
+
+SignalHistory::~SignalHistory() {
+    HistoryStore::remove(this);
+    heap_caps_free(storage);
+}
+
+/// @brief A @ref SignalHistory that records its signal whenever it changes.
+///
+///     TSignalHistory<CanTableSignal> rpm_history("rpm", &engine[RPM]);
+///     HistoryPoint points[240];
+///     rpm_history.fetch(10 * 60 * 1000, points, 240);
+template <typename DataType>
+class TSignalHistory : public SignalHistory {
+public:
+    TSignalHistory(const char * name, DataType * p_value, const HistoryConfig & config = HistoryConfig()) :
+        SignalHistory(name, config),
+        p_value(p_value)
+    {
+        static_cast<Subscribable*>(p_value)->subscribe(subscription);
+    }
+
+    virtual ~TSignalHistory() override = default;
+
+    DataType * p_value;
+
+private:
+    Subscription subscription{[](void * history) {
+        auto self = static_cast<TSignalHistory*>(history);
+        self->record((float)*self->p_value);
+    }, this};
+};
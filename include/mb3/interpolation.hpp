@@ -0,0 +1,218 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <mb3/platform.hpp>
+#include <mb3/observable.hpp>
+
+enum class Interpolation : uint8_t {
+    /// @brief Glide from the shown value to each new sample over one sample interval
+    Linear,
+    /// @brief Follow the samples with a critically damped spring, no overshoot
+    Damped,
+};
+
+/// @brief Observable that turns a signal's samples into smooth motion at the
+/// display rate. Samples are timestamped as the signal changes; every
+/// @ref ObservableManager::update in between produces an interpolated value.
+/// While moving it re-queues itself on the dirty list, so a frame costs
+/// O(animating observables), and once it reaches the target it stops:
+/// idle observables neither update nor notify.
+///
+///     TInterpolatedObservable<CanTableSignal> o_rpm(&engine[RPM], Interpolation::Damped);
+///     o_rpm.setExtrapolation(0.5f).setRange(0.f, 8000.f);
+///     TObservable<float, const float> needle(o_rpm.value_ptr(), o_rpm);
+template <typename DataType>
+class TInterpolatedObservable : public IObservable {
+public:
+    TInterpolatedObservable(DataType * p_value, Interpolation mode = Interpolation::Linear) : p_value(p_value), mode(mode) {
+        target = last_value = displayValue = read();
+        if constexpr (std::is_base_of<Subscribable, DataType>::value) {
+            static_cast<Subscribable*>(p_value)->subscribe(sample_subscription);
+            setNotified();
+        }
+    }
+
+    virtual ~TInterpolatedObservable() override = default;
+
+    /// @brief Keep moving along the signal's slope for up to this many sample
+    /// intervals after the last sample, rather than stopping on it
+    TInterpolatedObservable & setExtrapolation(float intervals) {
+        extrapolation = intervals;
+        return *this;
+    }
+
+    /// @brief Clamp interpolated and extrapolated values
+    TInterpolatedObservable & setRange(float min, float max) {
+        range_min = min;
+        range_max = max;
+        return *this;
+    }
+
+    /// @brief Close enough to the target to stop animating
+    TInterpolatedObservable & setResolution(float resolution) {
+        this->resolution = resolution;
+        return *this;
+    }
+
+    /// @brief Damped response time, by default the sample interval
+    TInterpolatedObservable & setResponse(uint32_t response_us) {
+        this->response_us = response_us;
+        return *this;
+    }
+
+    virtual void update() override {
+        uint32_t now = (uint32_t)clock();
+        if (fresh.exchange(false, std::memory_order_acquire)) {
+            sample(read(), sampled_at.load(std::memory_order_relaxed), now);
+        } else if (!notified) {
+            float value = read();
+            if (value != last_value)
+                sample(value, now, now);
+        }
+        if (animating) {
+            float value = mode == Interpolation::Linear ? linear(now) : damped(now);
+            if (value != displayValue) {
+                displayValue = value;
+                _hasChanged = true;
+                notify();
+            }
+            // polled observables come back anyway
+            if (animating && notified)
+                markDirty();
+        }
+    }
+
+    float get() const {
+        return displayValue;
+    }
+
+    const float * value_ptr() const {
+        return &displayValue;
+    }
+
+    bool isAnimating() const {
+        return animating;
+    }
+
+    /// @brief Estimated time between samples
+    uint32_t interval() const {
+        return interval_us;
+    }
+
+    DataType * p_value;
+    float displayValue;
+
+    /// @brief Time source, for tests and replays
+    static inline int64_t (*clock)() = esp_timer_get_time;
+
+private:
+    float read() {
+        return (float)*p_value;
+    }
+
+    /// @brief Samples further apart than this are a stalled signal, not the rate
+    static constexpr uint32_t MAX_INTERVAL_US = 1000000;
+
+    void sample(float value, uint32_t at, uint32_t now) {
+        uint32_t gap = at - last_at;
+        if (sampled && gap > 0 && gap < MAX_INTERVAL_US) {
+            interval_us = interval_us ? ((interval_us * 3) + gap) / 4 : gap;
+            slope = (value - last_value) / gap;
+        } else {
+            slope = 0.f;
+        }
+        last_value = value;
+        last_at = at;
+        sampled = true;
+
+        from = displayValue;
+        target = value;
+        if (!animating)
+            last_frame = now;
+        animating = true;
+    }
+
+    float clamp(float value) const {
+        return value < range_min ? range_min : value > range_max ? range_max : value;
+    }
+
+    /// @brief How far along the slope to extrapolate, in us
+    float horizon(float elapsed) const {
+        float limit = extrapolation * interval_us;
+        return elapsed < 0.f ? 0.f : elapsed < limit ? elapsed : limit;
+    }
+
+    float linear(uint32_t now) {
+        if (!interval_us) {
+            animating = false;
+            return clamp(target);
+        }
+        // one interval behind the samples, so there's always a next one to head for
+        float elapsed = (int32_t)(now - last_at);
+        float progress = elapsed / interval_us;
+        if (progress < 1.f)
+            return clamp(from + ((target - from) * (progress < 0.f ? 0.f : progress)));
+        if (progress >= 1.f + extrapolation)
+            animating = false;
+        return clamp(target + (slope * horizon(elapsed - interval_us)));
+    }
+
+    float damped(uint32_t now) {
+        float dt = (int32_t)(now - last_frame) * 1e-6f;
+        last_frame = now;
+        if (dt > 0.1f)
+            dt = 0.1f;
+        uint32_t response = response_us ? response_us : interval_us;
+        if (!response) {
+            animating = false;
+            velocity = 0.f;
+            return clamp(target);
+        }
+        float goal = clamp(target + (slope * horizon((int32_t)(now - last_at))));
+        // exact step of x'' = w^2 (goal - x) - 2w x', stable for any dt
+        float omega = 4e6f / response;
+        float offset = displayValue - goal;
+        float decay = std::exp(-omega * dt);
+        float temp = (velocity + (omega * offset)) * dt;
+        float position = goal + ((offset + temp) * decay);
+        velocity = (velocity - (omega * temp)) * decay;
+
+        bool extrapolating = extrapolation > 0.f && (int32_t)(now - last_at) < extrapolation * interval_us;
+        if (!extrapolating && std::fabs(position - goal) < resolution && std::fabs(velocity) * response * 1e-6f < resolution) {
+            animating = false;
+            velocity = 0.f;
+            return goal;
+        }
+        return clamp(position);
+    }
+
+    void on_sample() {
+        sampled_at.store((uint32_t)clock(), std::memory_order_relaxed);
+        fresh.store(true, std::memory_order_release);
+        markDirty();
+    }
+
+    Interpolation mode;
+    bool animating = false;
+    bool sampled = false;
+    float from;
+    float target;
+    float last_value;
+    float slope = 0.f;
+    float velocity = 0.f;
+    float extrapolation = 0.f;
+    float resolution = 0.001f;
+    float range_min = -INFINITY;
+    float range_max = INFINITY;
+    uint32_t last_at = 0;
+    uint32_t last_frame = 0;
+    uint32_t interval_us = 0;
+    uint32_t response_us = 0;
+
+    // written from the task that updates the signal
+    std::atomic<uint32_t> sampled_at{0};
+    std::atomic<bool> fresh{false};
+    Subscription sample_subscription{[](void * observable) { static_cast<TInterpolatedObservable*>(observable)->on_sample(); }, this};
+};
@@ -0,0 +1,608 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <memory>
+#include <bitset>
+#include <functional>
+#include <algorithm>
+#include <mb3/platform.hpp>
+#include <mb3/defaults.hpp>
+#include <mb3/can.hpp>
+
+#define J1939_PGN_REQUEST       0xEA00
+#define J1939_PGN_ADDRESS_CLAIM 0xEE00
+#define J1939_PGN_TP_CM         0xEC00
+#define J1939_PGN_TP_DT         0xEB00
+
+#define J1939_ADDRESS_GLOBAL    0xFF
+#define J1939_ADDRESS_NULL      0xFE
+
+#define J1939_TP_CM_RTS         16
+#define J1939_TP_CM_CTS         17
+#define J1939_TP_CM_EOMA        19
+#define J1939_TP_CM_BAM         32
+#define J1939_TP_CM_ABORT       255
+
+// Largest transfer the transport protocol can describe, 255 packets of 7 bytes
+#define J1939_TP_SIZE_LIMIT     1785
+
+// TP.Conn_Abort reasons (J1939-21)
+#define J1939_ABORT_BUSY        1   // already in a session, can't support another
+#define J1939_ABORT_RESOURCES   2   // no room for the transfer
+#define J1939_ABORT_TIMEOUT     3
+#define J1939_ABORT_SEQUENCE    7   // bad sequence number
+#define J1939_ABORT_SIZE        9   // larger than J1939_TP_SIZE_LIMIT
+#define J1939_ABORT_OTHER       250 // none of the listed reasons
+
+/// @brief Fields packed into a 29-bit J1939 identifier
+struct J1939Id {
+    uint8_t priority = 6;
+    uint32_t pgn = 0;
+    uint8_t source = J1939_ADDRESS_NULL;
+    uint8_t destination = J1939_ADDRESS_GLOBAL;
+
+    /// @brief PDU1 (PF < 240) PGNs carry a destination address in PS
+    static constexpr bool is_pdu1(uint32_t pgn) {
+        return ((pgn >> 8) & 0xFF) < 240;
+    }
+
+    static constexpr J1939Id parse(uint32_t identifier) {
+        J1939Id id;
+        id.priority = (identifier >> 26) & 0x7;
+        id.source = identifier & 0xFF;
+        uint32_t pf = (identifier >> 16) & 0xFF;
+        uint32_t ps = (identifier >> 8) & 0xFF;
+        uint32_t dp = (identifier >> 24) & 0x3;
+        if (pf < 240) {
+            id.pgn = (dp << 16) | (pf << 8);
+            id.destination = ps;
+        } else {
+            id.pgn = (dp << 16) | (pf << 8) | ps;
+            id.destination = J1939_ADDRESS_GLOBAL;
+        }
+        return id;
+    }
+
+    constexpr uint32_t identifier() const {
+        if (is_pdu1(pgn)) {
+            return ((uint32_t)priority << 26) | ((pgn & 0x3FF00) << 8) | ((uint32_t)destination << 8) | source;
+        } else {
+            return ((uint32_t)priority << 26) | ((pgn & 0x3FFFF) << 8) | source;
+        }
+    }
+};
+
+/// @brief A complete J1939 message, either a single frame or a reassembled transfer
+struct J1939Message {
+    J1939Id id;
+    const uint8_t * data = nullptr;
+    size_t size = 0;
+    int64_t timestamp = 0;
+};
+
+/// @brief Something that consumes a PGN's payload
+class IJ1939Decoder {
+public:
+    virtual ~IJ1939Decoder() = default;
+    virtual void decode(const J1939Message & message) = 0;
+};
+
+/// @brief Feeds single-frame PGNs into a regular @ref CanFrame, whose id() is the PGN
+class J1939FrameDecoder : public IJ1939Decoder {
+public:
+    J1939FrameDecoder(std::shared_ptr<ICanFrame> frame) : frame(frame) { }
+
+    virtual void decode(const J1939Message & message) override {
+        memcpy(frame->data(), message.data, std::min(message.size, frame->size()));
+        frame->update();
+    }
+
+    std::shared_ptr<ICanFrame> frame;
+};
+
+/// @brief Calls a function for every message of a PGN, mostly for large payloads
+class J1939FunctionDecoder : public IJ1939Decoder {
+public:
+    using Function = std::function<void(const J1939Message &)>;
+
+    J1939FunctionDecoder(const Function & function) : function(function) { }
+
+    virtual void decode(const J1939Message & message) override {
+        function(message);
+    }
+
+    Function function;
+};
+
+/// @brief PGN (+ optional source address) to decoder lookup.
+/// Registrations are collected into a flat open-addressing table the first time
+/// a lookup happens, so dispatch is one or two probes regardless of how many
+/// source addresses are on the bus.
+class J1939Dispatch {
+public:
+    static constexpr uint16_t ANY_SOURCE = 0x100;
+
+    void add(uint32_t pgn, std::shared_ptr<IJ1939Decoder> decoder, uint16_t source = ANY_SOURCE) {
+        registrations.push_back({key(pgn, source), decoder});
+        dirty = true;
+    }
+
+    /// @brief Source-specific decoders take precedence over ANY_SOURCE ones
+    /// @return number of decoders the message was given to
+    size_t dispatch(const J1939Message & message) {
+        if (dirty)
+            build();
+        const Slot * slot = find(key(message.id.pgn, message.id.source));
+        if (slot == nullptr)
+            slot = find(key(message.id.pgn, ANY_SOURCE));
+        if (slot == nullptr)
+            return 0;
+        for (uint16_t i = slot->first; i < slot->first + slot->count; i++) {
+            decoders[i]->decode(message);
+        }
+        return slot->count;
+    }
+
+    bool has(uint32_t pgn, uint8_t source) {
+        if (dirty)
+            build();
+        return find(key(pgn, source)) || find(key(pgn, ANY_SOURCE));
+    }
+
+    size_t size() const {
+        return registrations.size();
+    }
+
+    void build() {
+        std::stable_sort(registrations.begin(), registrations.end(), [](const Registration & a, const Registration & b) {
+            return a.key < b.key;
+        });
+        decoders.clear();
+        decoders.reserve(registrations.size());
+        for (auto const & registration : registrations) {
+            decoders.push_back(registration.decoder.get());
+        }
+
+        size_t capacity = 8;
+        while (capacity < registrations.size() * 2)
+            capacity <<= 1;
+        slots.assign(capacity, Slot{});
+        mask = capacity - 1;
+        shift = 32;
+        while ((1u << (32 - shift)) < capacity)
+            shift--;
+
+        for (size_t i = 0; i < registrations.size(); ) {
+            uint32_t k = registrations[i].key;
+            size_t first = i;
+            while (i < registrations.size() && registrations[i].key == k)
+                i++;
+            size_t index = hash(k);
+            while (slots[index].key != EMPTY)
+                index = (index + 1) & mask;
+            slots[index] = {k, (uint16_t)first, (uint16_t)(i - first)};
+        }
+        dirty = false;
+    }
+
+private:
+    static constexpr uint32_t EMPTY = 0xFFFFFFFF;
+
+    struct Registration {
+        uint32_t key;
+        std::shared_ptr<IJ1939Decoder> decoder;
+    };
+
+    struct Slot {
+        uint32_t key = EMPTY;
+        uint16_t first = 0;
+        uint16_t count = 0;
+    };
+
+    static constexpr uint32_t key(uint32_t pgn, uint16_t source) {
+        return ((pgn & 0x3FFFF) << 9) | (source & 0x1FF);
+    }
+
+    size_t hash(uint32_t k) const {
+        return ((k * 0x9E3779B1u) >> shift) & mask;
+    }
+
+    const Slot * find(uint32_t k) const {
+        size_t index = hash(k);
+        while (slots[index].key != EMPTY) {
+            if (slots[index].key == k)
+                return &slots[index];
+            index = (index + 1) & mask;
+        }
+        return nullptr;
+    }
+
+    std::vector<Registration> registrations;
+    std::vector<IJ1939Decoder *> decoders;
+    std::vector<Slot> slots = std::vector<Slot>(1);
+    size_t mask = 0;
+    unsigned shift = 31;
+    bool dirty = false;
+};
+
+/// @brief Who holds which source address, from address claim (PGN 60928) traffic
+class J1939AddressTable {
+public:
+    using ChangeCallback = std::function<void(uint8_t address, uint64_t name, bool claimed)>;
+
+    /// @brief Process an address claim, lower NAMEs win contested addresses
+    void claim(uint8_t address, uint64_t name) {
+        // a node moving to a new address (or failing to claim one) releases its old one
+        for (size_t a = 0; a < J1939_ADDRESS_NULL; a++) {
+            if (claimed[a] && names[a] == name && a != address) {
+                release(a);
+            }
+        }
+        if (address >= J1939_ADDRESS_NULL)
+            return;
+        if (claimed[address]) {
+            if (names[address] == name || names[address] < name)
+                return;
+        }
+        claimed[address] = true;
+        names[address] = name;
+        if (on_change)
+            on_change(address, name, true);
+    }
+
+    void release(uint8_t address) {
+        if (address >= J1939_ADDRESS_NULL || !claimed[address])
+            return;
+        claimed[address] = false;
+        if (on_change)
+            on_change(address, names[address], false);
+        names[address] = 0;
+    }
+
+    bool is_claimed(uint8_t address) const {
+        return address < J1939_ADDRESS_NULL && claimed[address];
+    }
+
+    uint64_t name(uint8_t address) const {
+        return is_claimed(address) ? names[address] : 0;
+    }
+
+    /// @return the address currently held by name, or J1939_ADDRESS_NULL
+    uint8_t address(uint64_t name) const {
+        for (size_t a = 0; a < J1939_ADDRESS_NULL; a++) {
+            if (claimed[a] && names[a] == name)
+                return a;
+        }
+        return J1939_ADDRESS_NULL;
+    }
+
+    size_t count() const {
+        return claimed.count();
+    }
+
+    ChangeCallback on_change;
+
+private:
+    uint64_t names[J1939_ADDRESS_NULL] = {0};
+    std::bitset<J1939_ADDRESS_NULL> claimed;
+};
+
+/// @brief Transport protocol (TP.CM/TP.DT) reassembly for BAM and CMDT transfers.
+/// CMDT transfers between other nodes are followed passively; ones addressed to
+/// `address` are answered with CTS/EoMA through `transmit`.
+class J1939Transport {
+public:
+    static constexpr int64_t T1_US = 750000;   // between TP.DT packets
+    static constexpr int64_t T2_US = 1250000;  // after a CTS
+
+    using Transmit = std::function<bool(const twai_message_t &)>;
+    using Complete = std::function<void(const J1939Message &)>;
+
+    J1939Transport(uint8_t address = MB3_J1939_ADDRESS) : address(address) { }
+
+    ~J1939Transport() {
+        if (buffers)
+            heap_caps_free(buffers);
+    }
+
+    J1939Transport(const J1939Transport &) = delete;
+    J1939Transport & operator=(const J1939Transport &) = delete;
+
+    void connection_management(const J1939Id & id, const uint8_t * data, int64_t timestamp) {
+        uint32_t pgn = data[5] | (data[6] << 8) | ((uint32_t)data[7] << 16);
+        switch (data[0]) {
+            case J1939_TP_CM_BAM:
+            case J1939_TP_CM_RTS: {
+                bool bam = data[0] == J1939_TP_CM_BAM;
+                uint16_t size = data[1] | (data[2] << 8);
+                uint8_t packets = data[3];
+                if (bam && id.destination != J1939_ADDRESS_GLOBAL)
+                    return;
+                uint8_t reason = size > J1939_TP_SIZE_LIMIT ? J1939_ABORT_SIZE
+                    : size > MB3_J1939_TP_MAX_SIZE ? J1939_ABORT_RESOURCES
+                    : size < 9 || packets != (size + 6) / 7 ? J1939_ABORT_OTHER
+                    : 0;
+                if (reason) {
+                    malformed++;
+                    if (!bam && id.destination == address)
+                        abort(id.destination, id.source, pgn, reason);
+                    return;
+                }
+                Session * session = open(id.source, id.destination);
+                if (session == nullptr) {
+                    dropped++;
+                    if (!bam && id.destination == address)
+                        abort(id.destination, id.source, pgn, J1939_ABORT_BUSY);
+                    return;
+                }
+                session->bam = bam;
+                session->priority = id.priority;
+                session->pgn = pgn;
+                session->size = size;
+                session->packets = packets;
+                session->next = 1;
+                session->max_per_cts = bam ? 0xFF : data[4];
+                session->deadline = timestamp + T1_US;
+                if (!bam && id.destination == address) {
+                    clear_to_send(*session);
+                    session->deadline = timestamp + T2_US;
+                }
+            } break;
+            case J1939_TP_CM_CTS: {
+                // CTS goes back towards the originator, so the session is keyed the other way around
+                Session * session = find(id.destination, id.source);
+                if (session)
+                    session->deadline = timestamp + T2_US;
+            } break;
+            case J1939_TP_CM_EOMA:
+                break;
+            case J1939_TP_CM_ABORT: {
+                Session * session = find(id.source, id.destination);
+                if (session == nullptr)
+                    session = find(id.destination, id.source);
+                if (session) {
+                    session->active = false;
+                    aborted++;
+                }
+            } break;
+        }
+    }
+
+    void data_transfer(const J1939Id & id, const uint8_t * data, int64_t timestamp) {
+        Session * session = find(id.source, id.destination);
+        if (session == nullptr)
+            return;
+        uint8_t sequence = data[0];
+        if (sequence != session->next) {
+            sequence_errors++;
+            session->active = false;
+            if (!session->bam && session->destination == address)
+                abort(session->destination, session->source, session->pgn, J1939_ABORT_SEQUENCE);
+            return;
+        }
+        size_t position = (size_t)(sequence - 1) * 7;
+        memcpy(session->buffer + position, data + 1, std::min<size_t>(7, session->size - position));
+        session->next++;
+        session->deadline = timestamp + T1_US;
+
+        if (sequence == session->packets) {
+            session->active = false;
+            completed++;
+            if (!session->bam && session->destination == address)
+                end_of_message(*session);
+            if (on_complete) {
+                J1939Message message;
+                message.id.priority = session->priority;
+                message.id.pgn = session->pgn;
+                message.id.source = session->source;
+                message.id.destination = session->destination;
+                message.data = session->buffer;
+                message.size = session->size;
+                message.timestamp = timestamp;
+                on_complete(message);
+            }
+        } else if (!session->bam && session->destination == address && sequence == session->window_end) {
+            clear_to_send(*session);
+            session->deadline = timestamp + T2_US;
+        }
+    }
+
+    /// @brief Expire stalled transfers
+    void poll(int64_t now) {
+        for (auto & session : sessions) {
+            if (session.active && now > session.deadline) {
+                session.active = false;
+                timeouts++;
+                if (!session.bam && session.destination == address)
+                    abort(session.destination, session.source, session.pgn, J1939_ABORT_TIMEOUT);
+            }
+        }
+    }
+
+    size_t active() const {
+        size_t n = 0;
+        for (auto const & session : sessions)
+            n += session.active;
+        return n;
+    }
+
+    uint8_t address;
+    Transmit transmit;
+    Complete on_complete;
+
+    uint32_t completed = 0;
+    uint32_t aborted = 0;
+    uint32_t timeouts = 0;
+    uint32_t sequence_errors = 0;
+    uint32_t malformed = 0;
+    uint32_t dropped = 0;
+
+private:
+    struct Session {
+        bool active = false;
+        bool bam = false;
+        uint8_t priority = 7;
+        uint8_t source = 0;
+        uint8_t destination = 0;
+        uint8_t packets = 0;
+        uint8_t next = 1;
+        uint8_t window_end = 0;
+        uint8_t max_per_cts = 0xFF;
+        uint16_t size = 0;
+        uint32_t pgn = 0;
+        int64_t deadline = 0;
+        uint8_t * buffer = nullptr;
+    };
+
+    Session * find(uint8_t source, uint8_t destination) {
+        for (auto & session : sessions) {
+            if (session.active && session.source == source && session.destination == destination)
+                return &session;
+        }
+        return nullptr;
+    }
+
+    /// @brief A new announcement from the same pair replaces the old transfer
+    Session * open(uint8_t source, uint8_t destination) {
+        if (buffers == nullptr) {
+            buffers = (uint8_t*)heap_caps_calloc(MB3_J1939_TP_SESSIONS, MB3_J1939_TP_MAX_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            if (buffers == nullptr) {
+                log_e("Error allocating %d bytes", MB3_J1939_TP_SESSIONS * MB3_J1939_TP_MAX_SIZE);
+                return nullptr;
+            }
+            for (size_t i = 0; i < MB3_J1939_TP_SESSIONS; i++) {
+                sessions[i].buffer = buffers + i * MB3_J1939_TP_MAX_SIZE;
+            }
+        }
+        Session * session = find(source, destination);
+        if (session) {
+            aborted++;
+        } else {
+            for (auto & candidate : sessions) {
+                if (!candidate.active) {
+                    session = &candidate;
+                    break;
+                }
+            }
+        }
+        if (session) {
+            session->active = true;
+            session->source = source;
+            session->destination = destination;
+        }
+        return session;
+    }
+
+    void send(uint8_t source, uint8_t destination, const uint8_t (&data)[8]) {
+        if (!transmit)
+            return;
+        twai_message_t frame = {};
+        frame.extd = 1;
+        J1939Id id;
+        id.priority = 7;
+        id.pgn = J1939_PGN_TP_CM;
+        id.source = source;
+        id.destination = destination;
+        frame.identifier = id.identifier();
+        frame.data_length_code = 8;
+        memcpy(frame.data, data, 8);
+        transmit(frame);
+    }
+
+    void clear_to_send(Session & session) {
+        uint8_t count = std::min<uint8_t>(session.packets - session.next + 1, std::min<uint8_t>(session.max_per_cts, MB3_J1939_CTS_PACKETS));
+        session.window_end = session.next + count - 1;
+        uint8_t data[8] = {J1939_TP_CM_CTS, count, session.next, 0xFF, 0xFF,
+            (uint8_t)session.pgn, (uint8_t)(session.pgn >> 8), (uint8_t)(session.pgn >> 16)};
+        send(session.destination, session.source, data);
+    }
+
+    void end_of_message(Session & session) {
+        uint8_t data[8] = {J1939_TP_CM_EOMA, (uint8_t)session.size, (uint8_t)(session.size >> 8), session.packets, 0xFF,
+            (uint8_t)session.pgn, (uint8_t)(session.pgn >> 8), (uint8_t)(session.pgn >> 16)};
+        send(session.destination, session.source, data);
+    }
+
+    void abort(uint8_t source, uint8_t destination, uint32_t pgn, uint8_t reason) {
+        uint8_t data[8] = {J1939_TP_CM_ABORT, reason, 0xFF, 0xFF, 0xFF,
+            (uint8_t)pgn, (uint8_t)(pgn >> 8), (uint8_t)(pgn >> 16)};
+        send(source, destination, data);
+    }
+
+    Session sessions[MB3_J1939_TP_SESSIONS];
+    uint8_t * buffers = nullptr;
+};
+
+/// @brief J1939 view of a CAN bus: extended frames are decoded by PGN rather than
+/// by their full identifier, so one registration covers every source address.
+class J1939 {
+public:
+    J1939(uint8_t address = MB3_J1939_ADDRESS) : transport(address) {
+        transport.on_complete = [this](const J1939Message & message) {
+            dispatch.dispatch(message);
+        };
+    }
+
+    J1939(const J1939 &) = delete;
+    J1939 & operator=(const J1939 &) = delete;
+
+    void add(uint32_t pgn, std::shared_ptr<IJ1939Decoder> decoder, uint16_t source = J1939Dispatch::ANY_SOURCE) {
+        dispatch.add(pgn, decoder, source);
+    }
+
+    void add(uint32_t pgn, const J1939FunctionDecoder::Function & function, uint16_t source = J1939Dispatch::ANY_SOURCE) {
+        dispatch.add(pgn, std::make_shared<J1939FunctionDecoder>(function), source);
+    }
+
+    /// @brief Register a CanFrame whose id() is a PGN
+    void add(std::shared_ptr<ICanFrame> frame, uint16_t source = J1939Dispatch::ANY_SOURCE) {
+        dispatch.add(frame->id(), std::make_shared<J1939FrameDecoder>(frame), source);
+    }
+
+    /// @return false if the frame wasn't J1939 or nothing wanted it
+    bool receive(const twai_message_t & frame, int64_t timestamp) {
+        if (!frame.extd)
+            return false;
+        J1939Message message;
+        message.id = J1939Id::parse(frame.identifier);
+        message.data = frame.data;
+        message.size = frame.data_length_code;
+        message.timestamp = timestamp;
+
+        received++;
+        switch (message.id.pgn) {
+            case J1939_PGN_TP_CM:
+                if (message.size == 8)
+                    transport.connection_management(message.id, frame.data, timestamp);
+                return true;
+            case J1939_PGN_TP_DT:
+                if (message.size == 8)
+                    transport.data_transfer(message.id, frame.data, timestamp);
+                return true;
+            case J1939_PGN_ADDRESS_CLAIM:
+                if (message.size == 8) {
+                    uint64_t name;
+                    memcpy(&name, frame.data, 8);
+                    addresses.claim(message.id.source, name);
+                }
+                break;
+        }
+        if (dispatch.dispatch(message))
+            return true;
+        unhandled++;
+        return message.id.pgn == J1939_PGN_ADDRESS_CLAIM;
+    }
+
+    void poll(int64_t now) {
+        transport.poll(now);
+    }
+
+    J1939Dispatch dispatch;
+    J1939Transport transport;
+    J1939AddressTable addresses;
+
+    uint32_t received = 0;
+    uint32_t unhandled = 0;
+};
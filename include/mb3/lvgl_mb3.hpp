@@ -2,8 +2,17 @@
 
 #include <lvgl.h>
 #include <functional>
+#include <math.h>
+#include <string.h>
 #include <src/widgets/canvas/lv_canvas_private.h>
 #include <src/draw/lv_draw_vector_private.h>
+#include <src/draw/lv_draw_buf_private.h>
+#include <mb3/pixel_fill.hpp>
+#include <mb3/dirty_region.hpp>
+#include <mb3/arena.hpp>
+#include <mb3/buffer_pool.hpp>
+#include <mb3/draw_buffers.hpp>
+#include <mb3/defaults.hpp>
 
 inline void lv_vector_path_move_to(lv_vector_path_t *path, lv_fpoint_t p) {
     lv_vector_path_move_to(path, &p);
@@ -28,115 +37,109 @@ inline void lv_vector_path_append_arc(lv_vector_path_t * path, const lv_fpoint_t
     lv_vector_path_append_arc(path, &c, radius, start_angle, sweep, pie);
 }
 
-// lv_canvas_fill_bg(banner_draw, COLOR_BLACK, LV_OPA_0) without invalidate
-inline void clearCanvas(lv_obj_t * obj, int min_y = 0, int max_y = -1) {
+/// @brief Fill area of a canvas (clipped to it) with color, without invalidating,
+/// the way lv_canvas_fill_bg fills the whole of it. Every non-YUV format goes
+/// through @ref fillPixels: indexed formats take the index from color.blue and
+/// skip the palette, alpha-only formats take opa, RGB565A8 fills both planes.
+inline void fillCanvas(lv_obj_t * obj, const lv_area_t & area, lv_color_t color, lv_opa_t opa) {
     lv_canvas_t * canvas = (lv_canvas_t *)obj;
     lv_draw_buf_t * draw_buf = canvas->draw_buf;
     if(draw_buf == NULL) return;
 
     lv_image_header_t * header = &draw_buf->header;
-    uint32_t x;
-    uint32_t y;
-
+    lv_area_t clipped;
+    lv_area_t bounds = {0, 0, (int32_t)header->w - 1, (int32_t)header->h - 1};
+    if (!lv_area_intersect(&clipped, &area, &bounds)) return;
+
+    int32_t x = clipped.x1;
+    int32_t y = clipped.y1;
+    int32_t w = lv_area_get_width(&clipped);
+    int32_t h = lv_area_get_height(&clipped);
     uint32_t stride = header->stride;
     uint8_t * data = draw_buf->data;
+    lv_color_format_t cf = (lv_color_format_t)header->cf;
 
-    if (max_y == -1)
-        max_y = header->h;
-
-    // if (header->cf == LV_COLOR_FORMAT_XRGB8888 || header->cf == LV_COLOR_FORMAT_ARGB8888) {
-    //     for (y = 0; y < max_y; y++) {
-    //         uint32_t * buf32 = (uint32_t *)(data + y * stride);
-    //         for(x = 0; x < header->w; x++) {
-    //             buf32[x] = 0;
-    //         }
-    //     }
-    // } else if (header->cf == LV_COLOR_FORMAT_RGB888) {
-    //     for (y = 0; y < max_y; y++) {
-    //         uint8_t * buf8 = (uint8_t *)(data + y * stride);
-    //         for(x = 0; x < header->w * 3; x += 3) {
-    //             buf8[x + 0] = 0;
-    //             buf8[x + 1] = 0;
-    //             buf8[x + 2] = 0;
-    //         }
-    //     }
-    // } else if (header->cf == LV_COLOR_FORMAT_L8) {
-    //     for (y = 0; y < max_y; y++) {
-    //         uint8_t * buf = (uint8_t *)(data + y * stride);
-    //         for(x = 0; x < header->w; x++) {
-    //             buf[x] = 0;
-    //         }
-    //     }
-    // }
-
-
-    if(header->cf == LV_COLOR_FORMAT_RGB565) {
-        for(y = min_y; y < max_y; y++) {
-            uint16_t * buf16 = (uint16_t *)(data + y * stride);
-            for(x = 0; x < header->w; x++) {
-                buf16[x] = 0;
-            }
-        }
+    if (LV_COLOR_FORMAT_IS_INDEXED(cf)) {
+        data += LV_COLOR_INDEXED_PALETTE_SIZE(cf) * 4;
+        fillPixels(data, stride, x, y, w, h, lv_color_format_get_bpp(cf), color.blue);
+        return;
     }
-    else if(header->cf == LV_COLOR_FORMAT_XRGB8888 || header->cf == LV_COLOR_FORMAT_ARGB8888) {
-        uint32_t c32 = 0;
-        if(header->cf == LV_COLOR_FORMAT_ARGB8888) {
-            c32 &= 0x00ffffff;
-            c32 |= (uint32_t)0 << 24;
-        }
-        for(y = min_y; y < max_y; y++) {
-            uint32_t * buf32 = (uint32_t *)(data + y * stride);
-            for(x = 0; x < header->w; x++) {
-                buf32[x] = 0;
-            }
-        }
-    }
-    else if(header->cf == LV_COLOR_FORMAT_RGB888) {
-        for(y = min_y; y < max_y; y++) {
-            uint8_t * buf8 = (uint8_t *)(data + y * stride);
-            for(x = 0; x < header->w * 3; x += 3) {
-                buf8[x + 0] = 0;
-                buf8[x + 1] = 0;
-                buf8[x + 2] = 0;
-            }
-        }
-    }
-    else if(header->cf == LV_COLOR_FORMAT_L8) {
-        uint8_t c8 = 0;
-        for(y = min_y; y < max_y; y++) {
-            uint8_t * buf = (uint8_t *)(data + y * stride);
-            for(x = 0; x < header->w; x++) {
-                buf[x] = c8;
-            }
-        }
-    }
-    else if(header->cf == LV_COLOR_FORMAT_AL88) {
-        lv_color16a_t c;
-        c.lumi = 0;
-        c.alpha = 255;
-        for(y = min_y; y < max_y; y++) {
-            lv_color16a_t * buf = (lv_color16a_t *)(data + y * stride);
-            for(x = 0; x < header->w; x++) {
-                buf[x] = c;
-            }
-        }
+    if (LV_COLOR_FORMAT_IS_ALPHA_ONLY(cf)) {
+        uint8_t bpp = lv_color_format_get_bpp(cf);
+        fillPixels(data, stride, x, y, w, h, bpp, opa >> (8 - bpp));
+        return;
     }
 
-    else {
-        for(y = min_y; y < max_y; y++) {
-            for(x = 0; x < header->w; x++) {
-                lv_canvas_set_px(obj, x, y, lv_color_black(), 0);
+    uint16_t c16 = lv_color_to_u16(color);
+    switch (cf) {
+        case LV_COLOR_FORMAT_RGB565:
+            fillPixels(data, stride, x, y, w, h, 16, c16);
+            break;
+        case LV_COLOR_FORMAT_RGB565A8:
+            fillPixels(data, stride, x, y, w, h, 16, c16);
+            // the alpha plane follows, at half the stride
+            fillPixels(data + (stride * header->h), stride / 2, x, y, w, h, 8, opa);
+            break;
+        case LV_COLOR_FORMAT_ARGB8565:
+            fillPixels(data, stride, x, y, w, h, 24, c16 | ((uint32_t)opa << 16));
+            break;
+        case LV_COLOR_FORMAT_RGB888:
+            fillPixels(data, stride, x, y, w, h, 24, color.blue | (color.green << 8) | ((uint32_t)color.red << 16));
+            break;
+        case LV_COLOR_FORMAT_XRGB8888:
+        case LV_COLOR_FORMAT_ARGB8888:
+            fillPixels(data, stride, x, y, w, h, 32, color.blue | (color.green << 8) | ((uint32_t)color.red << 16) | ((uint32_t)opa << 24));
+            break;
+        case LV_COLOR_FORMAT_L8:
+            fillPixels(data, stride, x, y, w, h, 8, lv_color_luminance(color));
+            break;
+        case LV_COLOR_FORMAT_AL88:
+            // as lv_canvas_fill_bg does, opaque whatever opa
+            fillPixels(data, stride, x, y, w, h, 16, lv_color_luminance(color) | (0xFF << 8));
+            break;
+        default:
+            for (int32_t j = clipped.y1; j <= clipped.y2; j++) {
+                for (int32_t i = clipped.x1; i <= clipped.x2; i++) {
+                    lv_canvas_set_px(obj, i, j, color, opa);
+                }
             }
-        }
+            break;
     }
+}
 
+/// @brief Clear area of a canvas to transparent black, without invalidating
+inline void clearCanvasArea(lv_obj_t * obj, const lv_area_t & area) {
+    fillCanvas(obj, area, lv_color_black(), LV_OPA_0);
+}
 
+// lv_canvas_fill_bg(banner_draw, COLOR_BLACK, LV_OPA_0) without invalidate
+inline void clearCanvas(lv_obj_t * obj, int min_y = 0, int max_y = -1) {
+    lv_canvas_t * canvas = (lv_canvas_t *)obj;
+    if(canvas->draw_buf == NULL) return;
 
+    if (max_y == -1)
+        max_y = canvas->draw_buf->header.h;
+
+    clearCanvasArea(obj, {0, min_y, (int32_t)canvas->draw_buf->header.w - 1, max_y - 1});
 }
 
 constexpr auto lv_canvas_fill_bg_without_invalidation = clearCanvas;
 
-// lv_canvas_finish_layer(obj, layer) without invalidate
+/// @brief Copy the alpha of an ARGB8888 buffer into an A8 one of the same
+/// size. LVGL's software renderer can't draw into A8, so alpha-only content is
+/// drawn in ARGB8888 first and reduced with this.
+inline void extractAlpha(const lv_draw_buf_t * argb, lv_draw_buf_t * a8) {
+    for (uint32_t y = 0; y < a8->header.h; y++) {
+        const uint8_t * src = argb->data + argb->header.stride * y;
+        uint8_t * dst = a8->data + a8->header.stride * y;
+        for (uint32_t x = 0; x < a8->header.w; x++) {
+            dst[x] = src[x * 4 + 3];
+        }
+    }
+}
+
+// lv_canvas_finish_layer(obj, layer) without invalidate, blocking until the
+// layer is rendered (see AsyncCanvasLayer for not waiting)
 inline void queueCanvasLayerDraw(lv_obj_t * obj, lv_layer_t * layer) {
     if (layer->draw_task_head == NULL) return;
 
@@ -155,12 +158,350 @@ inline void queueCanvasLayerDraw(lv_obj_t * obj, lv_layer_t * layer) {
 
 constexpr auto lv_canvas_finish_layer_without_invalidation = queueCanvasLayerDraw;
 
+/// @brief Bounding box of a vector path as drawn with draw (stroke, miters,
+/// antialiasing and transform included), in the layer's coordinates
+inline bool pathBounds(const lv_vector_path_t * path, const lv_vector_draw_dsc_t & draw, lv_area_t & out) {
+    uint32_t count = lv_array_size(&path->points);
+    if (!count) return false;
+    // control points included, curves stay inside them
+    lv_fpoint_t min = *(lv_fpoint_t *)lv_array_at(&path->points, 0);
+    lv_fpoint_t max = min;
+    for (uint32_t i = 1; i < count; i++) {
+        auto p = (const lv_fpoint_t *)lv_array_at(&path->points, i);
+        min.x = LV_MIN(min.x, p->x);
+        min.y = LV_MIN(min.y, p->y);
+        max.x = LV_MAX(max.x, p->x);
+        max.y = LV_MAX(max.y, p->y);
+    }
+    float pad = 1.f;
+    if (draw.stroke_dsc.opa > LV_OPA_MIN) {
+        float join = draw.stroke_dsc.join == LV_VECTOR_STROKE_JOIN_MITER ? LV_MAX(draw.stroke_dsc.miter_limit, 1.f) : 1.f;
+        pad += draw.stroke_dsc.width * join / 2.f;
+    }
+    lv_fpoint_t corners[4] = {{min.x - pad, min.y - pad}, {max.x + pad, min.y - pad}, {min.x - pad, max.y + pad}, {max.x + pad, max.y + pad}};
+    lv_fpoint_t low = {INFINITY, INFINITY}, high = {-INFINITY, -INFINITY};
+    for (auto & corner : corners) {
+        lv_matrix_transform_point(&draw.matrix, &corner);
+        low.x = LV_MIN(low.x, corner.x);
+        low.y = LV_MIN(low.y, corner.y);
+        high.x = LV_MAX(high.x, corner.x);
+        high.y = LV_MAX(high.y, corner.y);
+    }
+    out = {(int32_t)floorf(low.x), (int32_t)floorf(low.y), (int32_t)ceilf(high.x), (int32_t)ceilf(high.y)};
+    return true;
+}
+
+/// @brief Tracks what's drawn on a canvas each frame, so the next frame only
+/// clears and invalidates what changed instead of the whole canvas.
+/// Draw through a @ref CanvasDirtyTracker::Frame: it clears what the previous
+/// frame drew (everything else is already background), and when it ends,
+/// invalidates that plus what this frame drew. @ref Shape, @ref Path and
+/// @ref Layer report their bounds on their own; mark anything else drawn
+/// directly on the layer, e.g. labels.
+///
+///     static CanvasDirtyTracker tracker(canvas);
+///     {
+///         CanvasDirtyTracker::Frame frame(tracker);
+///         Shape(frame).start(x, 10).line(40).stroke(3, color).finish();
+///         lv_draw_label(frame, &label_dsc, &label_area);
+///         tracker.mark(label_area);
+///     }
+class CanvasDirtyTracker {
+public:
+    using Region = DirtyRegion<MB3_DIRTY_RECTS>;
+
+    CanvasDirtyTracker(lv_obj_t * canvas) : canvas(canvas) {
+        reset();
+    }
+
+    /// @brief Draw one frame, clearing and invalidating only what changed
+    class Frame {
+    public:
+        Frame(CanvasDirtyTracker & tracker) : tracker(tracker), outer(active) {
+            tracker.begin();
+            lv_canvas_init_layer(tracker.canvas, &layer);
+            tracker.layer = &layer;
+            active = &tracker;
+        }
+
+        ~Frame() {
+            queueCanvasLayerDraw(tracker.canvas, &layer);
+            active = outer;
+            tracker.layer = nullptr;
+            tracker.end();
+        }
+
+        Frame(const Frame &) = delete;
+        Frame & operator=(const Frame &) = delete;
+
+        operator lv_layer_t * () {
+            return &layer;
+        }
+
+        lv_layer_t layer = {0};
+
+    private:
+        CanvasDirtyTracker & tracker;
+        CanvasDirtyTracker * outer;
+    };
+
+    /// @brief Something was drawn in area, canvas coordinates
+    void mark(const lv_area_t & area) {
+        DirtyRect rect = {area.x1, area.y1, area.x2, area.y2};
+        rect = rect.intersect(bounds());
+        drawn.add(rect);
+    }
+
+    /// @brief Clear and invalidate the whole canvas next frame, after
+    /// drawing on it some other way
+    void reset() {
+        previous.clear();
+        previous.add(bounds());
+    }
+
+    /// @brief Clear the canvas to this instead of transparent black
+    void setBackground(lv_color_t color, lv_opa_t opa) {
+        background = color;
+        background_opa = opa;
+    }
+
+    /// @brief Pixels the last frame cleared
+    int64_t cleared() const {
+        return last_cleared;
+    }
+
+    /// @brief Pixels the last frame invalidated
+    int64_t invalidated() const {
+        return last_invalidated;
+    }
+
+    /// @brief Called by the drawing helpers with what they drew on layer
+    static void note(lv_layer_t * layer, const lv_area_t & area) {
+        if (active && active->layer == layer)
+            active->mark(area);
+    }
+
+private:
+    DirtyRect bounds() const {
+        lv_draw_buf_t * draw_buf = ((lv_canvas_t *)canvas)->draw_buf;
+        if (!draw_buf) return {0, 0, -1, -1};
+        return {0, 0, (int32_t)draw_buf->header.w - 1, (int32_t)draw_buf->header.h - 1};
+    }
+
+    void begin() {
+        drawn.clear();
+        last_cleared = previous.pixels();
+        for (size_t i = 0; i < previous.size(); i++) {
+            const DirtyRect & rect = previous[i];
+            fillCanvas(canvas, {rect.x1, rect.y1, rect.x2, rect.y2}, background, background_opa);
+        }
+    }
+
+    void end() {
+        Region changed = previous;
+        changed.add(drawn);
+        last_invalidated = changed.pixels();
+        lv_area_t content;
+        lv_obj_get_content_coords(canvas, &content);
+        for (size_t i = 0; i < changed.size(); i++) {
+            const DirtyRect & rect = changed[i];
+            lv_area_t area = {content.x1 + rect.x1, content.y1 + rect.y1, content.x1 + rect.x2, content.y1 + rect.y2};
+            lv_obj_invalidate_area(canvas, &area);
+        }
+        previous = drawn;
+    }
+
+    lv_obj_t * canvas;
+    lv_layer_t * layer = nullptr;
+    Region previous;
+    Region drawn;
+    lv_color_t background = lv_color_black();
+    lv_opa_t background_opa = LV_OPA_0;
+    int64_t last_cleared = 0;
+    int64_t last_invalidated = 0;
+
+    static inline CanvasDirtyTracker * active = nullptr;
+};
+
 /// @brief Helper for @ref lv_layer_t
+class RetainedLayer;
+
+/// @brief Pixel buffers for @ref Layer, reused across frames instead of
+/// allocated per layer and per refresh area. Buffers are matched on color
+/// format and size class; small ones come from internal RAM, the rest from
+/// PSRAM. LVGL still allocates the lv_draw_buf_t around them.
+class LayerPool {
+public:
+    /// @brief Buffers kept between layers, for lent()/memory()/hits()/misses()/evictions()
+    static const BufferPool<MB3_LAYER_POOL_SLOTS> & buffers() {
+        return pool;
+    }
+
+    /// @brief Free the buffers no layer is using
+    static void trim() {
+        pool.trim();
+    }
+
+    /// @brief Layers drawn from a @ref RetainedLayer instead of rendered
+    static uint32_t composited() {
+        return _composited;
+    }
+
+    static uint32_t rendered() {
+        return _rendered;
+    }
+
+    static void report() {
+        pool.report();
+        log_i("layers: %u rendered, %u composited from retained layers", (unsigned)_rendered, (unsigned)_composited);
+    }
+
+private:
+    friend class Layer;
+    friend class RetainedLayer;
+
+    /// @brief A draw buffer backed by the pool, owned by LVGL from here on
+    static lv_draw_buf_t * create(int32_t w, int32_t h, lv_color_format_t format) {
+        if (!handlers.buf_malloc_cb) {
+            handlers = *lv_draw_buf_get_handlers();
+            handlers.buf_malloc_cb = buf_malloc;
+            handlers.buf_free_cb = buf_free;
+        }
+        _rendered++;
+        return lv_draw_buf_create_ex(&handlers, w, h, format, LV_STRIDE_AUTO);
+    }
+
+    static void * buf_malloc(size_t size, lv_color_format_t format) {
+        uint32_t caps = size <= MB3_LAYER_POOL_INTERNAL ? MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT : MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+        void * data = pool.acquire(size, format, caps);
+        if (!data && (caps & MALLOC_CAP_INTERNAL))
+            data = pool.acquire(size, format, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        return data;
+    }
+
+    static void buf_free(void * data);
+
+    static inline BufferPool<MB3_LAYER_POOL_SLOTS> pool{"layer", LV_DRAW_BUF_ALIGN};
+    static inline lv_draw_buf_handlers_t handlers = {};
+    static inline RetainedLayer * retained = nullptr;
+    static inline uint32_t _rendered = 0;
+    static inline uint32_t _composited = 0;
+};
+
+/// @brief Keeps what a @ref Layer rendered, so later frames composite the
+/// pixels instead of drawing the children again while they don't change.
+/// The content becomes available once LVGL has finished rendering the layer.
+/// Call @ref invalidate outside rendering.
+///
+///     static RetainedLayer face;
+///     if (!face.composite(layer, area)) {
+///         Layer l(layer, area, LV_COLOR_FORMAT_ARGB8888, &face);
+///         ...
+///     }
+class RetainedLayer {
+public:
+    RetainedLayer() {
+        next = LayerPool::retained;
+        LayerPool::retained = this;
+    }
+
+    ~RetainedLayer() {
+        invalidate();
+        for (RetainedLayer ** link = &LayerPool::retained; *link; link = &(*link)->next) {
+            if (*link == this) {
+                *link = next;
+                break;
+            }
+        }
+    }
+
+    RetainedLayer(const RetainedLayer &) = delete;
+    RetainedLayer & operator=(const RetainedLayer &) = delete;
+
+    /// @brief Draw the kept pixels at area
+    /// @return false when there are none yet, or they are another size
+    bool composite(lv_layer_t * parent, const lv_area_t & area) {
+        if (!valid || lv_area_get_width(&area) != (int32_t)image.header.w || lv_area_get_height(&area) != (int32_t)image.header.h)
+            return false;
+        lv_draw_image_dsc_t dsc;
+        lv_draw_image_dsc_init(&dsc);
+        dsc.src = &image;
+        lv_draw_image(parent, &dsc, &area);
+        CanvasDirtyTracker::note(parent, area);
+        LayerPool::_composited++;
+        return true;
+    }
+
+    /// @brief The content changed: render it again with the next @ref Layer
+    void invalidate() {
+        if (valid)
+            LayerPool::pool.release(raw);
+        valid = false;
+        raw = nullptr;
+    }
+
+    bool isValid() const {
+        return valid;
+    }
+
+    /// @brief Bytes held by the kept pixels
+    size_t memory() const {
+        return valid ? image.data_size : 0;
+    }
+
+private:
+    friend class Layer;
+    friend class LayerPool;
+
+    /// @brief A layer is about to render into buffer
+    void rendering(lv_draw_buf_t * buffer) {
+        invalidate();
+        raw = buffer->unaligned_data;
+        image = *buffer;
+        image.flags = 0;
+        image.handlers = nullptr;
+    }
+
+    /// @brief LVGL is done with the layer and hands the buffer back
+    bool finished(void * data) {
+        if (!raw || data != raw || valid)
+            return false;
+        lv_image_cache_drop(&image);
+        valid = true;
+        return true;
+    }
+
+    RetainedLayer * next = nullptr;
+    lv_draw_buf_t image = {};
+    void * raw = nullptr;
+    bool valid = false;
+};
+
+inline void LayerPool::buf_free(void * data) {
+    for (RetainedLayer * layer = retained; layer; layer = layer->next) {
+        if (layer->finished(data))
+            return;
+    }
+    pool.release(data);
+}
+
+/// @brief Helper for @ref lv_layer_t, rendering into a pooled buffer
+/// (@ref LayerPool), optionally kept afterwards in retain
 class Layer {
 public:
-    Layer(lv_layer_t * parent, const lv_area_t & area, lv_color_format_t format = LV_COLOR_FORMAT_RGB565) : area(area) {
+    Layer(lv_layer_t * parent, const lv_area_t & area, lv_color_format_t format = LV_COLOR_FORMAT_RGB565, RetainedLayer * retain = nullptr) : area(area) {
         this->area = area;
         layer = lv_draw_layer_create(parent, format, &this->area);
+        if (!layer || layer->draw_buf)
+            return;
+        // LVGL only allocates a buffer when the layer has none
+        layer->draw_buf = LayerPool::create(lv_area_get_width(&area), lv_area_get_height(&area), format);
+        if (!layer->draw_buf)
+            return;
+        if (lv_color_format_has_alpha(format))
+            lv_draw_buf_clear(layer->draw_buf, nullptr);
+        if (retain)
+            retain->rendering(layer->draw_buf);
     };
 
     ~Layer() {
@@ -168,6 +509,7 @@ public:
         lv_draw_image_dsc_init(&layer_draw_dsc);
         layer_draw_dsc.src = layer;
         lv_draw_layer(layer->parent, &layer_draw_dsc, &area);
+        CanvasDirtyTracker::note(layer->parent, area);
     }
 
     operator lv_layer_t * () {
@@ -203,52 +545,282 @@ private:
 
 };
 
+/// @brief A canvas layer whose draw tasks are handed to the draw units without
+/// waiting for them. @ref submit returns at once. The layer is done once the
+/// draw units have rendered all its tasks, which @ref poll (non-blocking) or
+/// @ref wait notices. Several layers in flight share the draw units, and the
+/// caller can record the next canvas in the meantime. Completion callbacks run
+/// in poll() or wait(), on the caller's thread.
+///
+///     AsyncCanvasLayer gauge(canvas);
+///     ...draw into gauge
+///     gauge.submit([](lv_obj_t * canvas) { lv_obj_invalidate(canvas); });
+///     ...
+///     AsyncCanvasLayer::poll();
+class AsyncCanvasLayer {
+public:
+    using Callback = std::function<void(lv_obj_t * canvas)>;
+
+    AsyncCanvasLayer(lv_obj_t * canvas) : canvas(canvas) {
+        lv_canvas_init_layer(canvas, &layer);
+    }
+
+    /// @brief The layer must not go while the draw units use it, anything
+    /// not submitted is rendered now
+    ~AsyncCanvasLayer() {
+        submit();
+        wait();
+    }
+
+    AsyncCanvasLayer(const AsyncCanvasLayer &) = delete;
+    AsyncCanvasLayer & operator=(const AsyncCanvasLayer &) = delete;
+
+    operator lv_layer_t * () {
+        return &layer;
+    }
+
+    /// @brief Start rendering what was drawn so far, callback runs once it's done
+    void submit(Callback callback = nullptr) {
+        if (queued)
+            return;
+        done_cb = callback;
+        queued = true;
+        next = pending;
+        pending = this;
+        dispatch();
+    }
+
+    bool done() const {
+        return !queued;
+    }
+
+    /// @brief Block until this layer is rendered, the others keep going meanwhile
+    void wait() {
+        while (queued) {
+            lv_draw_dispatch_wait_for_request();
+            if (!dispatch()) {
+                lv_draw_wait_for_finish();
+                lv_draw_dispatch_request();
+            }
+        }
+    }
+
+    /// @brief Hand waiting tasks to idle draw units, and complete finished layers
+    /// @return layers still rendering
+    static size_t poll() {
+        dispatch();
+        size_t count = 0;
+        for (AsyncCanvasLayer * item = pending; item; item = item->next) {
+            count++;
+        }
+        return count;
+    }
+
+    /// @brief Block until every submitted layer is rendered
+    static void waitAll() {
+        while (pending) {
+            pending->wait();
+        }
+    }
+
+private:
+    /// @return whether a task was dispatched
+    static bool dispatch() {
+        bool dispatched = false;
+        for (AsyncCanvasLayer ** link = &pending; *link;) {
+            AsyncCanvasLayer * item = *link;
+            if (item->layer.draw_task_head)
+                dispatched |= lv_draw_dispatch_layer(lv_obj_get_display(item->canvas), &item->layer);
+            if (item->layer.draw_task_head) {
+                link = &item->next;
+                continue;
+            }
+            // unlink first, the callback may submit again
+            *link = item->next;
+            item->next = nullptr;
+            item->queued = false;
+            if (item->done_cb) {
+                Callback callback = std::move(item->done_cb);
+                callback(item->canvas);
+            }
+        }
+        return dispatched;
+    }
+
+    lv_layer_t layer = {0};
+    lv_obj_t * canvas;
+    Callback done_cb;
+    bool queued = false;
+    AsyncCanvasLayer * next = nullptr;
+    static inline AsyncCanvasLayer * pending = nullptr;
+};
+
+/// @brief Set up a vector descriptor the way lv_vector_dsc_create does,
+/// for descriptors that live on the stack or in the @ref FrameArena
+inline void initVectorDsc(lv_vector_dsc_t * dsc, lv_layer_t * layer) {
+    dsc->layer = layer;
+
+    dsc->current_dsc.fill_dsc.style = LV_VECTOR_DRAW_STYLE_SOLID;
+    dsc->current_dsc.fill_dsc.color = lv_color_to_32(lv_color_black(), 0xFF);
+    dsc->current_dsc.fill_dsc.opa = LV_OPA_COVER;
+    dsc->current_dsc.fill_dsc.fill_rule = LV_VECTOR_FILL_NONZERO;
+    lv_matrix_identity(&(dsc->current_dsc.fill_dsc.matrix)); /*identity matrix*/
+
+
+    dsc->current_dsc.stroke_dsc.style = LV_VECTOR_DRAW_STYLE_SOLID;
+    dsc->current_dsc.stroke_dsc.color = lv_color_to_32(lv_color_black(), 0xFF);
+    dsc->current_dsc.stroke_dsc.opa = LV_OPA_0; /*default no stroke*/
+    dsc->current_dsc.stroke_dsc.width = 1.0f;
+    dsc->current_dsc.stroke_dsc.cap = LV_VECTOR_STROKE_CAP_BUTT;
+    dsc->current_dsc.stroke_dsc.join = LV_VECTOR_STROKE_JOIN_MITER;
+    dsc->current_dsc.stroke_dsc.miter_limit = 4.0f;
+    lv_matrix_identity(&(dsc->current_dsc.stroke_dsc.matrix)); /*identity matrix*/
+
+    dsc->current_dsc.blend_mode = LV_VECTOR_BLEND_SRC_OVER;
+    if (layer)
+        dsc->current_dsc.scissor_area = layer->_clip_area;
+    lv_matrix_identity(&(dsc->current_dsc.matrix)); /*identity matrix*/
+    dsc->tasks.task_list = NULL;
+}
+
+/// @brief Free what lv_vector_dsc_delete would, but not the descriptor itself
+inline void releaseVectorDsc(lv_vector_dsc_t * dsc) {
+    if(dsc->tasks.task_list) {
+        lv_ll_t * task_list = dsc->tasks.task_list;
+        lv_vector_for_each_destroy_tasks(task_list, NULL, NULL);
+        dsc->tasks.task_list = NULL;
+    }
+    lv_array_deinit(&(dsc->current_dsc.stroke_dsc.dash_pattern));
+}
+
+/// @brief Per-frame memory for the drawing helpers (@ref Shape, @ref Path,
+/// @ref createPath). Vector descriptors come from a @ref BumpArena, internal
+/// RAM first then PSRAM, and paths from a pool whose arrays keep the capacity
+/// they grew to; both are recycled once the display finishes refreshing, so
+/// drawing stops allocating and freeing on every call. Helper objects must
+/// not outlive the draw they were made for. Until attach() the helpers
+/// allocate with lv_malloc as before.
+///
+///     FrameArena::attach(display);
+class FrameArena {
+public:
+    static void attach(lv_display_t * display = lv_display_get_default()) {
+        if (!arena)
+            arena = new BumpArena(MB3_FRAME_ARENA_SIZE, MB3_FRAME_ARENA_OVERFLOW);
+        lv_display_add_event_cb(display, on_refresh_ready, LV_EVENT_REFR_READY, nullptr);
+    }
+
+    /// @brief Recycle everything handed out, called after every refresh
+    static void reset() {
+        if (arena)
+            arena->reset();
+        for (size_t i = 0; i < paths_used; i++) {
+            lv_vector_path_clear(paths[i]);
+        }
+        paths_used = 0;
+    }
+
+    /// @return nullptr when not attached, or full
+    static void * allocate(size_t size, size_t align = alignof(max_align_t)) {
+        return arena ? arena->allocate(size, align) : nullptr;
+    }
+
+    static lv_vector_dsc_t * createVectorDsc(lv_layer_t * layer) {
+        auto dsc = arena ? arena->allocate<lv_vector_dsc_t>() : nullptr;
+        if (!dsc)
+            return lv_vector_dsc_create(layer);
+        memset(dsc, 0, sizeof(*dsc));
+        initVectorDsc(dsc, layer);
+        return dsc;
+    }
+
+    static void deleteVectorDsc(lv_vector_dsc_t * dsc) {
+        if (arena && arena->owns(dsc))
+            releaseVectorDsc(dsc);
+        else
+            lv_vector_dsc_delete(dsc);
+    }
+
+    static lv_vector_path_t * createVectorPath(lv_vector_path_quality_t quality = LV_VECTOR_PATH_QUALITY_HIGH) {
+        if (arena && paths_used < MB3_FRAME_ARENA_PATHS) {
+            if (paths_used == paths_created) {
+                lv_vector_path_t * path = lv_vector_path_create(quality);
+                if (!path)
+                    return nullptr;
+                paths[paths_created++] = path;
+            }
+            lv_vector_path_t * path = paths[paths_used++];
+            path->quality = quality;
+            if (paths_used > paths_high_water)
+                paths_high_water = paths_used;
+            return path;
+        }
+        return lv_vector_path_create(quality);
+    }
+
+    static void deleteVectorPath(lv_vector_path_t * path) {
+        // pooled paths are cleared and reused after the frame
+        for (size_t i = 0; i < paths_created; i++) {
+            if (paths[i] == path)
+                return;
+        }
+        lv_vector_path_delete(path);
+    }
+
+    /// @brief The arena, for used()/highWater()/overflowed(), nullptr until attached
+    static const BumpArena * memory() {
+        return arena;
+    }
+
+    /// @brief Most pooled paths used in one frame
+    static size_t pathsHighWater() {
+        return paths_high_water;
+    }
+
+private:
+    static void on_refresh_ready(lv_event_t * e) {
+        reset();
+    }
+
+    static inline BumpArena * arena = nullptr;
+    static inline lv_vector_path_t * paths[MB3_FRAME_ARENA_PATHS] = {};
+    static inline size_t paths_created = 0;
+    static inline size_t paths_used = 0;
+    static inline size_t paths_high_water = 0;
+};
+
 /// @brief Helper for @ref lv_layer_t
 class Path {
 public:
     Path(lv_layer_t * layer) {
-        dsc.layer = layer;
-
-        dsc.current_dsc.fill_dsc.style = LV_VECTOR_DRAW_STYLE_SOLID;
-        dsc.current_dsc.fill_dsc.color = lv_color_to_32(lv_color_black(), 0xFF);
-        dsc.current_dsc.fill_dsc.opa = LV_OPA_COVER;
-        dsc.current_dsc.fill_dsc.fill_rule = LV_VECTOR_FILL_NONZERO;
-        lv_matrix_identity(&(dsc.current_dsc.fill_dsc.matrix)); /*identity matrix*/
-
-
-        dsc.current_dsc.stroke_dsc.style = LV_VECTOR_DRAW_STYLE_SOLID;
-        dsc.current_dsc.stroke_dsc.color = lv_color_to_32(lv_color_black(), 0xFF);
-        dsc.current_dsc.stroke_dsc.opa = LV_OPA_0; /*default no stroke*/
-        dsc.current_dsc.stroke_dsc.width = 1.0f;
-        dsc.current_dsc.stroke_dsc.cap = LV_VECTOR_STROKE_CAP_BUTT;
-        dsc.current_dsc.stroke_dsc.join = LV_VECTOR_STROKE_JOIN_MITER;
-        dsc.current_dsc.stroke_dsc.miter_limit = 4.0f;
-        lv_matrix_identity(&(dsc.current_dsc.stroke_dsc.matrix)); /*identity matrix*/
-
-        dsc.current_dsc.blend_mode = LV_VECTOR_BLEND_SRC_OVER;
-        if (layer)
-            dsc.current_dsc.scissor_area = layer->_clip_area;
-        lv_matrix_identity(&(dsc.current_dsc.matrix)); /*identity matrix*/
-        dsc.tasks.task_list = NULL;
-
-        path.quality = LV_VECTOR_PATH_QUALITY_HIGH;
-        lv_array_init(&path.ops, 8, sizeof(lv_vector_path_op_t));
-        lv_array_init(&path.points, 8, sizeof(lv_fpoint_t));
+        initVectorDsc(&dsc, layer);
+
+        // the arrays are borrowed from a pooled path, and handed back grown
+        borrowed = FrameArena::createVectorPath(LV_VECTOR_PATH_QUALITY_HIGH);
+        if (borrowed) {
+            path = *borrowed;
+        } else {
+            path.quality = LV_VECTOR_PATH_QUALITY_HIGH;
+            lv_array_init(&path.ops, 8, sizeof(lv_vector_path_op_t));
+            lv_array_init(&path.points, 8, sizeof(lv_fpoint_t));
+        }
     };
 
     ~Path() {
         lv_vector_dsc_add_path(&dsc, &path);
         lv_draw_vector(&dsc);
-
-        lv_array_deinit(&path.ops);
-        lv_array_deinit(&path.points);
-
-        if(dsc.tasks.task_list) {
-            lv_ll_t * task_list = dsc.tasks.task_list;
-            lv_vector_for_each_destroy_tasks(task_list, NULL, NULL);
-            dsc.tasks.task_list = NULL;
+        lv_area_t bounds;
+        if (pathBounds(&path, dsc.current_dsc, bounds))
+            CanvasDirtyTracker::note(dsc.layer, bounds);
+
+        if (borrowed) {
+            *borrowed = path;
+            FrameArena::deleteVectorPath(borrowed);
+        } else {
+            lv_array_deinit(&path.ops);
+            lv_array_deinit(&path.points);
         }
-        lv_array_deinit(&(dsc.current_dsc.stroke_dsc.dash_pattern));
+        releaseVectorDsc(&dsc);
     }
 
     operator lv_vector_path_t * () {
@@ -262,6 +834,9 @@ public:
     lv_vector_dsc_t dsc = {0};
     lv_vector_path_t path;
 
+private:
+    lv_vector_path_t * borrowed;
+
 };
 
 
@@ -294,37 +869,24 @@ public:
 // };
     
 inline void createPath(lv_layer_t * layer, std::function<void(lv_vector_path_t* path, lv_vector_dsc_t* dsc)> const & body) {
-    lv_vector_dsc_t * dsc = lv_vector_dsc_create(layer);
-    lv_vector_path_t * path = lv_vector_path_create(LV_VECTOR_PATH_QUALITY_HIGH);
+    lv_vector_dsc_t * dsc = FrameArena::createVectorDsc(layer);
+    lv_vector_path_t * path = FrameArena::createVectorPath(LV_VECTOR_PATH_QUALITY_HIGH);
     
     body(path, dsc);
 
     lv_vector_dsc_add_path(dsc, path);
     lv_draw_vector(dsc);
-    lv_vector_path_delete(path);
-    lv_vector_dsc_delete(dsc);
+    lv_area_t bounds;
+    if (pathBounds(path, dsc->current_dsc, bounds))
+        CanvasDirtyTracker::note(layer, bounds);
+    FrameArena::deleteVectorPath(path);
+    FrameArena::deleteVectorDsc(dsc);
 }
 
+// A buffer kept for the whole run, from DrawBuffers (so it shows in the report
+// and counts against the PSRAM budget). Prefer DrawBuffers::borrow with the
+// screen as owner, so screens never shown together share memory.
 #define LV_DRAW_BUF_CREATE(name, _w, _h, _cf, caps) \
-    static uint8_t * buf_##name = (uint8_t*)heap_caps_calloc(1, LV_DRAW_BUF_SIZE(_w, _h, _cf), caps); \
-    static lv_draw_buf_t name = { \
-        .header = { \
-                    .magic = LV_IMAGE_HEADER_MAGIC, \
-                    .cf = (_cf), \
-                    .flags = LV_IMAGE_FLAGS_MODIFIABLE, \
-                    .w = (_w), \
-                    .h = (_h), \
-                    .stride = LV_DRAW_BUF_STRIDE(_w, _cf), \
-                    .reserved_2 = 0, \
-                }, \
-        .data_size = LV_DRAW_BUF_SIZE(_w, _h, _cf), \
-        .data = buf_##name, \
-        .unaligned_data = buf_##name, \
-    }; \
-    do { \
-        lv_image_header_t * header = &name.header; \
-        lv_draw_buf_init(&name, header->w, header->h, (lv_color_format_t)header->cf, header->stride, buf_##name, LV_DRAW_BUF_SIZE(_w, _h, _cf)); \
-        lv_draw_buf_set_flag(&name, LV_IMAGE_FLAGS_MODIFIABLE); \
-    } while(0)
-    
+    static lv_draw_buf_t & name = DrawBuffers::keep(#name, _w, _h, _cf, DrawBuffers::placement(caps))
+
 #define LV_DRAW_BUF_CREATE_PSRAM(name, _w, _h, _cf) LV_DRAW_BUF_CREATE(name, _w, _h, _cf,  MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
\ No newline at end of file
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+/// @brief A printf format with one numeric conversion, parsed once, that
+/// formats integers and fixed-decimal floats without printf or the heap.
+/// Handles `%d %i %u %f %F` with the `- + space 0` flags, a width, a precision
+/// for floats, length modifiers (ignored) and any text around the conversion,
+/// e.g. `"%5.1f km/h"` or `"Gear %d"`. Floats are rounded exactly like printf
+/// (half to even on the float's exact value) using integer maths only.
+/// Anything else (`%g`, `%x`, `*` widths, several conversions) isn't
+/// supported(), and @ref format falls back to snprintf, as do doubles.
+///
+///     NumberFormat speed{"%5.1f km/h"};
+///     char text[16];
+///     speed.format(text, sizeof(text), 88.25f); // " 88.2 km/h"
+class NumberFormat {
+public:
+    static constexpr uint8_t MAX_DECIMALS = 9;
+    static constexpr size_t MAX_AFFIX = 23;
+
+    NumberFormat(const char * format = "%d") {
+        parse(format);
+    }
+
+    bool supported() const {
+        return _supported;
+    }
+
+    const char * source() const {
+        return _format;
+    }
+
+    /// @param truncated set when the text didn't fit in size
+    /// @return length written, not counting the terminator
+    template <typename T>
+    size_t format(char * buffer, size_t size, T value, bool * truncated = nullptr) const {
+        static_assert(std::is_arithmetic<T>::value, "NumberFormat formats numbers");
+        if (truncated)
+            *truncated = false;
+        if (size == 0)
+            return 0;
+        if (!_supported || std::is_same<T, double>::value)
+            return fallback(buffer, size, value, truncated);
+
+        uint64_t magnitude;
+        bool negative;
+        if (floating) {
+            float f = (float)value;
+            negative = std::signbit(f);
+            if (!scale(negative ? -f : f, decimals, magnitude))
+                return fallback(buffer, size, value, truncated);
+        } else {
+            // printf would misread a float passed to %d, truncating is kinder
+            int64_t whole = std::is_floating_point<T>::value ? (int64_t)value
+                : std::is_signed<T>::value ? (int64_t)value : (int64_t)(uint64_t)value;
+            // then what printf reads, as fallback passes it: an int for %d and
+            // %i, an unsigned for %u
+            if (unsigned_conversion) {
+                negative = false;
+                magnitude = (unsigned)whole;
+            } else {
+                int as_int = (int)whole;
+                negative = as_int < 0;
+                magnitude = negative ? 0 - (uint64_t)(int64_t)as_int : (uint64_t)as_int;
+            }
+        }
+
+        // digits backwards, then sign
+        char digits[32];
+        size_t n = 0;
+        for (uint8_t i = 0; i < decimals; i++) {
+            digits[n++] = '0' + magnitude % 10;
+            magnitude /= 10;
+        }
+        if (decimals)
+            digits[n++] = '.';
+        do {
+            digits[n++] = '0' + magnitude % 10;
+            magnitude /= 10;
+        } while (magnitude);
+        // '+' and ' ' only apply to signed conversions
+        char sign = negative ? '-' : unsigned_conversion ? 0 : plus ? '+' : space ? ' ' : 0;
+        size_t number = n + (sign ? 1 : 0);
+        size_t pad = width > number ? width - number : 0;
+
+        Writer out{buffer, size};
+        out.write(affix, prefix_length);
+        if (!left && !zero)
+            out.fill(' ', pad);
+        if (sign)
+            out.put(sign);
+        if (!left && zero)
+            out.fill('0', pad);
+        while (n) {
+            out.put(digits[--n]);
+        }
+        if (left)
+            out.fill(' ', pad);
+        out.write(affix + prefix_length, suffix_length);
+        if (truncated)
+            *truncated = out.overflow;
+        return out.finish();
+    }
+
+private:
+    struct Writer {
+        char * buffer;
+        size_t size;
+        size_t length = 0;
+        bool overflow = false;
+
+        void put(char c) {
+            if (length + 1 < size)
+                buffer[length++] = c;
+            else
+                overflow = true;
+        }
+        void fill(char c, size_t count) {
+            while (count--) {
+                put(c);
+            }
+        }
+        void write(const char * text, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                put(text[i]);
+            }
+        }
+        size_t finish() {
+            buffer[length] = '\0';
+            return length;
+        }
+    };
+
+    /// @brief value * 10^decimals, rounded half to even, exactly
+    static bool scale(float value, uint8_t decimals, uint64_t & out) {
+        static constexpr uint32_t powers[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        int exponent = (bits >> 23) & 0xFF;
+        if (exponent == 0xFF)
+            return false; // inf, nan
+        uint64_t mantissa = bits & 0x7FFFFF;
+        if (exponent)
+            mantissa |= 0x800000;
+        else
+            exponent = 1;
+        // value = mantissa * 2^exponent, and mantissa * 10^9 still fits in 54 bits
+        exponent -= 150;
+        uint64_t scaled = mantissa * powers[decimals];
+        if (exponent >= 0) {
+            if (exponent > 9)
+                return false;
+            out = scaled << exponent;
+            return true;
+        }
+        int shift = -exponent;
+        if (shift >= 64) {
+            out = 0;
+            return true;
+        }
+        uint64_t quotient = scaled >> shift;
+        uint64_t remainder = scaled & ((1ULL << shift) - 1);
+        uint64_t half = 1ULL << (shift - 1);
+        if (remainder > half || (remainder == half && (quotient & 1)))
+            quotient++;
+        out = quotient;
+        return true;
+    }
+
+    template <typename T>
+    size_t fallback(char * buffer, size_t size, T value, bool * truncated) const {
+        int length;
+        if constexpr (std::is_floating_point<T>::value)
+            length = snprintf(buffer, size, _format, (double)value);
+        else if constexpr (std::is_signed<T>::value)
+            length = snprintf(buffer, size, _format, (int)value);
+        else
+            length = snprintf(buffer, size, _format, (unsigned)value);
+        if (length < 0) {
+            buffer[0] = '\0';
+            return 0;
+        }
+        if (truncated)
+            *truncated = (size_t)length >= size;
+        return (size_t)length < size ? length : size - 1;
+    }
+
+    void parse(const char * format) {
+        _format = format;
+        _supported = false;
+        size_t length = 0;
+        const char * p = format;
+        bool converted = false;
+        while (*p) {
+            if (*p != '%') {
+                if (length >= MAX_AFFIX)
+                    return;
+                affix[length++] = *p++;
+                continue;
+            }
+            p++;
+            if (*p == '%') {
+                if (length >= MAX_AFFIX)
+                    return;
+                affix[length++] = *p++;
+                continue;
+            }
+            if (converted)
+                return;
+            converted = true;
+            prefix_length = length;
+            for (;; p++) {
+                if (*p == '-') left = true;
+                else if (*p == '+') plus = true;
+                else if (*p == ' ') space = true;
+                else if (*p == '0') zero = true;
+                else break;
+            }
+            int digits = 0;
+            while (*p >= '0' && *p <= '9') {
+                digits = (digits * 10) + (*p++ - '0');
+                if (digits > 32)
+                    return;
+            }
+            width = digits;
+            int precision = -1;
+            if (*p == '.') {
+                p++;
+                precision = 0;
+                while (*p >= '0' && *p <= '9') {
+                    precision = (precision * 10) + (*p++ - '0');
+                    if (precision > MAX_DECIMALS)
+                        return;
+                }
+            }
+            while (*p == 'l' || *p == 'h' || *p == 'z' || *p == 'j' || *p == 't' || *p == 'L') {
+                p++;
+            }
+            switch (*p++) {
+                case 'd':
+                case 'i':
+                case 'u':
+                    // precision on integers means minimum digits, leave that to printf
+                    if (precision >= 0)
+                        return;
+                    floating = false;
+                    unsigned_conversion = p[-1] == 'u';
+                    decimals = 0;
+                    break;
+                case 'f':
+                case 'F':
+                    floating = true;
+                    decimals = precision < 0 ? 6 : precision;
+                    break;
+                default:
+                    return;
+            }
+        }
+        if (!converted)
+            return;
+        suffix_length = length - prefix_length;
+        _supported = true;
+    }
+
+    const char * _format;
+    char affix[MAX_AFFIX];
+    uint8_t prefix_length = 0;
+    uint8_t suffix_length = 0;
+    uint8_t width = 0;
+    uint8_t decimals = 0;
+    bool floating = false;
+    bool unsigned_conversion = false;
+    bool left = false;
+    bool plus = false;
+    bool space = false;
+    bool zero = false;
+    bool _supported = false;
+};
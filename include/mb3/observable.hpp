@@ -1,14 +1,24 @@
 #pragma once
 
+#include <atomic>
 #include <vector>
-#include <memory>
 #include <mb3/updatable.hpp>
 #include <mb3/can.hpp>
+#include <mb3/subscription.hpp>
+#include <mb3/fixed_point.hpp>
+#include <mb3/observable_policy.hpp>
+#include <mb3/derived.hpp>
  
-/// @brief The base observable interface
-class IObservable : public IUpdatable {
+/// @brief The base observable interface.
+/// Observables register themselves with the @ref ObservableManager on
+/// construction and unregister on destruction; the manager doesn't own them.
+/// Observables bound to a signal are queued on the manager's dirty list when it
+/// changes; the others are polled. Observables notify their own subscribers
+/// (widgets) when their display value changes.
+class IObservable : public IUpdatable, public Subscribable {
 public:
-    virtual ~IObservable() = default;
+    inline IObservable();
+    virtual inline ~IObservable();
     virtual void update() { 
         _hasChanged = true;
     }
@@ -21,26 +31,188 @@ public:
         }
     }
 
+    /// @brief Queue for the next @ref ObservableManager::update, safe from any task
+    inline void markDirty();
+
+    /// @brief Whether a source queues this observable, rather than it being polled
+    bool isNotified() const {
+        return notified;
+    }
+
 protected:
-    bool _hasChanged;
+    /// @brief Have source mark this observable dirty when it changes
+    template <typename Source>
+    void bind(Source * source) {
+        // signals, table signals and other observables are all Subscribable
+        if constexpr (std::is_base_of<Subscribable, Source>::value) {
+            static_cast<Subscribable*>(source)->subscribe(source_subscription);
+            setNotified();
+        }
+    }
+
+    inline void setNotified();
+
+    bool _hasChanged = false;
+    bool notified = false;
+
+private:
+    friend class ObservableManager;
+
+    // registry hooks first, next to the vtable pointer, so a registry walk
+    // touches one cache line per observable
+    IObservable * registry_prev = nullptr;
+    IObservable * registry_next = nullptr;
+    bool registered = false;
+
+    std::atomic<bool> queued{false};
+    IObservable * dirty_next = nullptr;
+    Subscription source_subscription{[](void * observable) { static_cast<IObservable*>(observable)->markDirty(); }, this};
 };
 
+/// @brief Registry of live observables, and the dirty list.
+/// Registration happens from the UI task (screens being built or torn down);
+/// only @ref IObservable::markDirty is safe from other tasks.
 class ObservableManager {
+    /// @brief Intrusive list in registration order (only used statically, so zero initialised)
+    struct List {
+        IObservable * head;
+        IObservable * tail;
+        size_t count;
+
+        void append(IObservable * observable) {
+            observable->registry_prev = tail;
+            observable->registry_next = nullptr;
+            if (tail)
+                tail->registry_next = observable;
+            else
+                head = observable;
+            tail = observable;
+            count++;
+        }
+
+        void unlink(IObservable * observable) {
+            if (observable->registry_prev)
+                observable->registry_prev->registry_next = observable->registry_next;
+            else
+                head = observable->registry_next;
+            if (observable->registry_next)
+                observable->registry_next->registry_prev = observable->registry_prev;
+            else
+                tail = observable->registry_prev;
+            observable->registry_prev = observable->registry_next = nullptr;
+            count--;
+        }
+    };
+
 public:
-    template <typename T>
-    static void add(T * observable) {
-        _observables.push_back(std::unique_ptr<T>(observable));
+    /// @brief Register an observable. Observables register themselves, this is a no-op for them.
+    static void add(IObservable * observable) {
+        if (observable->registered)
+            return;
+        (observable->notified ? notified : polled).append(observable);
+        observable->registered = true;
     }
 
+    static void remove(IObservable * observable) {
+        if (!observable->registered)
+            return;
+        (observable->notified ? notified : polled).unlink(observable);
+        observable->registered = false;
+    }
+
+    /// @brief Recompute derived signals, update dirty observables, then poll
+    /// those without a source. Call from the UI task.
     inline static void update() {
-        for (auto &observable : _observables) {
+        DerivedGraph::update();
+        // take the whole list at once, producers keep pushing onto a fresh one
+        auto observable = dirty.exchange(nullptr, std::memory_order_acquire);
+        while (observable) {
+            auto next = observable->dirty_next;
+            // an RMW, so a producer that still saw it queued has its value visible to update()
+            observable->queued.exchange(false, std::memory_order_acq_rel);
+            observable->update();
+            observable = next;
+        }
+        for (observable = polled.head; observable; ) {
+            auto next = observable->registry_next;
             observable->update();
+            observable = next;
         }
     }
 
-    static std::vector<std::unique_ptr<IObservable>> _observables;
+    /// @brief Visit every registered observable: polled ones, then notified ones,
+    /// each in registration order
+    template <typename Visitor>
+    static void each(Visitor visit) {
+        for (auto list : {&polled, &notified}) {
+            for (auto observable = list->head; observable; observable = observable->registry_next) {
+                visit(*observable);
+            }
+        }
+    }
+
+    static size_t size() {
+        return polled.count + notified.count;
+    }
+
+    static size_t polledCount() {
+        return polled.count;
+    }
+
+private:
+    friend class IObservable;
+
+    /// @brief Treiber stack push, from any task
+    static void push(IObservable * observable) {
+        auto head = dirty.load(std::memory_order_relaxed);
+        do {
+            observable->dirty_next = head;
+        } while (!dirty.compare_exchange_weak(head, observable, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /// @brief Drop an observable from the dirty list, from the UI task
+    static void cancel(IObservable * observable) {
+        auto head = dirty.exchange(nullptr, std::memory_order_acquire);
+        while (head) {
+            auto next = head->dirty_next;
+            if (head != observable)
+                push(head);
+            head = next;
+        }
+    }
+
+    static inline std::atomic<IObservable*> dirty{nullptr};
+    static inline List polled;
+    static inline List notified;
 };
 
+IObservable::IObservable() {
+    ObservableManager::add(this);
+}
+
+IObservable::~IObservable() {
+    // no source may queue this once the dirty list has been checked
+    source_subscription.unsubscribe();
+    ObservableManager::remove(this);
+    if (queued.load(std::memory_order_acquire))
+        ObservableManager::cancel(this);
+}
+
+void IObservable::markDirty() {
+    if (!queued.exchange(true, std::memory_order_acq_rel))
+        ObservableManager::push(this);
+}
+
+void IObservable::setNotified() {
+    if (notified)
+        return;
+    bool was_registered = registered;
+    ObservableManager::remove(this);
+    notified = true;
+    if (was_registered)
+        ObservableManager::add(this);
+}
+
 /// @brief A variable manager that can be bound to a pointer
 /// @tparam D The primitive display type for formatting, math
 /// @tparam T The optional smart type @ref ICanSignal
@@ -50,12 +222,14 @@ class TObservable : public IObservable {
 public:
 
     TObservable(DataType * p_value) : p_value(p_value) {
-        ObservableManager::add(this);
         update();
-        if constexpr (std::is_base_of<ICanSignal, DataType>::value) {
-            auto signal = static_cast<ICanSignal*>(p_value);
-            signal->callbacks.emplace_back(this);
-        }
+        bind(p_value);
+    }
+
+    /// @brief Bind to a value computed elsewhere, updated when source notifies
+    TObservable(DataType * p_value, Subscribable & source) : p_value(p_value) {
+        update();
+        bind(&source);
     }
 
     virtual ~TObservable() override = default;
@@ -64,8 +238,26 @@ public:
 
     virtual void update() override {
         newValue = computeDisplayValue((InputType)*p_value);
-        _hasChanged |= !(displayValue == newValue);
-        displayValue = newValue;
+        if constexpr (std::is_arithmetic<DisplayType>::value) {
+            if (policy && !applyPolicy())
+                return;
+        }
+        if (!(displayValue == newValue)) {
+            _hasChanged = true;
+            displayValue = newValue;
+            notify();
+        }
+    }
+
+    /// @brief Filter changes through policy (deadband, hysteresis, rate cap, smoothing)
+    void setPolicy(ObservablePolicy & policy) {
+        static_assert(std::is_arithmetic<DisplayType>::value, "policies work on numeric display values");
+        policy.reset();
+        this->policy = &policy;
+    }
+
+    void clearPolicy() {
+        policy = nullptr;
     }
 
     virtual DisplayType computeDisplayValue(InputType input) {
@@ -81,7 +273,24 @@ public:
     }
 
     DataType * p_value;
-    DisplayType displayValue; // = 0;
+    DisplayType displayValue{};
+
+protected:
+    /// @return whether newValue should be shown
+    bool applyPolicy() {
+        float value = newValue;
+        auto result = policy->filter(value);
+        // polled observables come back anyway, notified ones need queueing
+        // until the value is shown and smoothing has caught up
+        if (notified && (result == ObservablePolicy::Result::Defer || policy->isSettling()))
+            markDirty();
+        if (result != ObservablePolicy::Result::Accept)
+            return false;
+        newValue = (DisplayType)value;
+        return true;
+    }
+
+    ObservablePolicy * policy = nullptr;
 };
 
 template <typename D, typename T = D, typename I = D>
@@ -102,4 +311,58 @@ public:
 
     DisplayType scalar;
     DisplayType offset;
-};
\ No newline at end of file
+};
+
+/// @brief Unscaled value of a signal (or plain integer) for @ref TFixedObservable
+template <typename DataType>
+uint32_t raw_value(DataType & data) {
+    if constexpr (std::is_base_of<ICanSignal, DataType>::value) {
+        ICanSignal & signal = data;
+        if (signal.size() <= 8)
+            return signal.get<uint8_t>();
+        if (signal.size() <= 16)
+            return signal.get<uint16_t>();
+        return signal.get<uint32_t>() & (signal.size() >= 32 ? 0xFFFFFFFF : (1UL << signal.size()) - 1);
+    } else if constexpr (std::is_arithmetic<DataType>::value) {
+        return (uint32_t)data;
+    } else {
+        return data.raw();
+    }
+}
+
+/// @brief Observable that converts with a @ref FixedConversion instead of floats
+/// @tparam Conversion FixedConversion<Scale, Offset, F, Bits>
+/// @tparam DataType signal type, or an integer holding the raw value
+template <typename Conversion, typename DataType>
+class TFixedObservable : public IObservable {
+public:
+    using DisplayType = typename Conversion::value_type;
+
+    TFixedObservable(DataType * p_value) : p_value(p_value) {
+        update();
+        bind(p_value);
+    }
+
+    virtual ~TFixedObservable() override = default;
+
+    virtual void update() override {
+        auto newValue = Conversion::decode(raw_value(*p_value));
+        if (newValue != displayValue) {
+            _hasChanged = true;
+            displayValue = newValue;
+            notify();
+        }
+    }
+
+    DisplayType get() const {
+        return displayValue;
+    }
+
+    /// @return length written
+    size_t format(char * buffer, size_t size, uint8_t decimals) const {
+        return fixed_format(buffer, size, displayValue, decimals);
+    }
+
+    DataType * p_value;
+    DisplayType displayValue{};
+};
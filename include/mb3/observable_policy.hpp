@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <mb3/platform.hpp>
+
+/// @brief Decides whether a new display value is worth a redraw.
+/// Attach one to an observable with `observable.setPolicy(policy)`; it holds
+/// per-observable state, so don't share one between observables.
+///
+///     ObservablePolicy coolant_policy = ObservablePolicy().withDeadband(0.5f).withMinInterval(250000);
+///     widget.o_value.setPolicy(coolant_policy);
+struct ObservablePolicy {
+    enum class Result : uint8_t {
+        Accept,
+        Reject,
+        /// @brief Not now, but update again next frame (rate capped or still smoothing)
+        Defer,
+    };
+
+    /// @brief Ignore changes smaller than this
+    ObservablePolicy & withDeadband(float absolute) {
+        deadband = absolute;
+        return *this;
+    }
+
+    /// @brief Ignore changes smaller than this fraction of the shown value
+    ObservablePolicy & withRelativeDeadband(float fraction) {
+        relative = fraction;
+        return *this;
+    }
+
+    /// @brief A change against the last direction of movement must exceed this
+    ObservablePolicy & withHysteresis(float band) {
+        hysteresis = band;
+        return *this;
+    }
+
+    /// @brief Show at most one change per interval
+    ObservablePolicy & withMinInterval(uint32_t interval_us) {
+        min_interval_us = interval_us;
+        return *this;
+    }
+
+    /// @brief Exponential smoothing, weight of the previous value (0 = off, towards 1 = slower)
+    ObservablePolicy & withSmoothing(float weight) {
+        smoothing = weight;
+        return *this;
+    }
+
+    /// @brief Filter value in place, cheapest checks first
+    Result filter(float & value) {
+        if (smoothing > 0.f) {
+            filtered = primed ? (filtered * smoothing) + (value * (1.f - smoothing)) : value;
+            settling = std::fabs(filtered - value) > settle_band(value);
+            // close enough: land exactly on the source value
+            if (!settling)
+                filtered = value;
+            value = filtered;
+        }
+        if (!primed) {
+            accept(value);
+            return Result::Accept;
+        }
+
+        float delta = value - shown;
+        float magnitude = std::fabs(delta);
+        if (magnitude == 0.f || magnitude < deadband || magnitude < std::fabs(shown) * relative)
+            return settling ? Result::Defer : Result::Reject;
+        int8_t towards = delta > 0.f ? 1 : -1;
+        if (towards == -direction && magnitude < hysteresis)
+            return settling ? Result::Defer : Result::Reject;
+
+        if (min_interval_us) {
+            int64_t now = clock();
+            if (now - shown_at < (int64_t)min_interval_us)
+                return Result::Defer;
+            shown_at = now;
+        }
+        direction = towards;
+        shown = value;
+        return Result::Accept;
+    }
+
+    /// @brief Whether smoothing still lags the source value, so another update is due
+    bool isSettling() const {
+        return settling;
+    }
+
+    /// @brief Forget the shown value, the next one is accepted
+    void reset() {
+        primed = false;
+        settling = false;
+        direction = 0;
+    }
+
+    float deadband = 0.f;
+    float relative = 0.f;
+    float hysteresis = 0.f;
+    uint32_t min_interval_us = 0;
+    float smoothing = 0.f;
+
+    /// @brief Time source, for tests and replays
+    static inline int64_t (*clock)() = esp_timer_get_time;
+
+private:
+    void accept(float value) {
+        primed = true;
+        shown = value;
+        shown_at = min_interval_us ? clock() : 0;
+        direction = 0;
+    }
+
+    // where smoothing stops and snaps to the source value
+    float settle_band(float value) const {
+        float band = std::fabs(value) * 1e-4f;
+        return (deadband * 0.5f > band ? deadband * 0.5f : band) + 1e-6f;
+    }
+
+    float shown = 0.f;
+    float filtered = 0.f;
+    int64_t shown_at = 0;
+    int8_t direction = 0;
+    bool primed = false;
+    bool settling = false;
+};
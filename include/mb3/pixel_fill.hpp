@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+/// @brief Fill a w x h rectangle at (x, y) of a pixel buffer with one pixel value.
+/// @param bpp bits per pixel: 1, 2, 4 (MSB first, like LVGL's indexed and
+/// alpha formats), 8, 16, 24 or 32
+/// @param pixel the pixel's bytes as they sit in memory, little-endian packed,
+/// or the index/alpha value for sub-byte formats
+///
+/// Uniform pixels (every byte the same, zero included) become one memset for
+/// the whole region when the rows are contiguous, or one per row. Other pixels
+/// are written as a repeating 24-byte pattern of 64-bit stores (24 being a
+/// multiple of every pixel size), which compilers vectorise where they can.
+inline void fillPixels(uint8_t * data, uint32_t stride, int32_t x, int32_t y, int32_t w, int32_t h, uint8_t bpp, uint32_t pixel) {
+    if (w <= 0 || h <= 0 || !data)
+        return;
+    uint8_t * row = data + ((size_t)y * stride);
+
+    if (bpp < 8) {
+        // repeat the value across a byte, then mask the partial bytes at the ends
+        uint8_t value = pixel & ((1u << bpp) - 1);
+        uint8_t fill = value;
+        for (uint8_t bits = bpp; bits < 8; bits *= 2) {
+            fill |= fill << bits;
+        }
+        uint32_t first = x * bpp;
+        uint32_t last = (x + w) * bpp;
+        size_t b0 = first / 8;
+        size_t b1 = last / 8;
+        uint8_t head = 0xFF >> (first % 8);
+        uint8_t tail = ~(0xFF >> (last % 8));
+        for (int32_t j = 0; j < h; j++, row += stride) {
+            if (b0 == b1) {
+                uint8_t mask = head & tail;
+                row[b0] = (row[b0] & ~mask) | (fill & mask);
+                continue;
+            }
+            size_t start = b0;
+            if (first % 8) {
+                row[b0] = (row[b0] & ~head) | (fill & head);
+                start++;
+            }
+            memset(row + start, fill, b1 - start);
+            if (last % 8)
+                row[b1] = (row[b1] & ~tail) | (fill & tail);
+        }
+        return;
+    }
+
+    uint8_t size = bpp / 8;
+    size_t offset = (size_t)x * size;
+    size_t bytes = (size_t)w * size;
+    uint8_t pattern[4];
+    for (uint8_t i = 0; i < size; i++) {
+        pattern[i] = pixel >> (8 * i);
+    }
+
+    bool uniform = true;
+    for (uint8_t i = 1; i < size; i++) {
+        uniform &= pattern[i] == pattern[0];
+    }
+    if (uniform) {
+        if (bytes == stride)
+            memset(row, pattern[0], bytes * h);
+        else {
+            for (int32_t j = 0; j < h; j++, row += stride) {
+                memset(row + offset, pattern[0], bytes);
+            }
+        }
+        return;
+    }
+
+    // bytes up to 8-byte alignment, then the pattern from the phase reached
+    uint8_t stream[32];
+    for (uint8_t i = 0; i < sizeof(stream); i++) {
+        stream[i] = pattern[i % size];
+    }
+    for (int32_t j = 0; j < h; j++, row += stride) {
+        uint8_t * dst = row + offset;
+        size_t lead = (8 - ((uintptr_t)dst & 7)) & 7;
+        if (lead > bytes)
+            lead = bytes;
+        for (size_t i = 0; i < lead; i++) {
+            dst[i] = stream[i % size];
+        }
+        uint64_t words[3];
+        memcpy(words, stream + (lead % size), sizeof(words));
+        uint8_t * out = dst + lead;
+        size_t count = (bytes - lead) / 8;
+        size_t k = 0;
+        for (; k + 3 <= count; k += 3) {
+            memcpy(out + (k * 8), &words[0], 8);
+            memcpy(out + (k * 8) + 8, &words[1], 8);
+            memcpy(out + (k * 8) + 16, &words[2], 8);
+        }
+        for (; k < count; k++) {
+            memcpy(out + (k * 8), &words[k % 3], 8);
+        }
+        // leftover bytes carry on the pattern
+        size_t done = lead + (count * 8);
+        for (size_t i = done; i < bytes; i++) {
+            dst[i] = stream[i % size];
+        }
+    }
+}
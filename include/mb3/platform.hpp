@@ -0,0 +1,178 @@
+#pragma once
+
+// Everything MB3 needs from ESP-IDF/Arduino that isn't LVGL or FreeRTOS.
+// On the device this just pulls in the real headers; under `env:native` it
+// provides stand-ins with the same names so the CAN decode path can be built
+// and exercised on the host.
+
+#include <cstdint>
+#include <cstdio>
+
+#if defined(ESP_PLATFORM)
+
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/twai.h"
+
+#if ARDUINO
+#include <esp32-hal-log.h>
+#else
+#include "esp_log.h"
+#ifndef log_e
+#define log_e(format, ...) ESP_LOGE("MB3", format __VA_OPT__(,) __VA_ARGS__)
+#define log_w(format, ...) ESP_LOGW("MB3", format __VA_OPT__(,) __VA_ARGS__)
+#define log_i(format, ...) ESP_LOGI("MB3", format __VA_OPT__(,) __VA_ARGS__)
+#define log_d(format, ...) ESP_LOGD("MB3", format __VA_OPT__(,) __VA_ARGS__)
+#endif
+#endif
+
+/// @brief A short critical section shared by tasks on either core. Nests on
+/// the same task, like the portMUX it wraps.
+class Spinlock {
+public:
+    void lock() {
+        portENTER_CRITICAL(&mux);
+    }
+
+    void unlock() {
+        portEXIT_CRITICAL(&mux);
+    }
+
+    /// @brief Let another task finish what a waiter is waiting for, outside
+    /// the lock (a tick, so lower priorities get to run too)
+    static void pause() {
+        vTaskDelay(1);
+    }
+
+private:
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+#else // native
+
+#include <cstdlib>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#define MB3_NATIVE 1
+
+#define MALLOC_CAP_32BIT    (1 << 1)
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_DMA      (1 << 3)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT  (1 << 12)
+
+inline void * heap_caps_malloc(size_t size, uint32_t caps) {
+    return malloc(size);
+}
+
+inline void * heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    return calloc(n, size);
+}
+
+inline void * heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps) {
+    return aligned_alloc(alignment, ((size + alignment - 1) / alignment) * alignment);
+}
+
+inline void heap_caps_free(void * ptr) {
+    free(ptr);
+}
+
+inline int64_t esp_timer_get_time() {
+    using namespace std::chrono;
+    static const auto start = steady_clock::now();
+    return duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+#define log_e(format, ...) printf("[E] " format "\n" __VA_OPT__(,) __VA_ARGS__)
+#define log_w(format, ...) printf("[W] " format "\n" __VA_OPT__(,) __VA_ARGS__)
+#define log_i(format, ...) printf("[I] " format "\n" __VA_OPT__(,) __VA_ARGS__)
+#define log_d(format, ...) printf("[D] " format "\n" __VA_OPT__(,) __VA_ARGS__)
+
+class Spinlock {
+public:
+    void lock() {
+        mutex.lock();
+    }
+
+    void unlock() {
+        mutex.unlock();
+    }
+
+    static void pause() {
+        std::this_thread::yield();
+    }
+
+private:
+    std::recursive_mutex mutex;
+};
+
+typedef int esp_err_t;
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_NOT_SUPPORTED   0x106
+#define ESP_ERR_TIMEOUT         0x107
+
+#define TWAI_FRAME_MAX_DLC 8
+
+#define TWAI_ALERT_TX_IDLE          0x00000001
+#define TWAI_ALERT_TX_SUCCESS       0x00000002
+#define TWAI_ALERT_RX_DATA          0x00000004
+#define TWAI_ALERT_BELOW_ERR_WARN   0x00000008
+#define TWAI_ALERT_ERR_ACTIVE       0x00000010
+#define TWAI_ALERT_RECOVERY_IN_PROGRESS 0x00000020
+#define TWAI_ALERT_BUS_RECOVERED    0x00000040
+#define TWAI_ALERT_ARB_LOST         0x00000080
+#define TWAI_ALERT_ABOVE_ERR_WARN   0x00000100
+#define TWAI_ALERT_BUS_ERROR        0x00000200
+#define TWAI_ALERT_TX_FAILED        0x00000400
+#define TWAI_ALERT_RX_QUEUE_FULL    0x00000800
+#define TWAI_ALERT_ERR_PASS         0x00001000
+#define TWAI_ALERT_BUS_OFF          0x00002000
+#define TWAI_ALERT_RX_FIFO_OVERRUN  0x00004000
+#define TWAI_ALERT_ALL              0x00007FFF
+
+typedef struct {
+    union {
+        struct {
+            uint32_t extd: 1;
+            uint32_t rtr: 1;
+            uint32_t ss: 1;
+            uint32_t self: 1;
+            uint32_t dlc_non_comp: 1;
+            uint32_t reserved: 27;
+        };
+        uint32_t flags;
+    };
+    uint32_t identifier;
+    uint8_t data_length_code;
+    uint8_t data[TWAI_FRAME_MAX_DLC];
+} twai_message_t;
+
+typedef enum {
+    TWAI_STATE_STOPPED,
+    TWAI_STATE_RUNNING,
+    TWAI_STATE_BUS_OFF,
+    TWAI_STATE_RECOVERING,
+} twai_state_t;
+
+typedef struct {
+    twai_state_t state;
+    uint32_t msgs_to_tx;
+    uint32_t msgs_to_rx;
+    uint32_t tx_error_counter;
+    uint32_t rx_error_counter;
+    uint32_t tx_failed_count;
+    uint32_t rx_missed_count;
+    uint32_t rx_overrun_count;
+    uint32_t arb_lost_count;
+    uint32_t bus_error_count;
+} twai_status_info_t;
+
+#endif
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <lvgl.h>
+#include <stdint.h>
+#include <string.h>
+#include <mb3/platform.hpp>
+#include <mb3/lvgl_mb3.hpp>
+#include <mb3/shape.hpp>
+
+/// @brief A vector path recorded once and drawn many times, for bezels, gauge
+/// outlines and other static geometry. The segments live in one path whose
+/// arrays are shrunk to fit after recording, and the style in a descriptor
+/// kept alongside, so a draw allocates nothing of its own and builds no
+/// segments.
+/// With @ref cache, the path is also rasterised once into a PSRAM image and
+/// draws become a blit, skipping tessellation while the geometry and colors
+/// stay the same. Single-color paths are cached as A8 coverage at full
+/// opacity, so changing their color or opacity doesn't re-rasterise either. Translations use the cached image,
+/// other transforms draw the path.
+///
+///     static RetainedPath bezel;
+///     bezel.record().start(10, 0).line(100).round(10).turn().line(60).stroke(2, color).finish();
+///     bezel.cache();
+///     ...
+///     bezel.draw(layer, x, y);
+class RetainedPath {
+public:
+    RetainedPath() {
+        initVectorDsc(&style, nullptr);
+
+        path.quality = LV_VECTOR_PATH_QUALITY_HIGH;
+        lv_array_init(&path.ops, 8, sizeof(lv_vector_path_op_t));
+        lv_array_init(&path.points, 8, sizeof(lv_fpoint_t));
+    }
+
+    ~RetainedPath() {
+        lv_array_deinit(&path.ops);
+        lv_array_deinit(&path.points);
+        heap_caps_free(cache_data);
+    }
+
+    RetainedPath(const RetainedPath &) = delete;
+    RetainedPath & operator=(const RetainedPath &) = delete;
+
+    /// @brief Replace the geometry and style: build it with the returned
+    /// @ref Shape, whose finish() just ends the recording
+    Shape record() {
+        lv_vector_path_clear(&path);
+        recorded = false;
+        drop_cache();
+        return Shape(&style, &path);
+    }
+
+    /// @brief Rasterise now, and keep the image up to date on color changes.
+    /// Call it outside rendering, once recorded.
+    RetainedPath & cache() {
+        cached = true;
+        rasterize();
+        return *this;
+    }
+
+    RetainedPath & setFillColor(lv_color_t color, lv_opa_t opa = LV_OPA_COVER) {
+        lv_vector_dsc_set_fill_color(&style, color);
+        lv_vector_dsc_set_fill_opa(&style, opa);
+        restyled();
+        return *this;
+    }
+
+    RetainedPath & setStrokeColor(lv_color_t color, lv_opa_t opa = LV_OPA_COVER) {
+        lv_vector_dsc_set_stroke_color(&style, color);
+        lv_vector_dsc_set_stroke_opa(&style, opa);
+        restyled();
+        return *this;
+    }
+
+    /// @brief Draw translated by (x, y)
+    void draw(lv_layer_t * layer, float x = 0.f, float y = 0.f) {
+        compact();
+        if (cache_data && x == (int32_t)x && y == (int32_t)y) {
+            blit(layer, (int32_t)x, (int32_t)y);
+            return;
+        }
+        lv_matrix_t matrix;
+        lv_matrix_identity(&matrix);
+        lv_matrix_translate(&matrix, x, y);
+        submit(layer, matrix);
+    }
+
+    /// @brief Draw through any transform
+    void draw(lv_layer_t * layer, const lv_matrix_t & matrix) {
+        compact();
+        submit(layer, matrix);
+    }
+
+    /// @brief Untransformed bounds, stroke included
+    bool bounds(lv_area_t & out) const {
+        return pathBounds(&path, style.current_dsc, out);
+    }
+
+    bool isCached() const {
+        return cache_data != nullptr;
+    }
+
+    /// @brief PSRAM held by the cached image
+    size_t memory() const {
+        return cache_data ? cache.data_size : 0;
+    }
+
+private:
+    enum Parts : uint8_t { FILL = 1, STROKE = 2 };
+
+    uint8_t shown() const {
+        return (style.current_dsc.fill_dsc.opa > LV_OPA_MIN ? FILL : 0)
+            | (style.current_dsc.stroke_dsc.opa > LV_OPA_MIN ? STROKE : 0);
+    }
+
+    /// @brief Only one of fill and stroke shows, or both in the same color
+    /// and opaque: where a translucent stroke overlaps the fill, the two
+    /// blend to more than either opacity, which one coverage can't hold
+    bool monochrome() const {
+        auto & fill = style.current_dsc.fill_dsc;
+        auto & stroke = style.current_dsc.stroke_dsc;
+        if (shown() != (FILL | STROKE))
+            return true;
+        return fill.opa >= LV_OPA_MAX && stroke.opa >= LV_OPA_MAX && lv_color32_eq(fill.color, stroke.color);
+    }
+
+    /// @brief The opacity a monochrome path shows with
+    lv_opa_t opa() const {
+        auto & fill = style.current_dsc.fill_dsc;
+        return fill.opa > LV_OPA_MIN ? fill.opa : style.current_dsc.stroke_dsc.opa;
+    }
+
+    lv_color_t color() const {
+        auto & fill = style.current_dsc.fill_dsc;
+        return lv_color_make(
+            fill.opa > LV_OPA_MIN ? fill.color.red : style.current_dsc.stroke_dsc.color.red,
+            fill.opa > LV_OPA_MIN ? fill.color.green : style.current_dsc.stroke_dsc.color.green,
+            fill.opa > LV_OPA_MIN ? fill.color.blue : style.current_dsc.stroke_dsc.color.blue);
+    }
+
+    void restyled() {
+        // A8 coverage is recolored and faded at blit time while the same parts
+        // show, anything else is re-rasterised
+        if (!cache_data || (cache.header.cf == LV_COLOR_FORMAT_A8 && monochrome() && shown() == cache_parts))
+            return;
+        drop_cache();
+        if (cached)
+            rasterize();
+    }
+
+    /// @brief Recording grows the arrays geometrically, trim them once
+    void compact() {
+        if (recorded)
+            return;
+        lv_array_shrink(&path.ops);
+        lv_array_shrink(&path.points);
+        recorded = true;
+    }
+
+    void submit(lv_layer_t * layer, const lv_matrix_t & matrix) {
+        lv_vector_dsc_t dsc = {0};
+        dsc.layer = layer;
+        dsc.current_dsc = style.current_dsc;
+        dsc.current_dsc.matrix = matrix;
+        dsc.current_dsc.scissor_area = layer->_clip_area;
+        lv_vector_dsc_add_path(&dsc, &path);
+        lv_draw_vector(&dsc);
+        if (dsc.tasks.task_list) {
+            lv_vector_for_each_destroy_tasks(dsc.tasks.task_list, NULL, NULL);
+            dsc.tasks.task_list = NULL;
+        }
+
+        lv_area_t area;
+        if (pathBounds(&path, dsc.current_dsc, area))
+            CanvasDirtyTracker::note(layer, area);
+    }
+
+    void blit(lv_layer_t * layer, int32_t x, int32_t y) {
+        lv_draw_image_dsc_t dsc;
+        lv_draw_image_dsc_init(&dsc);
+        dsc.src = &cache;
+        if (cache.header.cf == LV_COLOR_FORMAT_A8) {
+            dsc.recolor = color();
+            dsc.recolor_opa = LV_OPA_COVER;
+            dsc.opa = opa();
+        }
+        lv_area_t area = {cache_area.x1 + x, cache_area.y1 + y, cache_area.x2 + x, cache_area.y2 + y};
+        lv_draw_image(layer, &dsc, &area);
+        CanvasDirtyTracker::note(layer, area);
+    }
+
+    void rasterize() {
+        compact();
+        if (cache_data || !bounds(cache_area))
+            return;
+        int32_t w = lv_area_get_width(&cache_area);
+        int32_t h = lv_area_get_height(&cache_area);
+
+        // the software vector renderer only draws into (X)ARGB8888: single
+        // color paths are drawn white in a scratch buffer and keep its alpha
+        bool alpha_only = monochrome();
+        lv_draw_buf_t scratch;
+        uint8_t * scratch_data = nullptr;
+        lv_draw_buf_t * target = &cache;
+        if (alpha_only) {
+            scratch_data = allocate(&scratch, w, h, LV_COLOR_FORMAT_ARGB8888);
+            if (!scratch_data)
+                return;
+            target = &scratch;
+        }
+        else {
+            cache_data = allocate(&cache, w, h, LV_COLOR_FORMAT_ARGB8888);
+            if (!cache_data)
+                return;
+        }
+
+        lv_vector_draw_dsc_t saved = style.current_dsc;
+        cache_parts = shown();
+        if (alpha_only) {
+            // full coverage, the opacity is applied by blit()
+            style.current_dsc.fill_dsc.color = lv_color_to_32(lv_color_white(), 0xFF);
+            style.current_dsc.stroke_dsc.color = lv_color_to_32(lv_color_white(), 0xFF);
+            if (cache_parts & FILL)
+                style.current_dsc.fill_dsc.opa = LV_OPA_COVER;
+            if (cache_parts & STROKE)
+                style.current_dsc.stroke_dsc.opa = LV_OPA_COVER;
+        }
+        lv_obj_t * canvas = lv_canvas_create(lv_layer_top());
+        lv_obj_add_flag(canvas, LV_OBJ_FLAG_HIDDEN);
+        lv_canvas_set_draw_buf(canvas, target);
+        {
+            CanvasLayer layer(canvas);
+            lv_matrix_t matrix;
+            lv_matrix_identity(&matrix);
+            lv_matrix_translate(&matrix, -cache_area.x1, -cache_area.y1);
+            submit(layer, matrix);
+        }
+        lv_obj_delete(canvas);
+        style.current_dsc = saved;
+
+        if (alpha_only) {
+            cache_data = allocate(&cache, w, h, LV_COLOR_FORMAT_A8);
+            if (cache_data)
+                extractAlpha(&scratch, &cache);
+            heap_caps_free(scratch_data);
+        }
+    }
+
+    /// @brief A cleared PSRAM image of w x h in buf
+    static uint8_t * allocate(lv_draw_buf_t * buf, int32_t w, int32_t h, lv_color_format_t format) {
+        uint32_t stride = LV_DRAW_BUF_STRIDE(w, format);
+        size_t size = stride * h;
+        auto data = (uint8_t*)heap_caps_aligned_alloc(LV_DRAW_BUF_ALIGN, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!data) {
+            log_e("retained path cache: %u bytes", (unsigned)size);
+            return nullptr;
+        }
+        memset(data, 0, size);
+        lv_draw_buf_init(buf, w, h, format, stride, data, size);
+        return data;
+    }
+
+    void drop_cache() {
+        heap_caps_free(cache_data);
+        cache_data = nullptr;
+    }
+
+    lv_vector_dsc_t style = {0};
+    lv_vector_path_t path;
+    bool recorded = false;
+    bool cached = false;
+    lv_draw_buf_t cache;
+    lv_area_t cache_area;
+    uint8_t * cache_data = nullptr;
+    uint8_t cache_parts = 0;
+};
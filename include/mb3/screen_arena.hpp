@@ -0,0 +1,219 @@
+#pragma once
+
+#include <lvgl.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <mb3/platform.hpp>
+#include <mb3/arena.hpp>
+#include <mb3/defaults.hpp>
+
+/// @brief One contiguous arena per screen for @ref Widget objects, so screens
+/// built and deleted over and over don't fragment the LVGL heap. Widgets
+/// created inside a @ref Scope are bump allocated from their screen's arena
+/// (MB3_SCREEN_ARENA_SIZE, further widgets use lv_malloc). Their destructor
+/// hooks run as usual when LVGL deletes them, and the arena goes in one piece
+/// once the screen is deleted. Widgets built in a scope must be deleted with
+/// its screen.
+///
+/// LVGL frees deleted objects itself, so this needs MB3_SCREEN_ARENA and the
+/// link flag -Wl,--wrap=lv_free_core, which lets those frees skip arena
+/// memory. Without the wrap, widgets fall back to lv_malloc (logged once).
+/// Every lv_free goes through the wrap, from any thread (draw units free
+/// too), so it only checks a fixed table of address ranges that the UI task
+/// updates without locks.
+///
+///     lv_obj_t * screen = lv_obj_create(nullptr);
+///     {
+///         ScreenArena::Scope scope(screen);
+///         new Gauge(screen, ...);
+///     }
+class ScreenArena {
+public:
+    class Scope {
+    public:
+        Scope(lv_obj_t * screen) : previous(current) {
+            current = arena_for(screen);
+        }
+
+        ~Scope() {
+            current = previous;
+        }
+
+        Scope(const Scope &) = delete;
+        Scope & operator=(const Scope &) = delete;
+
+    private:
+        BumpArena * previous;
+    };
+
+    /// @return zeroed memory from the current scope's arena, nullptr outside
+    /// a scope (use lv_malloc)
+    static void * allocate(size_t size) {
+        if (!current)
+            return nullptr;
+        void * data = current->allocate(size);
+        if (!data)
+            return nullptr;
+        memset(data, 0, size);
+        _allocations++;
+        return data;
+    }
+
+    /// @brief Safe from any thread
+    static bool owns(const void * data) {
+        auto address = (uintptr_t)data;
+        for (auto & range : ranges) {
+            // a range that is changing has no widgets left (or yet) to free
+            uint32_t version = range.version.load(std::memory_order_acquire);
+            if (version & 1)
+                continue;
+            uintptr_t begin = range.begin.load(std::memory_order_relaxed);
+            uintptr_t end = range.end.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (range.version.load(std::memory_order_relaxed) == version && address >= begin && address < end)
+                return true;
+        }
+        return false;
+    }
+
+    /// @brief Called for every lv_free through the lv_free_core wrap
+    /// @return true when data is arena memory, which isn't freed on its own
+    static bool on_lv_free(const void * data) {
+        if (!hooked.load(std::memory_order_relaxed))
+            hooked.store(true, std::memory_order_relaxed);
+        return owns(data);
+    }
+
+    /// @brief Widgets allocated from arenas so far
+    static uint32_t allocations() {
+        return _allocations;
+    }
+
+    /// @brief Arenas released with their screen so far
+    static uint32_t releases() {
+        return _releases;
+    }
+
+    /// @brief Bytes held by all arenas
+    static size_t memory() {
+        size_t bytes = 0;
+        for (auto & entry : arenas) {
+            if (entry.arena)
+                bytes += entry.arena->capacity();
+        }
+        return bytes;
+    }
+
+    static void report() {
+        for (auto & entry : arenas) {
+            if (entry.arena)
+                log_i("screen arena %p: %u bytes used of %u", entry.screen, (unsigned)entry.arena->used(), (unsigned)entry.arena->capacity());
+        }
+        lv_mem_monitor_t monitor;
+        lv_mem_monitor(&monitor);
+        log_i("screen arenas: %u bytes, %u widgets, %u released; LVGL heap %u%% used, %u%% fragmented, %u bytes biggest free",
+            (unsigned)memory(), (unsigned)_allocations, (unsigned)_releases, (unsigned)monitor.used_pct,
+            (unsigned)monitor.frag_pct, (unsigned)monitor.free_biggest_size);
+    }
+
+private:
+    struct Entry {
+        lv_obj_t * screen;
+        BumpArena * arena;
+    };
+
+    /// @brief Where an arena's memory is, a seqlock: odd versions are being
+    /// written by the UI task
+    struct Range {
+        std::atomic<uint32_t> version;
+        std::atomic<uintptr_t> begin;
+        std::atomic<uintptr_t> end;
+
+        void set(uintptr_t from, uintptr_t to) {
+            uint32_t v = version.load(std::memory_order_relaxed);
+            version.store(v + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            begin.store(from, std::memory_order_relaxed);
+            end.store(to, std::memory_order_relaxed);
+            version.store(v + 2, std::memory_order_release);
+        }
+    };
+
+    static BumpArena * arena_for(lv_obj_t * screen) {
+        if (!MB3_SCREEN_ARENA || !screen || !free_hooked())
+            return nullptr;
+        for (auto & entry : arenas) {
+            if (entry.arena && entry.screen == screen)
+                return entry.arena;
+        }
+        for (auto & entry : arenas) {
+            if (entry.arena)
+                continue;
+            // one block, so the range covers all of it
+            auto arena = new BumpArena(MB3_SCREEN_ARENA_SIZE, false);
+            if (!arena->block()) {
+                delete arena;
+                return nullptr;
+            }
+            entry.arena = arena;
+            entry.screen = screen;
+            range_of(entry).set((uintptr_t)arena->block(), (uintptr_t)arena->block() + arena->blockSize());
+            lv_obj_add_event_cb(screen, on_screen_delete, LV_EVENT_DELETE, nullptr);
+            return entry.arena;
+        }
+        log_w("screen arena: all %u in use", (unsigned)MB3_SCREEN_ARENAS);
+        return nullptr;
+    }
+
+    /// @brief Whether LVGL's frees come through the wrap, checked once
+    static bool free_hooked() {
+        if (!probed) {
+            probed = true;
+            lv_free(lv_malloc(1));
+            if (!hooked)
+                log_e("screen arena: link with -Wl,--wrap=lv_free_core, widgets use lv_malloc");
+        }
+        return hooked.load(std::memory_order_relaxed);
+    }
+
+    static Range & range_of(Entry & entry) {
+        return ranges[&entry - arenas];
+    }
+
+    static void on_screen_delete(lv_event_t * e) {
+        auto screen = (lv_obj_t*)lv_event_get_target(e);
+        for (auto & entry : arenas) {
+            if (entry.arena && entry.screen == screen) {
+                // the children are deleted after this event, release once they're gone
+                entry.screen = nullptr;
+                if (lv_async_call(release, &entry) != LV_RESULT_OK) {
+                    // no timer for it: delete the children now, so nothing
+                    // frees arena memory once it's gone
+                    lv_obj_clean(screen);
+                    release(&entry);
+                }
+            }
+        }
+    }
+
+    static void release(void * data) {
+        auto entry = (Entry*)data;
+        BumpArena * arena = entry->arena;
+        if (arena == current)
+            current = nullptr;
+        entry->arena = nullptr;
+        // out of the table before the memory can be handed out again
+        range_of(*entry).set(0, 0);
+        delete arena;
+        _releases++;
+    }
+
+    static inline Entry arenas[MB3_SCREEN_ARENAS] = {};
+    static inline Range ranges[MB3_SCREEN_ARENAS];
+    static inline BumpArena * current = nullptr;
+    static inline bool probed = false;
+    static inline std::atomic<bool> hooked{false};
+    static inline uint32_t _allocations = 0;
+    static inline uint32_t _releases = 0;
+};
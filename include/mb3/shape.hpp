@@ -17,18 +17,27 @@ class Shape {
         West = 2,
         North = 3
     } direction = Direction::East;
+    bool owned = true;
     
 public:
     inline Shape(lv_layer_t * layer) {
-        dsc = lv_vector_dsc_create(layer);
-        path = lv_vector_path_create(LV_VECTOR_PATH_QUALITY_HIGH);
+        dsc = FrameArena::createVectorDsc(layer);
+        path = FrameArena::createVectorPath(LV_VECTOR_PATH_QUALITY_HIGH);
+        lv_vector_dsc_set_fill_opa(dsc, LV_OPA_0);
+        lv_vector_dsc_set_stroke_opa(dsc, LV_OPA_0);
+    }
+
+    /// @brief Build into an existing path and style without drawing, see @ref RetainedPath
+    inline Shape(lv_vector_dsc_t * dsc, lv_vector_path_t * path) : dsc(dsc), path(path), owned(false) {
         lv_vector_dsc_set_fill_opa(dsc, LV_OPA_0);
         lv_vector_dsc_set_stroke_opa(dsc, LV_OPA_0);
     }
 
     inline ~Shape() {
-        lv_vector_path_delete(path);
-        lv_vector_dsc_delete(dsc);
+        if (!owned)
+            return;
+        FrameArena::deleteVectorPath(path);
+        FrameArena::deleteVectorDsc(dsc);
     }
 
     Shape & start(float x, float y) {
@@ -140,8 +149,13 @@ public:
     }
 
     Shape & finish() {
+        if (!owned)
+            return *this;
         lv_vector_dsc_add_path(dsc, path);
         lv_draw_vector(dsc);
+        lv_area_t bounds;
+        if (pathBounds(path, dsc->current_dsc, bounds))
+            CanvasDirtyTracker::note(dsc->layer, bounds);
         return *this;
     }
 };
\ No newline at end of file
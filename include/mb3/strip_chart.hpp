@@ -0,0 +1,432 @@
+#pragma once
+
+#include <lvgl.h>
+#include <stdint.h>
+#include <string.h>
+#include <cmath>
+#include <mb3/platform.hpp>
+#include <mb3/widget.hpp>
+#include <mb3/history.hpp>
+
+enum class StripMode : uint8_t {
+    /// @brief New columns enter on the right and the trace moves left
+    Scroll,
+    /// @brief A cursor sweeps left to right over the old trace, like a patient
+    /// monitor. Only the new columns change on screen.
+    Sweep,
+};
+
+/// @brief Strip chart for live signals. The plot is an RGB565 buffer in PSRAM
+/// used as a ring of columns: a new column is rendered into the one slot it
+/// replaces (a min/max span per series, joined to the previous column), so a
+/// sample costs one column of pixels, never a redraw of the plot.
+/// Scrolling is done at draw time by blitting the ring as two images, oldest
+/// part first, instead of moving pixels around; in @ref StripMode::Sweep
+/// nothing moves and only the new columns are invalidated.
+/// Every column's min/max is kept, so the plot is redrawn in full only when
+/// the auto-ranged Y axis changes or the chart is resized.
+///
+/// A column lasts column_ms. Series read a value each @ref update (an LVGL
+/// timer calls it every column, call it more often to catch short spikes), or
+/// take each column's min/max from a @ref SignalHistory, which sees every sample.
+///
+///     auto chart = new StripChart<>(screen, 100);
+///     lv_obj_set_size(chart, 300, 120);
+///     chart->addSeries(&engine[RPM], lv_color_hex(0xFF0000));
+///     chart->addSeries(boost_history, lv_color_hex(0x00FF00));
+template <size_t MaxSeries = 4>
+class StripChart : public Widget<StripChart<MaxSeries>> {
+    using Base = Widget<StripChart<MaxSeries>>;
+public:
+    StripChart(lv_obj_t * parent, uint32_t column_ms = 100, StripMode mode = StripMode::Scroll) :
+        Base(parent),
+        column_ms(column_ms ? column_ms : 1),
+        mode(mode)
+    {
+        column_start = now_ms();
+        lv_obj_add_event_cb(this, on_resized, LV_EVENT_SIZE_CHANGED, nullptr);
+        timer = lv_timer_create(on_timer, this->column_ms, this);
+        resize();
+    }
+
+    /// @brief Plot a value read at every @ref update
+    template <typename T>
+    StripChart & addSeries(T * p_value, lv_color_t color) {
+        return add({nullptr, [](const void * source) { return (float)*(const T*)source; }, p_value, lv_color_to_u16(color)});
+    }
+
+    /// @brief Plot each column's min/max from a history
+    StripChart & addSeries(const SignalHistory & history, lv_color_t color) {
+        return add({&history, nullptr, nullptr, lv_color_to_u16(color)});
+    }
+
+    /// @brief A fixed Y axis, values outside are clamped to the edges
+    StripChart & setRange(float min, float max) {
+        auto_range = false;
+        if (rescale(min, max))
+            redraw();
+        return *this;
+    }
+
+    /// @brief Fit the Y axis to what's on the plot (the default)
+    StripChart & setAutoRange() {
+        auto_range = true;
+        if (fit())
+            redraw();
+        return *this;
+    }
+
+    /// @brief Blank columns ahead of the cursor in @ref StripMode::Sweep
+    StripChart & setSweepGap(uint16_t columns) {
+        gap = columns;
+        redraw();
+        return *this;
+    }
+
+    /// @brief Sample the series, and plot any columns that are due
+    void update() {
+        uint32_t now = now_ms();
+        for (size_t s = 0; s < count; s++) {
+            Series & series = series_list[s];
+            if (!series.read)
+                continue;
+            float value = series.read(series.source);
+            if (std::isnan(value))
+                continue;
+            if (std::isnan(series.pending_min) || value < series.pending_min)
+                series.pending_min = value;
+            if (std::isnan(series.pending_max) || value > series.pending_max)
+                series.pending_max = value;
+        }
+
+        uint32_t due = (now - column_start) / column_ms;
+        if (!due || !plot_data)
+            return;
+        uint16_t first = head;
+        bool full = false;
+        // after a long stall, only the last plot's worth of columns matters
+        if (due > width) {
+            column_start += (due - width) * column_ms;
+            due = width;
+        }
+        for (uint32_t i = 0; i < due; i++) {
+            full |= push(column_start + column_ms - 1);
+            column_start += column_ms;
+        }
+        for (size_t s = 0; s < count; s++) {
+            series_list[s].pending_min = series_list[s].pending_max = NAN;
+        }
+
+        if (full) {
+            redraw();
+        } else if (mode == StripMode::Scroll || due + gap >= width) {
+            invalidate_columns(0, width);
+        } else if (first + due + gap <= width) {
+            invalidate_columns(first, due + gap);
+        } else {
+            invalidate_columns(first, width - first);
+            invalidate_columns(0, first + due + gap - width);
+        }
+    }
+
+    float rangeMin() const {
+        return range_min;
+    }
+
+    float rangeMax() const {
+        return range_max;
+    }
+
+    /// @brief Full plot redraws so far, from range changes and resizes
+    uint32_t redrawCount() const {
+        return redraws;
+    }
+
+    /// @brief PSRAM used by the plot and the column store
+    size_t memory() const {
+        return plot_data ? plot.data_size + store_size() : 0;
+    }
+
+    /// @brief Time source, for tests and replays
+    static inline int64_t (*clock)() = esp_timer_get_time;
+
+private:
+    struct Series {
+        const SignalHistory * history;
+        float (*read)(const void * source);
+        const void * source;
+        uint16_t color;
+        float pending_min = NAN;
+        float pending_max = NAN;
+    };
+
+    /// @brief A series' rows in the last rendered column, top < 0 for none
+    struct Span {
+        int32_t top;
+        int32_t bottom;
+    };
+
+    static uint32_t now_ms() {
+        return (uint32_t)(clock() / 1000);
+    }
+
+    StripChart & add(const Series & series) {
+        if (count < MaxSeries) {
+            series_list[count] = series;
+            spans[count] = {-1, -1};
+            count++;
+        } else {
+            log_e("strip chart: more than %u series", (unsigned)MaxSeries);
+        }
+        return *this;
+    }
+
+    size_t store_size() const {
+        return sizeof(float) * 2 * MaxSeries * width;
+    }
+
+    float * cell(uint16_t column, size_t s) {
+        return store + (((column * MaxSeries) + s) * 2);
+    }
+
+    /// @brief Store and render the column ending at end_ms
+    /// @return whether the plot needs a full redraw
+    bool push(uint32_t end_ms) {
+        bool out_of_range = false;
+        for (size_t s = 0; s < MaxSeries; s++) {
+            float * value = cell(head, s);
+            value[0] = value[1] = NAN;
+            if (s >= count)
+                continue;
+            Series & series = series_list[s];
+            if (series.history) {
+                HistoryPoint point;
+                series.history->fetch(column_ms, &point, 1, end_ms);
+                if (point.count) {
+                    value[0] = point.min;
+                    value[1] = point.max;
+                }
+            } else {
+                value[0] = series.pending_min;
+                value[1] = series.pending_max;
+            }
+            if (!std::isnan(value[0]) && (!ranged || value[0] < range_min || value[1] > range_max))
+                out_of_range = true;
+        }
+
+        render(head, spans);
+        if (mode == StripMode::Sweep && gap)
+            blank((head + gap) % width);
+        head = (head + 1) % width;
+
+        // shrinking is checked now and then, growing right away
+        if (++since_fit >= width / 4)
+            return fit();
+        return out_of_range && auto_range && fit();
+    }
+
+    /// @brief Fit the range to the stored columns, with a margin. Shrinks only
+    /// once the data uses less than half of it, so it doesn't keep changing.
+    /// @return whether the range changed, and the plot needs redrawing
+    bool fit() {
+        since_fit = 0;
+        if (!auto_range || !store)
+            return false;
+        float min = INFINITY, max = -INFINITY;
+        for (size_t i = 0; i < (size_t)width * MaxSeries; i++) {
+            float * value = store + (i * 2);
+            if (std::isnan(value[0]))
+                continue;
+            min = value[0] < min ? value[0] : min;
+            max = value[1] > max ? value[1] : max;
+        }
+        if (min > max)
+            return false;
+        float span = range_max - range_min;
+        if (ranged && min >= range_min && max <= range_max && (max - min) >= span / 2)
+            return false;
+        float margin = (max - min) > 0.f ? (max - min) * 0.1f : (std::fabs(max) > 0.f ? std::fabs(max) * 0.1f : 1.f);
+        return rescale(min - margin, max + margin);
+    }
+
+    bool rescale(float min, float max) {
+        if (ranged && min == range_min && max == range_max)
+            return false;
+        range_min = min;
+        range_max = max;
+        ranged = true;
+        return true;
+    }
+
+    int32_t to_y(float value) const {
+        float span = range_max - range_min;
+        float position = span > 0.f ? (value - range_min) / span : 0.5f;
+        int32_t y = (int32_t)lroundf((1.f - position) * (height - 1));
+        return y < 0 ? 0 : y >= height ? height - 1 : y;
+    }
+
+    void blank(uint16_t column) {
+        uint16_t * pixel = (uint16_t*)plot_data + column;
+        for (int32_t y = 0; y < height; y++, pixel += pitch) {
+            *pixel = background;
+        }
+    }
+
+    /// @brief Draw one stored column, each series from its min to its max,
+    /// stretched to meet the previous column's span so the trace is continuous
+    void render(uint16_t column, Span * last) {
+        blank(column);
+        uint16_t * pixels = (uint16_t*)plot_data + column;
+        for (size_t s = 0; s < count; s++) {
+            float * value = cell(column, s);
+            if (std::isnan(value[0])) {
+                last[s] = {-1, -1};
+                continue;
+            }
+            Span span = {to_y(value[1]), to_y(value[0])};
+            int32_t top = span.top;
+            int32_t bottom = span.bottom;
+            if (last[s].top >= 0) {
+                if (top > last[s].bottom)
+                    top = last[s].bottom;
+                if (bottom < last[s].top)
+                    bottom = last[s].top;
+            }
+            uint16_t * pixel = pixels + (top * pitch);
+            for (int32_t y = top; y <= bottom; y++, pixel += pitch) {
+                *pixel = series_list[s].color;
+            }
+            last[s] = span;
+        }
+    }
+
+    /// @brief Render every column, oldest first
+    void redraw() {
+        if (!plot_data)
+            return;
+        background = lv_color_to_u16(lv_obj_get_style_bg_color(this, LV_PART_MAIN));
+        for (size_t s = 0; s < MaxSeries; s++) {
+            spans[s] = {-1, -1};
+        }
+        uint16_t blanks = mode == StripMode::Sweep ? gap : 0;
+        for (uint16_t i = 0; i < width; i++) {
+            uint16_t column = (head + i) % width;
+            if (i < blanks)
+                blank(column);
+            else
+                render(column, spans);
+        }
+        redraws++;
+        invalidate_columns(0, width);
+    }
+
+    /// @brief Invalidate plot columns as they are on screen
+    void invalidate_columns(uint16_t x, uint16_t columns) {
+        this->invalidate_rel_area({x, 0, (int32_t)x + columns - 1, height - 1});
+    }
+
+    void resize() {
+        int32_t w = lv_obj_get_content_width(this);
+        int32_t h = lv_obj_get_content_height(this);
+        if (w == width && h == height && plot_data)
+            return;
+        free_buffers();
+        width = w > 0 && w <= UINT16_MAX ? w : 0;
+        height = h > 0 ? h : 0;
+        head = 0;
+        if (!width || !height)
+            return;
+        uint32_t stride = LV_DRAW_BUF_STRIDE(width, LV_COLOR_FORMAT_RGB565);
+        size_t size = stride * height;
+        plot_data = (uint8_t*)heap_caps_aligned_alloc(LV_DRAW_BUF_ALIGN, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        store = (float*)heap_caps_malloc(store_size(), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!plot_data || !store) {
+            log_e("strip chart: %u bytes", (unsigned)(size + store_size()));
+            free_buffers();
+            return;
+        }
+        lv_draw_buf_init(&plot, width, height, LV_COLOR_FORMAT_RGB565, stride, plot_data, size);
+        pitch = stride / sizeof(uint16_t);
+        for (size_t i = 0; i < (size_t)width * MaxSeries * 2; i++) {
+            store[i] = NAN;
+        }
+        redraw();
+    }
+
+    void free_buffers() {
+        heap_caps_free(plot_data);
+        heap_caps_free(store);
+        plot_data = nullptr;
+        store = nullptr;
+    }
+
+    static void on_resized(lv_event_t * e) {
+        auto self = static_cast<StripChart*>((lv_obj_t*)lv_event_get_current_target(e));
+        self->resize();
+    }
+
+    static void on_timer(lv_timer_t * timer) {
+        static_cast<StripChart*>(lv_timer_get_user_data(timer))->update();
+    }
+
+    virtual void draw(lv_layer_t * layer) override {
+        if (!plot_data)
+            return;
+        lv_area_t content;
+        lv_obj_get_content_coords(this, &content);
+        lv_draw_image_dsc_t dsc;
+        lv_draw_image_dsc_init(&dsc);
+        if (mode == StripMode::Sweep || head == 0) {
+            dsc.src = &plot;
+            lv_area_t area = {content.x1, content.y1, content.x1 + width - 1, content.y1 + height - 1};
+            lv_draw_image(layer, &dsc, &area);
+            return;
+        }
+        // the ring as two views of the plot: [head, width) is the oldest part
+        // and goes on the left, [0, head) on the right. Each view spans the
+        // whole buffer as far as LVGL's size checks go, but only reads its columns.
+        int32_t split = width - head;
+        lv_draw_buf_init(&older, split, height, LV_COLOR_FORMAT_RGB565, plot.header.stride, plot_data + (head * sizeof(uint16_t)), plot.data_size);
+        lv_draw_buf_init(&newer, head, height, LV_COLOR_FORMAT_RGB565, plot.header.stride, plot_data, plot.data_size);
+        lv_area_t left = {content.x1, content.y1, content.x1 + split - 1, content.y1 + height - 1};
+        lv_area_t right = {content.x1 + split, content.y1, content.x1 + width - 1, content.y1 + height - 1};
+        dsc.src = &older;
+        lv_draw_image(layer, &dsc, &left);
+        dsc.src = &newer;
+        lv_draw_image(layer, &dsc, &right);
+    }
+
+    virtual void on_destruct() override {
+        // LVGL frees our memory without running C++ destructors
+        lv_timer_delete(timer);
+        free_buffers();
+    }
+
+    uint32_t column_ms;
+    StripMode mode;
+    lv_timer_t * timer = nullptr;
+    uint32_t column_start = 0;
+
+    Series series_list[MaxSeries];
+    Span spans[MaxSeries];
+    size_t count = 0;
+
+    lv_draw_buf_t plot;
+    lv_draw_buf_t older;
+    lv_draw_buf_t newer;
+    uint8_t * plot_data = nullptr;
+    float * store = nullptr;
+    int32_t width = 0;
+    int32_t height = 0;
+    uint32_t pitch = 0;
+    uint16_t head = 0;
+    uint16_t gap = 8;
+    uint16_t background = 0;
+    uint16_t since_fit = 0;
+
+    float range_min = 0.f;
+    float range_max = 1.f;
+    bool ranged = false;
+    bool auto_range = true;
+    uint32_t redraws = 0;
+};
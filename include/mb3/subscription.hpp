@@ -0,0 +1,121 @@
+#pragma once
+
+#include <mutex>
+#include <mb3/updatable.hpp>
+#include <mb3/platform.hpp>
+
+class Subscribable;
+
+/// @brief Intrusive subscriber list node, embedded in (and owned by) the subscriber.
+/// Subscribing never allocates, and a destroyed subscription unlinks itself.
+class Subscription {
+public:
+    using Callback = void (*)(void * context);
+
+    Subscription(IUpdatable * target = nullptr) : target(target) { }
+    Subscription(Callback callback, void * context) : target(nullptr), callback(callback), context(context) { }
+    Subscription(const Subscription &) = delete;
+    Subscription & operator=(const Subscription &) = delete;
+    inline ~Subscription();
+
+    bool subscribed() const {
+        return source != nullptr;
+    }
+
+    /// @brief Unlink from the source, waiting out a notify in progress
+    inline void unsubscribe();
+
+    void notify() {
+        if (callback)
+            callback(context);
+        else if (target)
+            target->update();
+    }
+
+    IUpdatable * target;
+    Callback callback = nullptr;
+    void * context = nullptr;
+
+private:
+    friend class Subscribable;
+    Subscription * next = nullptr;
+    Subscribable * source = nullptr;
+    // notifies running the callback, under the subscriber lists' lock
+    uint8_t busy = 0;
+};
+
+/// @brief Something that notifies subscribers, at the cost of one pointer.
+/// Signals notify from the bus task while the UI task subscribes and
+/// unsubscribes, so the list is only walked or changed under a lock. It is
+/// one lock shared by every list, held just long enough to follow a link, so
+/// each of the many table signals doesn't carry one of its own.
+/// Callbacks run outside it (they may redraw, allocate or log), and
+/// unsubscribing waits for a callback in progress, so a subscription is never
+/// unlinked or destroyed while it runs. A callback mustn't unsubscribe its
+/// own subscription.
+class Subscribable {
+public:
+    Subscribable() = default;
+    Subscribable(const Subscribable &) = delete;
+    Subscribable & operator=(const Subscribable &) = delete;
+
+    ~Subscribable() {
+        while (subscribers) {
+            unsubscribe(*subscribers);
+        }
+    }
+
+    void subscribe(Subscription & subscription) {
+        subscription.unsubscribe();
+        std::lock_guard<Spinlock> guard(lock);
+        subscription.source = this;
+        subscription.next = subscribers;
+        subscribers = &subscription;
+    }
+
+    void unsubscribe(Subscription & subscription) {
+        std::lock_guard<Spinlock> guard(lock);
+        while (subscription.busy) {
+            lock.unlock();
+            Spinlock::pause();
+            lock.lock();
+        }
+        for (Subscription ** link = &subscribers; *link; link = &(*link)->next) {
+            if (*link == &subscription) {
+                *link = subscription.next;
+                subscription.next = nullptr;
+                subscription.source = nullptr;
+                return;
+            }
+        }
+    }
+
+    void notify() {
+        std::lock_guard<Spinlock> guard(lock);
+        for (auto subscription = subscribers; subscription; subscription = subscription->next) {
+            // busy keeps it (and so its next) linked while the lock is released
+            subscription->busy++;
+            lock.unlock();
+            subscription->notify();
+            lock.lock();
+            subscription->busy--;
+        }
+    }
+
+    bool has_subscribers() const {
+        return subscribers != nullptr;
+    }
+
+private:
+    Subscription * subscribers = nullptr;
+    static inline Spinlock lock;
+};
+
+void Subscription::unsubscribe() {
+    if (source)
+        source->unsubscribe(*this);
+}
+
+Subscription::~Subscription() {
+    unsubscribe();
+}
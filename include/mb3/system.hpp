@@ -69,6 +69,28 @@ public:
         execution_times = (uint32_t *)heap_caps_calloc(execution_time_size, sizeof(uint32_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_32BIT);
     }
 
+    /// @brief Store task placement and run setup_impl()
+    void initialize(int stacksize, int priority, int core, TickType_t frequency) {
+        this->stacksize = stacksize;
+        this->priority = priority;
+        this->core = core;
+        this->frequency = frequency;
+
+        create_execution_times();
+
+        auto start_time = esp_timer_get_time();
+        MB3_LOG("[%6u][I][%s] Running setup\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), name.c_str());
+        should_start = setup_impl();
+        if (should_start) {
+            initialized = true;
+            auto diff = esp_timer_get_time() - start_time;
+            MB3_LOG("[%6u][I][%s] System Initialized in %0.6f\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), name.c_str(), diff / 1000000.0);
+        } else {
+            MB3_LOG("[%6u][E][%s] Couldn't initialize System\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), name.c_str());
+            // basic_log("[ERROR] Couldn't initialize system\r\n");
+        }
+    }
+
     virtual bool setup_impl() {
         return true;
     }
@@ -109,6 +131,53 @@ public:
         }
     }
 
+    void start_impl() {
+        if (!initialized) {
+            MB3_LOG("[%6u][E][%s] System not initialized\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), name.c_str());
+            return;
+        }
+        // print_heap_d();
+        if (should_start) {
+            // print_heap_d();
+            if (priority != -1 && stacksize != -1) {
+                auto res = xTaskCreatePinnedToCore(task, name.c_str(), stacksize, this, priority, &taskHandle, core);
+                if (res == pdPASS) {
+                    esp_task_wdt_add(taskHandle);
+                } else if (res == errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY){
+                    MB3_LOG("[%6u][E][%s] Couldn't alloc memory for task\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), name.c_str());
+                    // basic_log("[ERROR] Couldn't alloc memory\r\n");
+                    print_heap_d();
+                } else {
+                    MB3_LOG("[%6u][E][%s] Couldn't start task: %d\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), name.c_str(), res);
+                    // basic_log("[ERROR] Couldn't start task\r\n");
+                }
+            }
+        }
+    }
+
+    static void task(void * parameter) {
+        auto instance = static_cast<ISystem *>(parameter);
+        auto hi = instance->stacksize - uxTaskGetStackHighWaterMark(instance->taskHandle);
+        MB3_LOG("[%6u][I][%s] System Task Started - Highwater: 0x%04X\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), instance->name.c_str(), hi);
+        instance->xLastWakeTime = xTaskGetTickCount();
+        int64_t start_time;
+        bool first = true;
+
+        for (;;) {
+            vTaskDelayUntil(&instance->xLastWakeTime, instance->frequency);
+            esp_task_wdt_reset();
+            start_time = esp_timer_get_time();
+            instance->task_impl();
+            esp_task_wdt_reset();
+            instance->add_time(esp_timer_get_time() - start_time);
+            if (first) {
+                first = false;
+                auto hi = instance->stacksize - uxTaskGetStackHighWaterMark(instance->taskHandle);
+                MB3_LOG("[%6u][I][%s] Highwater for first loop: 0x%04X\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), instance->name.c_str(), hi);
+            }
+        }
+    }
+    
     std::string name;
     int stacksize;
     int priority;
@@ -168,77 +237,13 @@ public:
         instance = std::make_shared<T>();
         Systems::systems.push_back(instance);
 
-        instance->stacksize = stacksize;
-        instance->priority = priority;
-        instance->core = core;
-        instance->frequency = frequency;
-
-        instance->create_execution_times();
-
-        auto start_time = esp_timer_get_time();
-        MB3_LOG("[%6u][I][%s] Running setup\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), instance->name.c_str());
-        instance->should_start = instance->setup_impl();
-        if (instance->should_start) {
-            instance->initialized = true;
-            auto diff = esp_timer_get_time() - start_time;
-            MB3_LOG("[%6u][I][%s] System Initialized in %0.6f\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), instance->name.c_str(), diff / 1000000.0);
-        } else {
-            MB3_LOG("[%6u][E][%s] Couldn't initialize System\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), instance->name.c_str());
-            // basic_log("[ERROR] Couldn't initialize system\r\n");
-        }
+        instance->initialize(stacksize, priority, core, frequency);
     }
 
     static void start() {
         instance->start_impl();
     }
 
-    void start_impl() {
-        if (!initialized) {
-            MB3_LOG("[%6u][E][%s] System not initialized\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), name.c_str());
-            return;
-        }
-        // print_heap_d();
-        if (should_start) {
-            // print_heap_d();
-            if (priority != -1 && stacksize != -1) {
-                auto res = xTaskCreatePinnedToCore(task, name.c_str(), stacksize, this, priority, &taskHandle, core);
-                if (res == pdPASS) {
-                    esp_task_wdt_add(taskHandle);
-                } else if (res == errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY){
-                    MB3_LOG("[%6u][E][%s] Couldn't alloc memory for task\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), name.c_str());
-                    // basic_log("[ERROR] Couldn't alloc memory\r\n");
-                    print_heap_d();
-                } else {
-                    MB3_LOG("[%6u][E][%s] Couldn't start task: %d\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), name.c_str(), res);
-                    // basic_log("[ERROR] Couldn't start task\r\n");
-                }
-            }
-        }
-    }
-
-    static void task(void * parameter) {
-        auto instance = static_cast<ISystem *>(parameter);
-        auto hi = instance->stacksize - uxTaskGetStackHighWaterMark(instance->taskHandle);
-        MB3_LOG("[%6u][I][%s] System Task Started - Highwater: 0x%04X\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), instance->name.c_str(), hi);
-        instance->xLastWakeTime = xTaskGetTickCount();
-        int64_t start_time;
-        bool first = true;
-
-        for (;;) {
-            vTaskDelayUntil(&instance->xLastWakeTime, instance->frequency);
-            esp_task_wdt_reset();
-            start_time = esp_timer_get_time();
-            instance->task_impl();
-            esp_task_wdt_reset();
-            instance->add_time(esp_timer_get_time() - start_time);
-            if (first) {
-                first = false;
-                auto hi = instance->stacksize - uxTaskGetStackHighWaterMark(instance->taskHandle);
-                MB3_LOG("[%6u][I][%s] Highwater for first loop: 0x%04X\r\n", (unsigned long) (esp_timer_get_time() / 1000ULL), instance->name.c_str(), hi);
-            }
-        }
-    }
-    
     static std::shared_ptr<T> get() 
     {
         return std::dynamic_pointer_cast<T>(instance);
@@ -2,23 +2,41 @@
 
 #include <mb3/system.hpp>
 #include <mb3/can.hpp>
+#include <mb3/can_bus.hpp>
 #include <mb3/observable.hpp>
 #include "driver/twai.h"
 
+/// @brief Serves one extra @ref CanBus from its own task
+class CanBusSystem : public ISystem {
+public:
+    CanBusSystem(std::shared_ptr<CanBus> bus) : ISystem(bus->name), bus(bus) { }
+
+    virtual bool setup_impl() override;
+    virtual void task_impl() override;
+
+    std::shared_ptr<CanBus> bus;
+};
+
 class CAN : public System<CAN> {
 public:
     inline CAN() : System<CAN>("CAN") { }
 
     virtual bool setup_impl();
     virtual void task_impl();
-    
+
     static bool perform_hard_reset();
 
-    static inline bool hasRX = false;
-    static inline IObservable o_status;
-};
+    /// @brief Set up another bus and serve it from its own task (pinned to core), in parallel with the default one
+    /// @param frequency time in ms
+    static std::shared_ptr<CanBusSystem> add_bus(std::shared_ptr<CanBus> bus, int stacksize, int priority, BaseType_t core, TickType_t frequency = 1);
 
-typedef struct {
-    int64_t timestamp;
-    twai_message_t frame;
-} CanLog;
\ No newline at end of file
+    /// @brief The MB3_CAN_* configured TWAI bus, decoding into @ref CanFrameTypes::types
+    static inline CanBus bus{"CAN", &CanFrameTypes::types};
+    static inline std::vector<std::shared_ptr<CanBusSystem>> buses;
+
+    static inline bool & hasRX = bus.hasRX;
+    static inline IObservable & o_status = bus.o_status;
+#if MB3_CAN_J1939
+    static inline J1939 & j1939 = bus.j1939;
+#endif
+};
@@ -6,13 +6,15 @@
 #include <functional>
 #include "osal/lv_os.h"
 #include <mb3/observable.hpp>
+#include <mb3/number_format.hpp>
 #include "src/core/lv_obj_private.h"
 #include "src/core/lv_obj_class_private.h"
 #include <string.h>
 #include <config.hpp>
 #include <mb3/defaults.hpp>
+#include <mb3/screen_arena.hpp>
 
-class IWidget {
+class IWidget : public IUpdatable {
 public:
     virtual ~IWidget() = default;
     virtual void update(void) = 0;
@@ -20,7 +22,11 @@ public:
     lv_obj_t * root;
 };
 
-/// @brief `lv_text_obj` manager that can be bound to a data pointer
+/// @brief `lv_text_obj` manager that can be bound to a data pointer.
+/// The text is formatted into a buffer owned by the widget, without printf
+/// for the usual numeric formats (@ref NumberFormat), and handed to the label
+/// with lv_label_set_text_static, so updates don't allocate. The label is
+/// only touched when the formatted text actually changed.
 /// @tparam D The primitive display type for formatting, math
 /// @tparam T The optional smart type, @ref ICanSignal
 template <typename D, typename T = D>
@@ -30,23 +36,198 @@ public:
     TextWidget(lv_obj_t * lv_text_obj, const char * format, T * p_value, float scalar = 1.f, float offset = 0.f) :
         o_value(p_value, scalar, offset),
         lv_text_obj(lv_text_obj),
-        format(format)
+        format(format),
+        number(format)
     {
-        lv_label_set_text_fmt(lv_text_obj, format, o_value.get());
+        // the label points into our buffer, so forget it if it goes first
+        lv_obj_add_event_cb(lv_text_obj, on_label_deleted, LV_EVENT_DELETE, this);
+        render(true);
+        // signal-backed values are updated by the ObservableManager, which tells us when they change
+        if (o_value.isNotified())
+            o_value.subscribe(subscription);
     }
 
-    virtual ~TextWidget() override = default;
+    virtual ~TextWidget() override {
+        if (lv_text_obj) {
+            lv_obj_remove_event_cb_with_user_data(lv_text_obj, on_label_deleted, this);
+            // the label outlives us, give it its own copy
+            lv_label_set_text(lv_text_obj, text);
+        }
+    }
 
     virtual void update(void) override {
-        o_value.update();
+        if (!o_value.isNotified())
+            o_value.update();
         if (o_value.hasChanged()) {
-            lv_label_set_text_fmt(lv_text_obj, format, o_value.get());
+            render(false);
         }
     }
 
     TAdjustedObservable<D, T> o_value;
     lv_obj_t * lv_text_obj;
     const char * format;
+
+protected:
+    void render(bool force) {
+        if (!lv_text_obj)
+            return;
+        char next[MB3_TEXT_WIDGET_LENGTH];
+        bool truncated;
+        size_t length = number.format(next, sizeof(next), o_value.get(), &truncated);
+        if (truncated && !warned) {
+            log_w("text widget: \"%s\" cut to %u characters (MB3_TEXT_WIDGET_LENGTH)", next, (unsigned)length);
+            warned = true;
+        }
+        // 12.34 and 12.31 both show as "12.3", no need to relayout
+        if (!force && length == text_length && memcmp(next, text, length) == 0)
+            return;
+        memcpy(text, next, length + 1);
+        text_length = length;
+        lv_label_set_text_static(lv_text_obj, text);
+    }
+
+    static void on_label_deleted(lv_event_t * e) {
+        auto self = static_cast<TextWidget *>(lv_event_get_user_data(e));
+        self->lv_text_obj = nullptr;
+    }
+
+    Subscription subscription{this};
+    NumberFormat number;
+    char text[MB3_TEXT_WIDGET_LENGTH] = {0};
+    size_t text_length = 0;
+    bool warned = false;
+};
+
+/// @brief Builds many widgets at once. Inside the scope, a @ref Widget is
+/// appended to its parent's children in capacity reserved up front (grown by
+/// doubling) instead of one lv_realloc per child. Its style refresh, self
+/// size, child events and invalidation wait until the scope ends and then run
+/// once per widget, and once per parent for CHILD_CHANGED, layout and
+/// invalidation. Scopes nest, the outermost one finishes the work. Don't
+/// delete children of a batched parent inside the scope.
+///
+///     {
+///         WidgetBatch batch(screen, 200);
+///         for (...)
+///             new Gauge(screen, ...);
+///     }
+class WidgetBatch {
+public:
+    WidgetBatch(lv_obj_t * parent = nullptr, uint32_t reserve = 0) : outer(current) {
+        if (!outer)
+            current = this;
+        if (parent && reserve)
+            current->entry_for(parent, reserve);
+    }
+
+    ~WidgetBatch() {
+        if (outer)
+            return;
+        current = nullptr;
+        lv_obj_enable_style_refresh(true);
+        for (size_t i = 0; i < count; i++) {
+            finish(entries[i]);
+        }
+        count = 0;
+    }
+
+    WidgetBatch(const WidgetBatch &) = delete;
+    WidgetBatch & operator=(const WidgetBatch &) = delete;
+
+    /// @brief Add child to parent's children when a batch is open
+    /// @return false when not batched, the caller appends as usual
+    static bool append(lv_obj_t * parent, lv_obj_t * child) {
+        if (!current || !parent)
+            return false;
+        Entry * entry = current->entry_for(parent, 0);
+        if (!entry)
+            return false;
+        auto attr = parent->spec_attr;
+        if (attr->child_cnt != entry->known_count) {
+            // LVGL added children meanwhile and sized the array exactly
+            entry->capacity = attr->child_cnt;
+        }
+        if (attr->child_cnt == entry->capacity) {
+            uint32_t capacity = entry->capacity < 8 ? 8 : entry->capacity * 2;
+            auto children = (lv_obj_t**)lv_realloc(attr->children, sizeof(lv_obj_t *) * capacity);
+            if (!children)
+                return false;
+            attr->children = children;
+            entry->capacity = capacity;
+            current->reallocs++;
+        }
+        attr->children[attr->child_cnt++] = child;
+        entry->known_count = attr->child_cnt;
+        return true;
+    }
+
+    /// @brief Children arrays grown inside the current scope
+    static uint32_t reallocations() {
+        return current ? current->reallocs : 0;
+    }
+
+    static bool active() {
+        return current != nullptr;
+    }
+
+private:
+    struct Entry {
+        lv_obj_t * parent;
+        uint32_t first;
+        uint32_t capacity;
+        uint32_t known_count;
+    };
+
+    Entry * entry_for(lv_obj_t * parent, uint32_t reserve) {
+        Entry * entry = nullptr;
+        for (size_t i = 0; i < count; i++) {
+            if (entries[i].parent == parent)
+                entry = &entries[i];
+        }
+        if (!entry) {
+            if (count == MB3_WIDGET_BATCH_PARENTS)
+                return nullptr;
+            if (parent->spec_attr == NULL)
+                lv_obj_allocate_spec_attr(parent);
+            uint32_t children = parent->spec_attr->child_cnt;
+            entry = &entries[count++];
+            *entry = {parent, children, children, children};
+        }
+        auto attr = parent->spec_attr;
+        if (attr->child_cnt + reserve > entry->capacity) {
+            auto children = (lv_obj_t**)lv_realloc(attr->children, sizeof(lv_obj_t *) * (attr->child_cnt + reserve));
+            if (children) {
+                attr->children = children;
+                entry->capacity = attr->child_cnt + reserve;
+                entry->known_count = attr->child_cnt;
+                reallocs++;
+            }
+        }
+        return entry;
+    }
+
+    static void finish(const Entry & entry) {
+        auto attr = entry.parent->spec_attr;
+        // LVGL expects the array sized to the children
+        if (attr->child_cnt)
+            attr->children = (lv_obj_t**)lv_realloc(attr->children, sizeof(lv_obj_t *) * attr->child_cnt);
+        if (entry.first >= attr->child_cnt)
+            return;
+        for (uint32_t i = entry.first; i < attr->child_cnt; i++) {
+            lv_obj_t * child = attr->children[i];
+            lv_obj_refresh_style(child, LV_PART_ANY, LV_STYLE_PROP_ANY);
+            lv_obj_refresh_self_size(child);
+            lv_obj_send_event(entry.parent, LV_EVENT_CHILD_CREATED, child);
+        }
+        lv_obj_send_event(entry.parent, LV_EVENT_CHILD_CHANGED, attr->children[attr->child_cnt - 1]);
+        lv_obj_invalidate(entry.parent);
+    }
+
+    WidgetBatch * outer;
+    Entry entries[MB3_WIDGET_BATCH_PARENTS];
+    size_t count = 0;
+    uint32_t reallocs = 0;
+    static inline WidgetBatch * current = nullptr;
 };
 
 template <typename Type>
@@ -190,15 +371,18 @@ protected:
 
         LV_TRACE_OBJ_CREATE("creating normal object");
         LV_ASSERT_OBJ(parent, &lv_obj_class);
-        if (parent->spec_attr == NULL) {
-            lv_obj_allocate_spec_attr(parent);
+        bool batched = WidgetBatch::append(parent, this);
+        if (!batched) {
+            if (parent->spec_attr == NULL) {
+                lv_obj_allocate_spec_attr(parent);
+            }
+
+            parent->spec_attr->child_cnt++;
+            parent->spec_attr->children = (lv_obj_t**)lv_realloc(parent->spec_attr->children,
+                                                     sizeof(lv_obj_t *) * parent->spec_attr->child_cnt);
+            parent->spec_attr->children[parent->spec_attr->child_cnt - 1] = this;
         }
 
-        parent->spec_attr->child_cnt++;
-        parent->spec_attr->children = (lv_obj_t**)lv_realloc(parent->spec_attr->children,
-                                                 sizeof(lv_obj_t *) * parent->spec_attr->child_cnt);
-        parent->spec_attr->children[parent->spec_attr->child_cnt - 1] = this;
-
         // lv_obj_class_init_obj first half
         lv_obj_mark_layout_as_dirty(this);
         lv_obj_enable_style_refresh(false);
@@ -211,6 +395,14 @@ protected:
 
         // not sure this will work here
         // lv_obj_class_init_obj second half
+        if (batched) {
+            // style refresh stays off, WidgetBatch does the rest when it ends
+            lv_group_t * def_group = lv_group_get_default();
+            if (def_group && lv_obj_is_group_def(this)) {
+                lv_group_add_obj(def_group, this);
+            }
+            return;
+        }
         lv_obj_enable_style_refresh(true);
         lv_obj_refresh_style(this, LV_PART_ANY, LV_STYLE_PROP_ANY);
 
@@ -238,13 +430,17 @@ public:
         // std::cout << "custom new for size " << count << '\n';
         // return ::operator new(count);
         // log_e("Widget new 0x%X bytes", count);
+        // inside a ScreenArena::Scope, from the screen's arena
+        if (void * ptr = ScreenArena::allocate(count))
+            return ptr;
         return lv_malloc_zeroed(count);
     }
  
     static void operator delete(void* ptr) noexcept {
         // std::puts("3) delete(void*)");
         // std::free(ptr);
-        lv_free(ptr);
+        if (!ScreenArena::owns(ptr))
+            lv_free(ptr);
     }
 
 
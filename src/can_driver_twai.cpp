@@ -0,0 +1,150 @@
+#include <config.hpp>
+#include <mb3/defaults.hpp>
+#include <mb3/can_driver_twai.hpp>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+TwaiCanDriver::Config TwaiCanDriver::defaults() {
+    Config config;
+    config.controller = 0;
+    config.timing = MB3_CAN_TIMING;
+    config.general = {
+#if MB3_TWAI_V2
+        .controller_id = 0,
+#endif
+        .mode = MB3_CAN_MODE,
+        .tx_io = MB3_CAN_TX,
+        .rx_io = MB3_CAN_RX,
+        .clkout_io = TWAI_IO_UNUSED,
+        .bus_off_io = TWAI_IO_UNUSED,
+        .tx_queue_len = MB3_CAN_TX_QUEUE_LEN,
+        .rx_queue_len = MB3_CAN_RX_QUEUE_LEN, // affects PSRAM
+        // .alerts_enabled = TWAI_ALERT_ALL,
+        .alerts_enabled = TWAI_ALERT_ALL & ~TWAI_ALERT_TX_IDLE & ~TWAI_ALERT_TX_SUCCESS & ~TWAI_ALERT_RX_DATA & ~TWAI_ALERT_RX_FIFO_OVERRUN,
+        .clkout_divider = 0,
+        .intr_flags = ESP_INTR_FLAG_LEVEL1
+    };
+    config.filter = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+    return config;
+}
+
+#if MB3_TWAI_V2
+
+esp_err_t TwaiCanDriver::install() {
+    config.general.controller_id = config.controller;
+    return twai_driver_install_v2(&config.general, &config.timing, &config.filter, &handle);
+}
+
+esp_err_t TwaiCanDriver::uninstall() {
+    auto res = twai_driver_uninstall_v2(handle);
+    if (res == ESP_OK)
+        handle = nullptr;
+    return res;
+}
+
+esp_err_t TwaiCanDriver::start() {
+    return twai_start_v2(handle);
+}
+
+esp_err_t TwaiCanDriver::stop() {
+    return twai_stop_v2(handle);
+}
+
+esp_err_t TwaiCanDriver::receive(twai_message_t & frame, uint32_t timeout_ms) {
+    return twai_receive_v2(handle, &frame, pdMS_TO_TICKS(timeout_ms));
+}
+
+esp_err_t TwaiCanDriver::transmit(const twai_message_t & frame, uint32_t timeout_ms) {
+    return twai_transmit_v2(handle, &frame, pdMS_TO_TICKS(timeout_ms));
+}
+
+esp_err_t TwaiCanDriver::read_alerts(uint32_t & alerts, uint32_t timeout_ms) {
+    return twai_read_alerts_v2(handle, &alerts, pdMS_TO_TICKS(timeout_ms));
+}
+
+esp_err_t TwaiCanDriver::get_status_info(twai_status_info_t & status) {
+    return twai_get_status_info_v2(handle, &status);
+}
+
+esp_err_t TwaiCanDriver::initiate_recovery() {
+    return twai_initiate_recovery_v2(handle);
+}
+
+#else
+
+esp_err_t TwaiCanDriver::install() {
+    if (config.controller != 0)
+        return ESP_ERR_NOT_SUPPORTED;
+    return twai_driver_install(&config.general, &config.timing, &config.filter);
+}
+
+esp_err_t TwaiCanDriver::uninstall() {
+    return twai_driver_uninstall();
+}
+
+esp_err_t TwaiCanDriver::start() {
+    return twai_start();
+}
+
+esp_err_t TwaiCanDriver::stop() {
+    return twai_stop();
+}
+
+esp_err_t TwaiCanDriver::receive(twai_message_t & frame, uint32_t timeout_ms) {
+    return twai_receive(&frame, pdMS_TO_TICKS(timeout_ms));
+}
+
+esp_err_t TwaiCanDriver::transmit(const twai_message_t & frame, uint32_t timeout_ms) {
+    return twai_transmit(&frame, pdMS_TO_TICKS(timeout_ms));
+}
+
+esp_err_t TwaiCanDriver::read_alerts(uint32_t & alerts, uint32_t timeout_ms) {
+    return twai_read_alerts(&alerts, pdMS_TO_TICKS(timeout_ms));
+}
+
+esp_err_t TwaiCanDriver::get_status_info(twai_status_info_t & status) {
+    return twai_get_status_info(&status);
+}
+
+esp_err_t TwaiCanDriver::initiate_recovery() {
+    return twai_initiate_recovery();
+}
+
+#endif
+
+bool TwaiCanDriver::reset() {
+    // Stop the driver first
+    esp_err_t stop_res = stop();
+    if (stop_res != ESP_OK && stop_res != ESP_ERR_INVALID_STATE) {
+        MB3_LOG_NICE("[TWAI%d] Hard reset: stop() returned %d", config.controller, stop_res);
+    }
+
+    // Give it a moment to stop
+    vTaskDelay(pdMS_TO_TICKS(100));
+
+    // Uninstall the driver
+    esp_err_t uninstall_res = uninstall();
+    if (uninstall_res != ESP_OK) {
+        MB3_LOG_NICE("[TWAI%d] Hard reset: uninstall() failed: %d", config.controller, uninstall_res);
+        return false;
+    }
+
+    MB3_LOG_NICE("[TWAI%d] Hard reset: Driver uninstalled, waiting 200ms before reinstall", config.controller);
+    vTaskDelay(pdMS_TO_TICKS(200));
+
+    // Reinstall the driver with the same config
+    esp_err_t install_res = install();
+    if (install_res != ESP_OK) {
+        MB3_LOG_NICE("[TWAI%d] Hard reset: install() failed: %d", config.controller, install_res);
+        return false;
+    }
+
+    MB3_LOG_NICE("[TWAI%d] Hard reset: Driver reinstalled, starting...", config.controller);
+
+    esp_err_t start_res = start();
+    if (start_res != ESP_OK) {
+        MB3_LOG_NICE("[TWAI%d] Hard reset: start() failed: %d", config.controller, start_res);
+        return false;
+    }
+    return true;
+}
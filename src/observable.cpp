@@ -1,3 +0,0 @@
-#include <mb3/observable.hpp>
-
-std::vector<std::unique_ptr<IObservable>> ObservableManager::_observables;
@@ -0,0 +1,18 @@
+#include <config.hpp>
+#include <mb3/defaults.hpp>
+
+#if MB3_SCREEN_ARENA
+
+#include <mb3/screen_arena.hpp>
+
+// Linked with -Wl,--wrap=lv_free_core: LVGL frees deleted widgets itself,
+// arena memory goes with its screen instead
+extern "C" void __real_lv_free_core(void * p);
+
+extern "C" void __wrap_lv_free_core(void * p) {
+    if (ScreenArena::on_lv_free(p))
+        return;
+    __real_lv_free_core(p);
+}
+
+#endif
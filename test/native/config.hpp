@@ -0,0 +1,4 @@
+#pragma once
+
+// Project configuration for env:native. An application provides its own
+// config.hpp; the test suites run on MB3's defaults (defaults.hpp).
@@ -0,0 +1,31 @@
+/**
+ * LVGL configuration for env:native, used by the test suites. Only what
+ * differs from LVGL's defaults (lv_conf_internal.h) is set here.
+ */
+
+#ifndef LV_CONF_H
+#define LV_CONF_H
+
+/* RGB565, like the panels; the suites' frame buffers are sized for it */
+#define LV_COLOR_DEPTH 16
+
+/* LVGL's own heap, so lv_mem_monitor reports use and fragmentation */
+#define LV_USE_STDLIB_MALLOC LV_STDLIB_BUILTIN
+#define LV_MEM_SIZE (1024 * 1024U)
+
+/* draw units on their own threads, as on the S3, so AsyncCanvasLayer's
+ * submissions really overlap with recording the next canvas */
+#define LV_USE_OS LV_OS_PTHREAD
+#define LV_DRAW_SW_DRAW_UNIT_CNT 2
+
+/* vector paths (Shape, RetainedPath) through the software ThorVG renderer */
+#define LV_USE_FLOAT 1
+#define LV_USE_MATRIX 1
+#define LV_USE_VECTOR_GRAPHIC 1
+#define LV_USE_THORVG_INTERNAL 1
+
+#define LV_USE_LOG 1
+#define LV_LOG_LEVEL LV_LOG_LEVEL_WARN
+#define LV_LOG_PRINTF 1
+
+#endif /*LV_CONF_H*/
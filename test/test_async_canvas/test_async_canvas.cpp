@@ -0,0 +1,154 @@
+#include <unity.h>
+
+// Headless render benchmark, needs LVGL (and the project's lv_conf/config.hpp)
+// in the native environment
+#if __has_include(<lvgl.h>) && __has_include(<config.hpp>)
+
+#include <mb3/lvgl_mb3.hpp>
+
+constexpr int32_t WIDTH = 160;
+constexpr int32_t HEIGHT = 120;
+constexpr int CANVASES = 4;
+
+static lv_display_t * display;
+static uint8_t frame[WIDTH * HEIGHT * 2];
+static lv_obj_t * canvases[CANVASES];
+static lv_draw_buf_t * buffers[CANVASES];
+
+static void flush(lv_display_t * display, const lv_area_t * area, uint8_t * pixels) {
+    lv_display_flush_ready(display);
+}
+
+static uint32_t tick() {
+    return esp_timer_get_time() / 1000;
+}
+
+static void draw_rects(lv_layer_t * layer, int seed) {
+    lv_draw_rect_dsc_t dsc;
+    lv_draw_rect_dsc_init(&dsc);
+    dsc.radius = 6;
+    for (int i = 0; i < 20; i++) {
+        dsc.bg_color = lv_color_hex(0x102030 * (seed + 1) + i * 0x0804);
+        lv_area_t area = {(i * 7) % WIDTH, (i * 5) % HEIGHT, (i * 7) % WIDTH + 40, (i * 5) % HEIGHT + 30};
+        lv_draw_rect(layer, &dsc, &area);
+    }
+}
+
+static uint16_t pixel(int canvas, int32_t x, int32_t y) {
+    return ((uint16_t*)lv_draw_buf_goto_xy(buffers[canvas], x, y))[0];
+}
+
+void setUp(void) {
+    lv_init();
+    lv_tick_set_cb(tick);
+    display = lv_display_create(WIDTH, HEIGHT);
+    lv_display_set_color_format(display, LV_COLOR_FORMAT_RGB565);
+    lv_display_set_buffers(display, frame, nullptr, sizeof(frame), LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_set_flush_cb(display, flush);
+    for (int i = 0; i < CANVASES; i++) {
+        buffers[i] = lv_draw_buf_create(WIDTH, HEIGHT, LV_COLOR_FORMAT_RGB565, LV_STRIDE_AUTO);
+        canvases[i] = lv_canvas_create(lv_screen_active());
+        lv_canvas_set_draw_buf(canvases[i], buffers[i]);
+    }
+}
+
+void tearDown(void) {
+    for (int i = 0; i < CANVASES; i++) {
+        lv_obj_delete(canvases[i]);
+        lv_draw_buf_destroy(buffers[i]);
+    }
+    lv_display_delete(display);
+    lv_deinit();
+}
+
+void test_completes_like_sync(void) {
+    clearCanvas(canvases[0]);
+    {
+        CanvasLayer layer(canvases[0]);
+        draw_rects(layer, 0);
+    }
+
+    static int completed;
+    completed = 0;
+    clearCanvas(canvases[1]);
+    AsyncCanvasLayer layer(canvases[1]);
+    draw_rects(layer, 0);
+    TEST_ASSERT_FALSE(layer.done());
+    layer.submit([](lv_obj_t * canvas) {
+        TEST_ASSERT_EQUAL_PTR(canvases[1], canvas);
+        completed++;
+    });
+    layer.wait();
+    TEST_ASSERT_TRUE(layer.done());
+    TEST_ASSERT_EQUAL(1, completed);
+    TEST_ASSERT_EQUAL(0, AsyncCanvasLayer::poll());
+
+    for (int32_t y = 0; y < HEIGHT; y += 7) {
+        for (int32_t x = 0; x < WIDTH; x += 5) {
+            TEST_ASSERT_EQUAL(pixel(0, x, y), pixel(1, x, y));
+        }
+    }
+}
+
+void test_render_benchmark(void) {
+    const int frames = 100;
+    int64_t start = esp_timer_get_time();
+    for (int f = 0; f < frames; f++) {
+        for (int i = 0; i < CANVASES; i++) {
+            CanvasLayer layer(canvases[i]);
+            draw_rects(layer, i);
+        }
+    }
+    int64_t sync_us = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (int f = 0; f < frames; f++) {
+        AsyncCanvasLayer * layers[CANVASES];
+        for (int i = 0; i < CANVASES; i++) {
+            layers[i] = new AsyncCanvasLayer(canvases[i]);
+            draw_rects(*layers[i], i);
+            layers[i]->submit();
+        }
+        AsyncCanvasLayer::waitAll();
+        for (int i = 0; i < CANVASES; i++) {
+            delete layers[i];
+        }
+    }
+    int64_t async_us = esp_timer_get_time() - start;
+
+    char message[160];
+    snprintf(message, sizeof(message), "%d canvases: one at a time %.1f us/frame, submitted together %.1f us/frame",
+        CANVASES, sync_us / (double)frames, async_us / (double)frames);
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_completes_like_sync);
+    RUN_TEST(test_render_benchmark);
+    UNITY_END();
+
+    return 0;
+}
+
+#else
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_render_benchmark(void) {
+    TEST_IGNORE_MESSAGE("LVGL isn't available in this environment");
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_render_benchmark);
+    UNITY_END();
+
+    return 0;
+}
+
+#endif
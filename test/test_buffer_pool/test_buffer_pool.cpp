@@ -0,0 +1,138 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <mb3/buffer_pool.hpp>
+
+constexpr uint32_t RGB565 = 0x12;
+constexpr uint32_t ARGB8888 = 0x10;
+constexpr uint32_t PSRAM = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+constexpr uint32_t INTERNAL = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_size_class(void) {
+    TEST_ASSERT_EQUAL(64, BufferPool<1>::size_class(1));
+    TEST_ASSERT_EQUAL(64, BufferPool<1>::size_class(64));
+    TEST_ASSERT_EQUAL(80, BufferPool<1>::size_class(65));
+    TEST_ASSERT_EQUAL(1024, BufferPool<1>::size_class(1024));
+    TEST_ASSERT_EQUAL(1280, BufferPool<1>::size_class(1025));
+    for (size_t size = 1; size < 200000; size += 37) {
+        size_t bytes = BufferPool<1>::size_class(size);
+        TEST_ASSERT_TRUE(bytes >= size);
+        TEST_ASSERT_TRUE(size <= 64 || bytes <= size + size / 4);
+    }
+}
+
+void test_reuse(void) {
+    BufferPool<4> pool("test");
+    void * a = pool.acquire(1000, RGB565, PSRAM);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_EQUAL(0, (uintptr_t)a % 64);
+    TEST_ASSERT_EQUAL(1, pool.lent());
+    pool.release(a);
+    TEST_ASSERT_EQUAL(0, pool.lent());
+
+    // same format, caps and size class
+    TEST_ASSERT_EQUAL_PTR(a, pool.acquire(990, RGB565, PSRAM));
+    TEST_ASSERT_EQUAL(1, pool.hits());
+    TEST_ASSERT_EQUAL(1, pool.misses());
+    pool.release(a);
+
+    // another format, other memory, or lent out: a new buffer
+    void * b = pool.acquire(1000, ARGB8888, PSRAM);
+    void * c = pool.acquire(1000, RGB565, INTERNAL);
+    void * d = pool.acquire(1000, RGB565, PSRAM);
+    void * e = pool.acquire(1000, RGB565, PSRAM);
+    TEST_ASSERT_TRUE(b != a && c != a);
+    TEST_ASSERT_EQUAL_PTR(a, d);
+    TEST_ASSERT_TRUE(e != a);
+    TEST_ASSERT_EQUAL(2, pool.hits());
+    TEST_ASSERT_EQUAL(4, pool.misses());
+    TEST_ASSERT_EQUAL(4 * 1024, pool.memory());
+    TEST_ASSERT_EQUAL(1024, pool.memory(MALLOC_CAP_INTERNAL));
+    TEST_ASSERT_TRUE(pool.owns(e));
+    pool.report();
+}
+
+void test_eviction(void) {
+    BufferPool<2> pool("test");
+    void * a = pool.acquire(100, RGB565, PSRAM);
+    void * b = pool.acquire(200, RGB565, PSRAM);
+    pool.release(a);
+    pool.release(b);
+    // a is the least recently used
+    void * c = pool.acquire(300, RGB565, PSRAM);
+    TEST_ASSERT_EQUAL(1, pool.evictions());
+    TEST_ASSERT_FALSE(pool.owns(a));
+    TEST_ASSERT_TRUE(pool.owns(b));
+    TEST_ASSERT_TRUE(pool.owns(c));
+
+    // all lent: handed out unpooled, freed on release
+    void * d = pool.acquire(200, RGB565, PSRAM);
+    void * e = pool.acquire(400, RGB565, PSRAM);
+    TEST_ASSERT_EQUAL_PTR(b, d);
+    TEST_ASSERT_NOT_NULL(e);
+    TEST_ASSERT_FALSE(pool.owns(e));
+    TEST_ASSERT_EQUAL(1, pool.unpooled());
+    pool.release(e);
+
+    pool.release(c);
+    pool.trim();
+    TEST_ASSERT_FALSE(pool.owns(c));
+    TEST_ASSERT_EQUAL(BufferPool<2>::size_class(200), pool.memory());
+    pool.release(d);
+}
+
+/// @brief Layer-sized buffers per frame, pool vs aligned alloc/free
+void test_benchmark(void) {
+    const int frames = 2000;
+    const int layers = 6;
+    const size_t sizes[layers] = {64 * 64 * 2, 120 * 40 * 2, 64 * 64 * 4, 200 * 20 * 2, 32 * 32 * 4, 120 * 40 * 2};
+    void * buffers[layers];
+
+    int64_t start = esp_timer_get_time();
+    for (int f = 0; f < frames; f++) {
+        for (int i = 0; i < layers; i++) {
+            buffers[i] = heap_caps_aligned_alloc(64, sizes[i], PSRAM);
+            *(volatile uint8_t*)buffers[i] = i;
+        }
+        for (int i = 0; i < layers; i++) {
+            heap_caps_free(buffers[i]);
+        }
+    }
+    int64_t heap_us = esp_timer_get_time() - start;
+
+    BufferPool<8> pool("bench");
+    start = esp_timer_get_time();
+    for (int f = 0; f < frames; f++) {
+        for (int i = 0; i < layers; i++) {
+            buffers[i] = pool.acquire(sizes[i], i & 1, PSRAM);
+            *(volatile uint8_t*)buffers[i] = i;
+        }
+        for (int i = 0; i < layers; i++) {
+            pool.release(buffers[i]);
+        }
+    }
+    int64_t pool_us = esp_timer_get_time() - start;
+    TEST_ASSERT_EQUAL(layers, pool.misses());
+
+    char message[160];
+    snprintf(message, sizeof(message), "%d layers: alloc/free %.1f ns each, pool %.1f ns each (%u bytes held)",
+        frames * layers, heap_us * 1000.0 / (frames * layers), pool_us * 1000.0 / (frames * layers), (unsigned)pool.memory());
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_size_class);
+    RUN_TEST(test_reuse);
+    RUN_TEST(test_eviction);
+    RUN_TEST(test_benchmark);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include <unity.h>
+#include <vector>
+#include <mb3/can_batch.hpp>
+#include <mb3/observable.hpp>
+
+constexpr CanSignalInfo ENGINE[] = {
+    {"rpm", "rpm", 0, 16, 0.25f},
+    {"coolant", "C", 16, 8, 1.f, -40.f},
+    {"oil", "C", 24, 8, 1.f, -40.f},
+    {"throttle", "%", 32, 8, 0.4f},
+    {"load", "%", 40, 8, 0.4f},
+    {"map", "kPa", 48, 10, 0.5f},
+    {"gear", nullptr, 58, 4},
+    {"clutch", nullptr, 62, 1},
+};
+constexpr size_t SIGNALS = sizeof(ENGINE) / sizeof(ENGINE[0]);
+
+static std::vector<uint64_t> make_payloads(size_t count) {
+    std::vector<uint64_t> payloads(count);
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (auto & payload : payloads) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        payload = state;
+    }
+    return payloads;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_matches_table_frame(void) {
+    CanTableFrame<SIGNALS> table("Engine", 0x100, ENGINE);
+    CanBatchFrame<SIGNALS> batch("Engine", 0x100, ENGINE);
+    for (auto payload : make_payloads(1000)) {
+        memcpy(table.data(), &payload, 8);
+        memcpy(batch.data(), &payload, 8);
+        table.update();
+        batch.update();
+        for (size_t i = 0; i < SIGNALS; i++) {
+            TEST_ASSERT_EQUAL_FLOAT((float)table[i], batch.value(i));
+        }
+    }
+}
+
+void test_columns(void) {
+    auto payloads = make_payloads(1003);
+    std::vector<std::vector<float>> storage(SIGNALS, std::vector<float>(payloads.size()));
+    float * columns[SIGNALS];
+    for (size_t i = 0; i < SIGNALS; i++) {
+        columns[i] = storage[i].data();
+    }
+    can_batch_decode(ENGINE, payloads.data(), payloads.size(), columns);
+
+    CanTableFrame<SIGNALS> table("Engine", 0x100, ENGINE);
+    for (size_t f = 0; f < payloads.size(); f++) {
+        memcpy(table.data(), &payloads[f], 8);
+        table.update();
+        for (size_t i = 0; i < SIGNALS; i++) {
+            TEST_ASSERT_EQUAL_FLOAT((float)table[i], columns[i][f]);
+        }
+    }
+}
+
+void test_observable(void) {
+    CanBatchFrame<SIGNALS> batch("Engine", 0x100, ENGINE);
+    auto coolant = new TObservable<float, const float>(batch.value_ptr(1), batch[1]);
+    coolant->hasChanged();
+    batch.data()[2] = 130;
+    batch.update();
+    ObservableManager::update();
+    TEST_ASSERT_TRUE(coolant->hasChanged());
+    TEST_ASSERT_EQUAL_FLOAT(90.f, coolant->get());
+}
+
+void test_replay_benchmark(void) {
+    const size_t count = 1 << 20;
+    auto payloads = make_payloads(count);
+    volatile float sink = 0;
+
+    // per signal, through the frame and operator float
+    CanTableFrame<SIGNALS> table("Engine", 0x100, ENGINE);
+    auto start = esp_timer_get_time();
+    for (auto payload : payloads) {
+        memcpy(table.data(), &payload, 8);
+        table.update();
+        float sum = 0;
+        for (size_t i = 0; i < SIGNALS; i++) {
+            sum += (float)table[i];
+        }
+        sink = sink + sum;
+    }
+    auto per_signal = esp_timer_get_time() - start;
+
+    // per frame, batch converted
+    CanBatchFrame<SIGNALS> batch("Engine", 0x100, ENGINE);
+    start = esp_timer_get_time();
+    for (auto payload : payloads) {
+        memcpy(batch.data(), &payload, 8);
+        batch.update();
+        float sum = 0;
+        for (size_t i = 0; i < SIGNALS; i++) {
+            sum += batch.value(i);
+        }
+        sink = sink + sum;
+    }
+    auto per_frame = esp_timer_get_time() - start;
+
+    // whole log, column at a time
+    std::vector<std::vector<float>> storage(SIGNALS, std::vector<float>(count));
+    float * columns[SIGNALS];
+    for (size_t i = 0; i < SIGNALS; i++) {
+        columns[i] = storage[i].data();
+    }
+    start = esp_timer_get_time();
+    can_batch_decode(ENGINE, payloads.data(), count, columns);
+    auto columnar = esp_timer_get_time() - start;
+    sink = sink + columns[0][count - 1];
+
+    char buffer[200];
+    snprintf(buffer, sizeof(buffer), "%zu frames x %zu signals: per signal %.1f Mframes/s, batch frame %.1f Mframes/s, columns %.1f Mframes/s",
+        count, SIGNALS, count / (double)per_signal, count / (double)per_frame, count / (double)columnar);
+    TEST_MESSAGE(buffer);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_table_frame);
+    RUN_TEST(test_columns);
+    RUN_TEST(test_observable);
+    RUN_TEST(test_replay_benchmark);
+    UNITY_END();
+
+    return 0;
+}
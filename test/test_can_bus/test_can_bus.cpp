@@ -0,0 +1,208 @@
+#include <unity.h>
+#include <thread>
+#include <mb3/can_bus.hpp>
+#include <mb3/can_driver_sim.hpp>
+
+// Two unrelated vehicles sharing the id 0x100 on different buses
+
+class VehicleFrame : public CanFrame<VehicleFrame> {
+public:
+    VehicleFrame() : CanFrame("Vehicle", 0x100) { }
+
+    CanSignal<uint16_t> rpm{16, 0.25f};
+    CanSignal<uint8_t> coolant{8, 1.f, -40.f};
+    CanSignal<uint8_t> gear{8};
+};
+
+class AccessoryFrame : public CanFrame<AccessoryFrame> {
+public:
+    AccessoryFrame() : CanFrame("Accessory", 0x100) { }
+
+    CanSignal<uint8_t> lights{8};
+    CanSignal<uint8_t> pump{8};
+};
+
+static VehicleFrame * vehicle;
+static AccessoryFrame * accessory;
+static std::shared_ptr<ICanFrame> vehicle_frame, accessory_frame;
+static std::shared_ptr<SimulatedCanDriver> driver_a, driver_b;
+static std::shared_ptr<CanBus> bus_a, bus_b;
+
+static twai_message_t make_frame(uint32_t id, std::initializer_list<uint8_t> data) {
+    twai_message_t frame = {};
+    frame.identifier = id;
+    frame.data_length_code = data.size();
+    std::copy(data.begin(), data.end(), frame.data);
+    return frame;
+}
+
+void setUp(void) {
+    driver_a = std::make_shared<SimulatedCanDriver>();
+    driver_b = std::make_shared<SimulatedCanDriver>();
+    driver_a->rx_queue_len = 0;
+    driver_b->rx_queue_len = 0;
+    bus_a = std::make_shared<CanBus>("CAN-A", driver_a);
+    bus_b = std::make_shared<CanBus>("CAN-B", driver_b);
+    bus_a->log_unknown = false;
+    bus_b->log_unknown = false;
+    vehicle = new VehicleFrame();
+    vehicle_frame = vehicle->unowned();
+    accessory = new AccessoryFrame();
+    accessory_frame = accessory->unowned();
+    bus_a->add(vehicle_frame);
+    bus_b->add(accessory_frame);
+    TEST_ASSERT_TRUE(bus_a->setup(0));
+    TEST_ASSERT_TRUE(bus_b->setup(0));
+}
+
+void tearDown(void) {
+    bus_a.reset();
+    bus_b.reset();
+    // unowned() doesn't own the frames, their creator does
+    vehicle_frame.reset();
+    accessory_frame.reset();
+    delete vehicle;
+    delete accessory;
+}
+
+void test_independent_registries(void) {
+    driver_a->inject(make_frame(0x100, {0x40, 0x1F, 130, 3}));
+    driver_b->inject(make_frame(0x100, {1, 0}));
+    driver_a->inject(make_frame(0x200, {0}));
+
+    bus_a->service(1);
+    bus_b->service(1);
+
+    TEST_ASSERT_EQUAL_FLOAT(2000.f, (float)vehicle->rpm);
+    TEST_ASSERT_EQUAL_FLOAT(90.f, (float)vehicle->coolant);
+    TEST_ASSERT_EQUAL(3, (uint8_t)vehicle->gear);
+    TEST_ASSERT_EQUAL(1, (uint8_t)accessory->lights);
+    TEST_ASSERT_EQUAL(0, (uint8_t)accessory->pump);
+
+    TEST_ASSERT_EQUAL(2, bus_a->stats.rx_frames);
+    TEST_ASSERT_EQUAL(1, bus_a->stats.rx_decoded);
+    TEST_ASSERT_EQUAL(1, bus_a->stats.rx_unknown);
+    TEST_ASSERT_EQUAL(1, bus_b->stats.rx_frames);
+    TEST_ASSERT_EQUAL(0, bus_b->stats.rx_unknown);
+}
+
+/// @brief The same frame type on two buses, each instance with its own signals
+void test_same_type_twice(void) {
+    // owned by the pointer, freed once the bus lets go of it too
+    auto other = VehicleFrame::create();
+    bus_b->add(other);
+    TEST_ASSERT_EQUAL(vehicle->size(), other->size());
+    driver_a->inject(make_frame(0x100, {0x40, 0x1F, 130, 3}));
+    driver_b->inject(make_frame(0x100, {0x20, 0x03, 50, 1}));
+    bus_a->service(1);
+    bus_b->service(1);
+    TEST_ASSERT_EQUAL(3, (uint8_t)vehicle->gear);
+    TEST_ASSERT_EQUAL(1, (uint8_t)other->gear);
+    TEST_ASSERT_EQUAL_FLOAT(10.f, (float)other->coolant);
+    TEST_ASSERT_TRUE(vehicle->gear.parent == vehicle);
+    TEST_ASSERT_TRUE(other->gear.parent == other.get());
+    bus_b.reset();
+    TEST_ASSERT_EQUAL(1, other.use_count());
+}
+
+void test_filters(void) {
+    bus_b->filters.push_back({0x100, 0x7FF});
+    driver_b->inject(make_frame(0x100, {0, 1}));
+    driver_b->inject(make_frame(0x321, {0}));
+    bus_b->service(1);
+    TEST_ASSERT_EQUAL(1, bus_b->stats.rx_decoded);
+    TEST_ASSERT_EQUAL(1, bus_b->stats.rx_filtered);
+    TEST_ASSERT_EQUAL(0, bus_b->stats.rx_unknown);
+    TEST_ASSERT_EQUAL(1, (uint8_t)accessory->pump);
+}
+
+void test_wired_transmit(void) {
+    driver_a->connect(*driver_b);
+    TEST_ASSERT_TRUE(bus_a->transmit(make_frame(0x100, {0, 0})));
+    TEST_ASSERT_EQUAL(1, bus_a->stats.tx_frames);
+    bus_b->service(1);
+    TEST_ASSERT_EQUAL(1, bus_b->stats.rx_decoded);
+}
+
+void test_recovery_is_per_bus(void) {
+    const uint32_t after_grace = CanRecoveryState::STARTUP_GRACE_MS + 1000;
+    driver_a->inject(make_frame(0x100, {0, 0, 0, 0}));
+    driver_b->inject(make_frame(0x100, {0, 0}));
+    bus_a->service(after_grace);
+    bus_b->service(after_grace);
+
+    driver_a->set_state(TWAI_STATE_BUS_OFF, 255, 0);
+    driver_a->raise(TWAI_ALERT_BUS_OFF);
+    bus_a->service(after_grace + 1);
+    bus_b->service(after_grace + 1);
+
+    // maxed error counters go straight to a hard reset
+    TEST_ASSERT_EQUAL(1, bus_a->stats.hard_resets);
+    TEST_ASSERT_EQUAL(2, driver_a->installs);
+    TEST_ASSERT_EQUAL(0, bus_b->stats.hard_resets);
+    TEST_ASSERT_EQUAL(1, driver_b->installs);
+
+    // a plain bus off after the debounce is a soft recovery
+    driver_a->set_state(TWAI_STATE_BUS_OFF, 128, 0);
+    driver_a->raise(TWAI_ALERT_BUS_OFF);
+    driver_a->inject(make_frame(0x100, {0, 0, 0, 0}));
+    bus_a->service(after_grace + 2);
+    TEST_ASSERT_EQUAL(1, bus_a->stats.soft_recoveries);
+    TEST_ASSERT_EQUAL(1, driver_a->recoveries);
+    TEST_ASSERT_EQUAL(0, bus_b->stats.soft_recoveries);
+    TEST_ASSERT_EQUAL(0, bus_b->recovery.recovery_attempt_count);
+}
+
+void test_parallel_service(void) {
+    const size_t frames = 200000;
+    uint32_t sum_a = 0, sum_b = 0;
+    vehicle->callbacks.push_back([&](VehicleFrame & frame) { sum_a += (uint8_t)frame.gear; });
+    accessory->callbacks.push_back([&](AccessoryFrame & frame) { sum_b += (uint8_t)frame.lights; });
+
+    auto feed = [&](SimulatedCanDriver & driver, size_t dlc) {
+        for (size_t i = 0; i < frames; i++) {
+            uint8_t v = i & 1;
+            driver.inject(dlc == 4 ? make_frame(0x100, {0, 0, 0, v}) : make_frame(0x100, {v, 0}));
+        }
+    };
+    auto serve = [&](CanBus & bus) {
+        uint32_t now = 1;
+        while (bus.stats.rx_frames < frames) {
+            bus.service(now++ % 1000);
+        }
+    };
+
+    std::thread feed_a(feed, std::ref(*driver_a), 4), feed_b(feed, std::ref(*driver_b), 2);
+    auto start = esp_timer_get_time();
+    std::thread serve_a(serve, std::ref(*bus_a)), serve_b(serve, std::ref(*bus_b));
+    feed_a.join();
+    feed_b.join();
+    serve_a.join();
+    serve_b.join();
+    auto elapsed = esp_timer_get_time() - start;
+
+    vehicle->callbacks.clear();
+    accessory->callbacks.clear();
+
+    TEST_ASSERT_EQUAL(frames, bus_a->stats.rx_decoded);
+    TEST_ASSERT_EQUAL(frames, bus_b->stats.rx_decoded);
+    TEST_ASSERT_EQUAL(frames / 2, sum_a);
+    TEST_ASSERT_EQUAL(frames / 2, sum_b);
+
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "2 buses x %zu frames in %lld us", frames, (long long)elapsed);
+    TEST_MESSAGE(buffer);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_independent_registries);
+    RUN_TEST(test_same_type_twice);
+    RUN_TEST(test_filters);
+    RUN_TEST(test_wired_transmit);
+    RUN_TEST(test_recovery_is_per_bus);
+    RUN_TEST(test_parallel_service);
+    UNITY_END();
+
+    return 0;
+}
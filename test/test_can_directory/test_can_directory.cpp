@@ -0,0 +1,206 @@
+#include <unity.h>
+#include <cstdlib>
+#include <new>
+#include <mb3/can_directory.hpp>
+#include <mb3/can_table.hpp>
+
+static size_t allocations = 0;
+
+void * operator new(size_t size) {
+    allocations++;
+    if (void * p = std::malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+// GCC sees free() inlined where new'd pointers are deleted and flags it, not
+// knowing this operator new is the malloc above
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void operator delete(void * p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void * p, size_t) noexcept {
+    std::free(p);
+}
+
+#pragma GCC diagnostic pop
+
+class EngineFrame : public CanFrame<EngineFrame> {
+public:
+    EngineFrame() : CanFrame("Engine", 0x100) {
+        rpm.name = "rpm";
+        coolant.name = "coolant";
+    }
+
+    CanSignal<uint16_t> rpm{16, 0.25f};
+    CanSignal<uint8_t> coolant{8, 1.f, -40.f};
+    CanSignal<uint8_t> unnamed{8};
+};
+
+constexpr CanSignalInfo BODY[] = {
+    {"speed", "km/h", 0, 16, 0.01f},
+    {"door", nullptr, 16, 1},
+    {"lights", nullptr, 17, 2},
+};
+
+class Counter : public IUpdatable {
+public:
+    virtual void update() override {
+        count++;
+    }
+    int count = 0;
+};
+
+static EngineFrame * engine;
+static std::shared_ptr<ICanFrame> engine_frame;
+static CanTableFrame<3> body{"Body", 0x200, BODY};
+static CanSignalDirectory directory;
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_build(void) {
+    engine = new EngineFrame();
+    engine_frame = engine->unowned();
+    std::map<uint32_t, std::shared_ptr<ICanFrame>> types;
+    types[engine_frame->id()] = engine_frame;
+    types[body.id()] = body.unowned();
+    directory.add(types);
+    directory.build();
+    TEST_ASSERT_EQUAL(6, directory.size());
+}
+
+void test_find(void) {
+    allocations = 0;
+    auto rpm = directory.find("Engine->rpm");
+    auto unnamed = directory.find("Engine->unk18");
+    auto speed = directory.find("Body->speed");
+    auto missing = directory.find("Body->rpm");
+    auto partial = directory.find("Engine");
+    TEST_ASSERT_EQUAL(0, allocations);
+
+    TEST_ASSERT_TRUE((bool)rpm);
+    TEST_ASSERT_TRUE((bool)unnamed);
+    TEST_ASSERT_TRUE((bool)speed);
+    TEST_ASSERT_FALSE((bool)missing);
+    TEST_ASSERT_FALSE((bool)partial);
+    TEST_ASSERT_EQUAL_STRING("Body->speed", speed.name());
+    TEST_ASSERT_TRUE(rpm == directory.find("Engine->rpm"));
+    TEST_ASSERT_EQUAL_PTR(static_cast<Subscribable *>(&engine->rpm), &rpm.signal());
+}
+
+void test_values_and_subscriptions(void) {
+    auto rpm = directory.find("Engine->rpm");
+    auto speed = directory.find("Body->speed");
+    Counter rpm_count, speed_count;
+    Subscription rpm_subscription(&rpm_count), speed_subscription(&speed_count);
+    rpm.subscribe(rpm_subscription);
+    speed.subscribe(speed_subscription);
+
+    uint8_t engine_data[] = {0x40, 0x1F, 130, 0};
+    memcpy(engine->data(), engine_data, sizeof(engine_data));
+    engine->update();
+    uint8_t body_data[] = {0x10, 0x27, 0x01};
+    memcpy(body.data(), body_data, sizeof(body_data));
+    body.update();
+
+    TEST_ASSERT_EQUAL_FLOAT(2000.f, rpm.value());
+    TEST_ASSERT_EQUAL_FLOAT(100.f, speed.value());
+    TEST_ASSERT_EQUAL_FLOAT(90.f, directory.find("Engine->coolant").value());
+    TEST_ASSERT_EQUAL(1, rpm_count.count);
+    TEST_ASSERT_EQUAL(1, speed_count.count);
+}
+
+void test_enumerate(void) {
+    const char * expected[] = {"Body->speed", "Body->door", "Body->lights"};
+    size_t i = 0;
+    for (auto signal : directory.frame("Body")) {
+        TEST_ASSERT_EQUAL_STRING(expected[i++], signal.name());
+    }
+    TEST_ASSERT_EQUAL(3, i);
+    TEST_ASSERT_EQUAL(0, directory.frame("Nope").size());
+
+    size_t count = 0;
+    directory.each("Engine->", [&](CanSignalDirectory::Handle) { count++; });
+    TEST_ASSERT_EQUAL(3, count);
+}
+
+void test_lookup_benchmark(void) {
+    // a larger directory: 64 frames of 8 signals
+    static CanSignalInfo table[8] = {
+        {"a", nullptr, 0, 8}, {"b", nullptr, 8, 8}, {"c", nullptr, 16, 8}, {"d", nullptr, 24, 8},
+        {"e", nullptr, 32, 8}, {"f", nullptr, 40, 8}, {"g", nullptr, 48, 8}, {"h", nullptr, 56, 8},
+    };
+    std::vector<std::unique_ptr<CanTableFrame<8>>> frames;
+    std::vector<std::string> frame_names;
+    CanSignalDirectory large;
+    for (size_t i = 0; i < 64; i++) {
+        frame_names.push_back("Frame" + std::to_string(i));
+    }
+    for (size_t i = 0; i < 64; i++) {
+        frames.emplace_back(new CanTableFrame<8>(frame_names[i].c_str(), 0x100 + i, table));
+        large.add(*frames.back());
+    }
+    large.build();
+
+    std::vector<std::string> queries;
+    for (size_t i = 0; i < 512; i++) {
+        queries.push_back(frame_names[(i * 7) % 64] + "->" + table[i % 8].name);
+    }
+
+    const size_t rounds = 200;
+    size_t found = 0;
+    allocations = 0;
+    auto start = esp_timer_get_time();
+    for (size_t r = 0; r < rounds; r++) {
+        for (auto const & query : queries) {
+            found += (bool)large.find(query.c_str());
+        }
+    }
+    auto hashed = esp_timer_get_time() - start;
+    TEST_ASSERT_EQUAL(0, allocations);
+    TEST_ASSERT_EQUAL(rounds * queries.size(), found);
+
+    // the alternative: scanning every frame's members
+    found = 0;
+    start = esp_timer_get_time();
+    for (size_t r = 0; r < rounds; r++) {
+        for (auto const & query : queries) {
+            for (size_t i = 0; i < large.size(); i++) {
+                auto const & frame = frames[i / 8];
+                const char * name = query.c_str();
+                size_t length = frame->name().size();
+                if (strncmp(name, frame->name().c_str(), length) == 0 && name[length] == '-'
+                    && strcmp(name + length + 2, (*frame)[i % 8].name()) == 0) {
+                    found++;
+                    break;
+                }
+            }
+        }
+    }
+    auto scanned = esp_timer_get_time() - start;
+    TEST_ASSERT_EQUAL(rounds * queries.size(), found);
+
+    char buffer[160];
+    snprintf(buffer, sizeof(buffer), "%zu signals, %zu bytes: hashed %.1f ns/lookup, linear scan %.1f ns/lookup",
+        large.size(), large.memory(), hashed * 1000.0 / (rounds * queries.size()), scanned * 1000.0 / (rounds * queries.size()));
+    TEST_MESSAGE(buffer);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_build);
+    RUN_TEST(test_find);
+    RUN_TEST(test_values_and_subscriptions);
+    RUN_TEST(test_enumerate);
+    RUN_TEST(test_lookup_benchmark);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <unity.h>
+#include <mb3/can_gateway.hpp>
+#include <mb3/can_driver_sim.hpp>
+
+static std::shared_ptr<SimulatedCanDriver> vehicle_driver, accessory_driver;
+static std::shared_ptr<CanBus> vehicle, accessory;
+static std::shared_ptr<CanGateway> gateway;
+
+static CanLog make_message(uint32_t id, int64_t timestamp, std::initializer_list<uint8_t> data = {0, 0, 0, 0, 0, 0, 0, 0}) {
+    CanLog message = {};
+    message.timestamp = timestamp;
+    message.frame.identifier = id;
+    message.frame.data_length_code = data.size();
+    std::copy(data.begin(), data.end(), message.frame.data);
+    return message;
+}
+
+void setUp(void) {
+    vehicle_driver = std::make_shared<SimulatedCanDriver>();
+    accessory_driver = std::make_shared<SimulatedCanDriver>();
+    vehicle = std::make_shared<CanBus>("Vehicle", vehicle_driver);
+    accessory = std::make_shared<CanBus>("Accessory", accessory_driver);
+    vehicle->log_unknown = false;
+    accessory->log_unknown = false;
+    vehicle->setup(0);
+    accessory->setup(0);
+    gateway = std::make_shared<CanGateway>();
+    vehicle->stages.push_back(gateway);
+}
+
+void tearDown(void) {
+}
+
+void test_forward_and_decode(void) {
+    auto route = gateway->add(CanRoute::id(0x123, accessory.get()));
+    auto message = make_message(0x123, esp_timer_get_time(), {1, 2, 3});
+    vehicle->receive(message);
+    auto other = make_message(0x124, esp_timer_get_time());
+    vehicle->receive(other);
+
+    auto sent = accessory_driver->take_transmitted();
+    TEST_ASSERT_EQUAL(1, sent.size());
+    TEST_ASSERT_EQUAL_HEX32(0x123, sent[0].identifier);
+    TEST_ASSERT_EQUAL(3, sent[0].data_length_code);
+    TEST_ASSERT_EQUAL(1, gateway->stats(route).forwarded);
+    // still decoded (here: unknown) on the source bus
+    TEST_ASSERT_EQUAL(2, vehicle->stats.rx_unknown);
+}
+
+void test_range_remap_and_mask(void) {
+    gateway->add(CanRoute::range(0x300, 0x30F, accessory.get()).offset_id(0x100).mask_byte(0, 0x0F, 0x80).consume());
+    auto message = make_message(0x305, 0, {0xFF, 0xAA});
+    vehicle->receive(message);
+    auto outside = make_message(0x310, 0);
+    vehicle->receive(outside);
+
+    auto sent = accessory_driver->take_transmitted();
+    TEST_ASSERT_EQUAL(1, sent.size());
+    TEST_ASSERT_EQUAL_HEX32(0x405, sent[0].identifier);
+    TEST_ASSERT_EQUAL_HEX8(0x8F, sent[0].data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, sent[0].data[1]);
+    // consumed frames skip decode on the source bus
+    TEST_ASSERT_EQUAL(1, vehicle->stats.rx_unknown);
+}
+
+void test_extended_replace(void) {
+    gateway->add(CanRoute::masked(0x18FEF100, 0x1FFFFF00, accessory.get(), true).replace_id(0x18FEF1F0));
+    auto message = make_message(0x18FEF117, 0);
+    message.frame.extd = 1;
+    vehicle->receive(message);
+    auto standard = make_message(0x100, 0);
+    vehicle->receive(standard);
+
+    auto sent = accessory_driver->take_transmitted();
+    TEST_ASSERT_EQUAL(1, sent.size());
+    TEST_ASSERT_EQUAL(1, sent[0].extd);
+    TEST_ASSERT_EQUAL_HEX32(0x18FEF1F0, sent[0].identifier);
+}
+
+void test_rate_limit(void) {
+    auto route = gateway->add(CanRoute::id(0x200, accessory.get()).limit(10, 2));
+    // 100 Hz for one second
+    for (int64_t t = 0; t < 1000000; t += 10000) {
+        auto message = make_message(0x200, t);
+        vehicle->receive(message);
+    }
+    auto const & stats = gateway->stats(route);
+    TEST_ASSERT_EQUAL(100, stats.matched);
+    // burst of 2, then one every 100ms
+    TEST_ASSERT_EQUAL(11, stats.forwarded);
+    TEST_ASSERT_EQUAL(89, stats.rate_limited);
+    TEST_ASSERT_EQUAL(11, accessory_driver->take_transmitted().size());
+}
+
+void test_tx_drop(void) {
+    accessory_driver->tx_queue_len = 4;
+    auto route = gateway->add(CanRoute::id(0x200, accessory.get()));
+    for (int i = 0; i < 10; i++) {
+        auto message = make_message(0x200, 0);
+        vehicle->receive(message);
+    }
+    TEST_ASSERT_EQUAL(4, gateway->stats(route).forwarded);
+    TEST_ASSERT_EQUAL(6, gateway->stats(route).tx_dropped);
+    TEST_ASSERT_EQUAL(6, accessory->stats.tx_failed);
+}
+
+void test_forwarding_benchmark(void) {
+    // a realistic table: a handful of single ids plus ranges, most traffic isn't routed
+    for (uint32_t id = 0x100; id < 0x110; id++) {
+        gateway->add(CanRoute::id(id, accessory.get()));
+    }
+    gateway->add(CanRoute::range(0x400, 0x47F, accessory.get()).offset_id(0x200));
+    gateway->add(CanRoute::id(0x7DF, accessory.get()).limit(50, 5));
+
+    const size_t frames = 500000;
+    size_t routed = 0;
+    auto start = esp_timer_get_time();
+    for (size_t i = 0; i < frames; i++) {
+        uint32_t id = (i * 37) & 0x7FF;
+        auto message = make_message(id, esp_timer_get_time());
+        vehicle->receive(message);
+        if ((i & 0xFF) == 0) {
+            routed += accessory_driver->take_transmitted().size();
+        }
+    }
+    auto elapsed = esp_timer_get_time() - start;
+    routed += accessory_driver->take_transmitted().size();
+
+    uint32_t forwarded = 0, max = 0;
+    uint64_t total = 0;
+    for (size_t r = 0; r < gateway->size(); r++) {
+        forwarded += gateway->stats(r).forwarded;
+        total += gateway->stats(r).latency_total;
+        max = std::max(max, gateway->stats(r).latency_max);
+    }
+    TEST_ASSERT_EQUAL(forwarded, routed);
+    TEST_ASSERT_GREATER_THAN(0, forwarded);
+
+    char buffer[160];
+    snprintf(buffer, sizeof(buffer), "Gateway: %zu frames, %u forwarded in %lld us (%.2f Mframes/s), latency avg %.2f us max %u us",
+        frames, forwarded, (long long)elapsed, frames / (double)elapsed, forwarded ? total / (double)forwarded : 0.0, max);
+    TEST_MESSAGE(buffer);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_forward_and_decode);
+    RUN_TEST(test_range_remap_and_mask);
+    RUN_TEST(test_extended_replace);
+    RUN_TEST(test_rate_limit);
+    RUN_TEST(test_tx_drop);
+    RUN_TEST(test_forwarding_benchmark);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <unity.h>
+#include <mb3/can_table.hpp>
+#include <mb3/can_driver_sim.hpp>
+#include <mb3/observable.hpp>
+
+constexpr CanSignalInfo ENGINE[] = {
+    {"rpm", "rpm", 0, 16, 0.25f},
+    {"coolant", "C", 16, 8, 1.f, -40.f},
+    {"gear", nullptr, 24, 4},
+    {"clutch", nullptr, 28, 1},
+};
+static_assert(can_table_bits(ENGINE) == 29, "layout");
+
+enum Engine { RPM, COOLANT, GEAR, CLUTCH };
+
+// the same frame, declared the old way, for comparison
+class EngineFrame : public CanFrame<EngineFrame> {
+public:
+    EngineFrame() : CanFrame("Engine", 0x100) { }
+
+    CanSignal<uint16_t> rpm{16, 0.25f};
+    CanSignal<uint8_t> coolant{8, 1.f, -40.f};
+    CanSignal<uint8_t> gear{4};
+    CanSignal<uint8_t> clutch{1};
+};
+
+class Counter : public IUpdatable {
+public:
+    virtual void update() override {
+        count++;
+    }
+    int count = 0;
+};
+
+static std::unique_ptr<CanTableFrame<4>> engine;
+
+static twai_message_t make_frame(uint32_t id, std::initializer_list<uint8_t> data) {
+    twai_message_t frame = {};
+    frame.identifier = id;
+    frame.data_length_code = data.size();
+    std::copy(data.begin(), data.end(), frame.data);
+    return frame;
+}
+
+void setUp(void) {
+    engine = std::make_unique<CanTableFrame<4>>("Engine", 0x100, ENGINE);
+}
+
+void tearDown(void) {
+    engine.reset();
+}
+
+void test_decode(void) {
+    TEST_ASSERT_EQUAL(4, engine->size());
+    uint8_t data[] = {0x40, 0x1F, 130, 0x13};
+    memcpy(engine->data(), data, sizeof(data));
+    engine->update();
+    TEST_ASSERT_EQUAL_FLOAT(2000.f, (float)(*engine)[RPM]);
+    TEST_ASSERT_EQUAL_FLOAT(90.f, (float)(*engine)[COOLANT]);
+    TEST_ASSERT_EQUAL(3, (*engine)[GEAR].raw());
+    TEST_ASSERT_EQUAL(1, (*engine)[CLUTCH].raw());
+    TEST_ASSERT_EQUAL_STRING("C", (*engine)[COOLANT].info().unit);
+    TEST_ASSERT_EQUAL_PTR(&(*engine)[GEAR], engine->find("gear"));
+    TEST_ASSERT_NULL(engine->find("speed"));
+}
+
+void test_encode(void) {
+    engine->set(RPM, 3000.f);
+    engine->set(COOLANT, -50.f);
+    engine->set(GEAR, 5);
+    engine->set(CLUTCH, 1);
+    uint8_t expected[] = {0xE0, 0x2E, 0, 0x15};
+    TEST_ASSERT_EQUAL_MEMORY(expected, engine->data(), 4);
+
+    // and back
+    engine->update();
+    TEST_ASSERT_EQUAL_FLOAT(3000.f, (float)(*engine)[RPM]);
+    TEST_ASSERT_EQUAL_FLOAT(-40.f, (float)(*engine)[COOLANT]);
+}
+
+void test_subscriptions(void) {
+    Counter rpm, gear;
+    {
+        Subscription rpm_subscription(&rpm), gear_subscription(&gear);
+        (*engine)[RPM].subscribe(rpm_subscription);
+        (*engine)[GEAR].subscribe(gear_subscription);
+
+        uint8_t data[] = {0x40, 0x1F, 0, 0x03};
+        memcpy(engine->data(), data, sizeof(data));
+        engine->update();
+        engine->update();
+        TEST_ASSERT_EQUAL(1, rpm.count);
+        TEST_ASSERT_EQUAL(1, gear.count);
+        TEST_ASSERT_TRUE(engine->has_changed(RPM) == false);
+
+        engine->data()[0] = 0x44;
+        engine->update();
+        TEST_ASSERT_EQUAL(2, rpm.count);
+        TEST_ASSERT_EQUAL(1, gear.count);
+        TEST_ASSERT_TRUE(engine->has_changed(RPM));
+    }
+    // subscriptions unlinked themselves
+    TEST_ASSERT_FALSE((*engine)[RPM].has_subscribers());
+    engine->data()[0] = 0x48;
+    engine->update();
+    TEST_ASSERT_EQUAL(2, rpm.count);
+}
+
+void test_observable(void) {
+    // registers itself with the ObservableManager
+    auto observable = new TObservable<float, CanTableSignal>(&(*engine)[COOLANT]);
+    observable->hasChanged();
+    engine->data()[2] = 100;
+    engine->update();
+    ObservableManager::update();
+    TEST_ASSERT_TRUE(observable->hasChanged());
+    TEST_ASSERT_EQUAL_FLOAT(60.f, observable->get());
+}
+
+void test_bus(void) {
+    auto driver = std::make_shared<SimulatedCanDriver>();
+    CanBus bus("CAN", driver);
+    bus.add(engine->unowned());
+    TEST_ASSERT_TRUE(bus.setup(0));
+    driver->inject(make_frame(0x100, {0x40, 0x1F, 130, 3}));
+    bus.service(1);
+    TEST_ASSERT_EQUAL(1, bus.stats.rx_decoded);
+    TEST_ASSERT_EQUAL_FLOAT(2000.f, (float)(*engine)[RPM]);
+}
+
+void test_ram_report(void) {
+    // the old per-signal cost, not counting heap: name string contents, callback
+    // storage, the 1 byte value allocation and two shared_ptr control blocks
+    size_t old_signal = sizeof(EngineFrame::CanSignal<uint8_t>) + 2 * sizeof(std::shared_ptr<ICanSignal>);
+    size_t new_signal = CanTableFrame<4>::signal_ram;
+    TEST_ASSERT_LESS_THAN(old_signal, new_signal);
+    // subscriber list head, table entry and raw value: 12 bytes on the device
+    TEST_ASSERT_LESS_OR_EQUAL(3 * sizeof(void *), new_signal);
+
+    char buffer[160];
+    snprintf(buffer, sizeof(buffer), "per signal RAM: %zu bytes (was %zu + heap), frame of 4: %zu bytes, table in flash: %zu bytes",
+        new_signal, old_signal, engine->ram(), sizeof(ENGINE));
+    TEST_MESSAGE(buffer);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_decode);
+    RUN_TEST(test_encode);
+    RUN_TEST(test_subscriptions);
+    RUN_TEST(test_observable);
+    RUN_TEST(test_bus);
+    RUN_TEST(test_ram_report);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include <unity.h>
+#include <mb3/can_table.hpp>
+#include <mb3/observable.hpp>
+#include <mb3/derived.hpp>
+
+constexpr CanSignalInfo ENGINE[] = {
+    {"torque", "Nm", 0, 16, 0.1f},
+    {"rpm", "rpm", 16, 16, 0.25f},
+    {"speed", "km/h", 32, 16, 0.01f},
+    {"fuel_flow", "L/h", 48, 16, 0.05f},
+};
+
+enum Engine { TORQUE, RPM, SPEED, FUEL_FLOW };
+
+static std::unique_ptr<CanTableFrame<4>> engine;
+static int computed[4];
+
+// write received raw values, as the bus would
+static void receive(float torque, float rpm, float speed, float flow) {
+    float values[] = {torque, rpm, speed, flow};
+    uint64_t data = 0;
+    for (size_t i = 0; i < 4; i++) {
+        data |= (uint64_t)ENGINE[i].encode(values[i]) << ENGINE[i].start;
+    }
+    memcpy(engine->data(), &data, 8);
+    engine->update();
+}
+
+static float power(float torque, float rpm) {
+    computed[0]++;
+    return torque * rpm / 9549.f;
+}
+
+static float ratio(float rpm, float speed) {
+    computed[1]++;
+    return speed > 0.f ? rpm / speed : 0.f;
+}
+
+static float gear(float ratio) {
+    computed[2]++;
+    // made up gearbox
+    if (ratio <= 0.f)
+        return 0.f;
+    return ratio > 100.f ? 1.f : ratio > 60.f ? 2.f : ratio > 40.f ? 3.f : 4.f;
+}
+
+static float power_per_gear(float power, float gear) {
+    computed[3]++;
+    return gear > 0.f ? power / gear : 0.f;
+}
+
+void setUp(void) {
+    engine.reset(new CanTableFrame<4>("Engine", 0x100, ENGINE));
+    memset(computed, 0, sizeof(computed));
+}
+
+void tearDown(void) {
+    engine.reset();
+}
+
+void test_rank_order(void) {
+    TDerivedSignal p(power, (*engine)[TORQUE], (*engine)[RPM]);
+    TDerivedSignal r(ratio, (*engine)[RPM], (*engine)[SPEED]);
+    TDerivedSignal g(gear, r);
+    TDerivedSignal pg(power_per_gear, p, g);
+    TEST_ASSERT_EQUAL(0, p.rank());
+    TEST_ASSERT_EQUAL(0, r.rank());
+    TEST_ASSERT_EQUAL(1, g.rank());
+    TEST_ASSERT_EQUAL(2, pg.rank());
+    TEST_ASSERT_EQUAL(4, DerivedGraph::size());
+
+    // a late rank 0 node still evaluates before the deeper ones
+    TDerivedSignal economy([](float speed, float flow) { return flow > 0.f ? speed / flow : 0.f; }, (*engine)[SPEED], (*engine)[FUEL_FLOW]);
+    uint8_t last = 0;
+    size_t visited = 0;
+    DerivedGraph::each([&](IDerivedSignal & node) {
+        TEST_ASSERT_TRUE(node.rank() >= last);
+        last = node.rank();
+        visited++;
+    });
+    TEST_ASSERT_EQUAL(5, visited);
+}
+
+void test_incremental(void) {
+    TDerivedSignal p(power, (*engine)[TORQUE], (*engine)[RPM]);
+    TDerivedSignal r(ratio, (*engine)[RPM], (*engine)[SPEED]);
+    TDerivedSignal g(gear, r);
+    TDerivedSignal pg(power_per_gear, p, g);
+
+    // everything is computed once to start with
+    DerivedGraph::update();
+    TEST_ASSERT_EQUAL(1, computed[0]);
+    TEST_ASSERT_EQUAL(1, computed[3]);
+
+    receive(300.f, 3000.f, 40.f, 10.f);
+    DerivedGraph::update();
+    // rpm feeds both branches, the diamond is still computed once
+    TEST_ASSERT_EQUAL(2, computed[0]);
+    TEST_ASSERT_EQUAL(2, computed[1]);
+    TEST_ASSERT_EQUAL(2, computed[2]);
+    TEST_ASSERT_EQUAL(2, computed[3]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 300.f * 3000.f / 9549.f, p.value());
+    TEST_ASSERT_EQUAL_FLOAT(2.f, g.value());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, p.value() / 2.f, pg.value());
+
+    // nothing changed, nothing computed
+    engine->update();
+    DerivedGraph::update();
+    TEST_ASSERT_EQUAL(2, computed[0]);
+    TEST_ASSERT_EQUAL(2, computed[3]);
+
+    // speed only: power is left alone, and the gear doesn't change so neither does the end node
+    receive(300.f, 3000.f, 41.f, 10.f);
+    DerivedGraph::update();
+    TEST_ASSERT_EQUAL(2, computed[0]);
+    TEST_ASSERT_EQUAL(3, computed[1]);
+    TEST_ASSERT_EQUAL(3, computed[2]);
+    TEST_ASSERT_EQUAL(2, computed[3]);
+
+    // torque only
+    receive(350.f, 3000.f, 41.f, 10.f);
+    DerivedGraph::update();
+    TEST_ASSERT_EQUAL(3, computed[0]);
+    TEST_ASSERT_EQUAL(3, computed[1]);
+    TEST_ASSERT_EQUAL(3, computed[3]);
+}
+
+void test_observable(void) {
+    TDerivedSignal p(power, (*engine)[TORQUE], (*engine)[RPM]);
+    TDerivedSignal r(ratio, (*engine)[RPM], (*engine)[SPEED]);
+    TDerivedSignal g(gear, r);
+    TObservable<float, IDerivedSignal> o_gear(&g);
+    TEST_ASSERT_TRUE(o_gear.isNotified());
+    ObservableManager::update();
+    o_gear.hasChanged();
+
+    // three levels deep, visible in the same frame
+    receive(100.f, 5000.f, 40.f, 10.f);
+    ObservableManager::update();
+    TEST_ASSERT_TRUE(o_gear.hasChanged());
+    TEST_ASSERT_EQUAL_FLOAT(1.f, o_gear.get());
+
+    receive(100.f, 5000.f, 41.f, 10.f);
+    ObservableManager::update();
+    TEST_ASSERT_FALSE(o_gear.hasChanged());
+}
+
+void test_unregister(void) {
+    {
+        TDerivedSignal p(power, (*engine)[TORQUE], (*engine)[RPM]);
+        TEST_ASSERT_EQUAL(1, DerivedGraph::size());
+        TEST_ASSERT_TRUE((*engine)[RPM].has_subscribers());
+    }
+    TEST_ASSERT_EQUAL(0, DerivedGraph::size());
+    TEST_ASSERT_FALSE((*engine)[RPM].has_subscribers());
+    receive(1.f, 1.f, 1.f, 1.f);
+    DerivedGraph::update();
+}
+
+void test_recompute_count(void) {
+    // 16 nodes over 4 signals, one signal changing per frame: compare with
+    // recomputing every node on any change
+    auto sum = [](float a, float b) {
+        computed[0]++;
+        return a + b;
+    };
+    std::unique_ptr<IDerivedSignal> nodes[16];
+    for (size_t i = 0; i < 8; i++) {
+        nodes[i].reset(new TDerivedSignal(sum, (*engine)[i % 4], (*engine)[(i + 1) % 4]));
+    }
+    for (size_t i = 8; i < 16; i++) {
+        nodes[i].reset(new TDerivedSignal(sum, *nodes[i - 8], *nodes[(i - 7) % 8]));
+    }
+    DerivedGraph::update();
+    TEST_ASSERT_EQUAL(16, computed[0]);
+    receive(0.f, 1000.f, 50.f, 10.f);
+    DerivedGraph::update();
+    computed[0] = 0;
+    for (int frame = 1; frame <= 100; frame++) {
+        receive(frame, 1000.f, 50.f, 10.f);
+        DerivedGraph::update();
+    }
+    // torque feeds 4 first level nodes, which feed 6 second level ones
+    TEST_ASSERT_EQUAL(100 * 10, computed[0]);
+    char buffer[96];
+    snprintf(buffer, sizeof(buffer), "100 frames: %d recomputes, %d if every node ran", computed[0], 100 * 16);
+    TEST_MESSAGE(buffer);
+    for (int i = 15; i >= 0; i--) {
+        nodes[i].reset();
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_rank_order);
+    RUN_TEST(test_incremental);
+    RUN_TEST(test_observable);
+    RUN_TEST(test_unregister);
+    RUN_TEST(test_recompute_count);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include <unity.h>
+
+// Headless render benchmark, needs LVGL (and the project's lv_conf/config.hpp)
+// in the native environment
+#if __has_include(<lvgl.h>) && __has_include(<config.hpp>)
+
+#include <mb3/digit_readout.hpp>
+
+constexpr int32_t WIDTH = 320;
+constexpr int32_t HEIGHT = 96;
+
+static lv_display_t * display;
+static uint8_t frame[WIDTH * HEIGHT * 2];
+static lv_area_t flushed;
+static uint32_t flushes;
+
+static void flush(lv_display_t * display, const lv_area_t * area, uint8_t * pixels) {
+    if (flushes++ == 0)
+        flushed = *area;
+    else
+        lv_area_join(&flushed, &flushed, area);
+    lv_display_flush_ready(display);
+}
+
+static uint32_t tick() {
+    return esp_timer_get_time() / 1000;
+}
+
+/// @brief Render one frame, returning the flushed width
+static int32_t render() {
+    flushes = 0;
+    lv_refr_now(display);
+    return flushes ? lv_area_get_width(&flushed) : 0;
+}
+
+void setUp(void) {
+    lv_init();
+    lv_tick_set_cb(tick);
+    display = lv_display_create(WIDTH, HEIGHT);
+    lv_display_set_color_format(display, LV_COLOR_FORMAT_RGB565);
+    lv_display_set_buffers(display, frame, nullptr, sizeof(frame), LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_set_flush_cb(display, flush);
+}
+
+void tearDown(void) {
+    lv_display_delete(display);
+    lv_deinit();
+}
+
+void test_atlas_has_coverage(void) {
+    GlyphAtlas atlas(LV_FONT_DEFAULT);
+    const lv_draw_buf_t * eight = atlas.glyph('8');
+    TEST_ASSERT_NOT_NULL(eight);
+    TEST_ASSERT_EQUAL(LV_COLOR_FORMAT_A8, eight->header.cf);
+    uint32_t covered = 0;
+    for (uint32_t y = 0; y < eight->header.h; y++) {
+        for (uint32_t x = 0; x < eight->header.w; x++) {
+            covered += eight->data[eight->header.stride * y + x] > 0x80;
+        }
+    }
+    TEST_ASSERT_TRUE(covered > 0);
+}
+
+void test_invalidates_changed_digits(void) {
+    GlyphAtlas atlas(LV_FONT_DEFAULT, "km/h");
+    float speed = 123.4f;
+    auto readout = new DigitReadout<float>(lv_screen_active(), atlas, "%5.1f km/h", &speed);
+    lv_obj_set_width(readout, WIDTH);
+    render();
+
+    // last digit only
+    speed = 123.5f;
+    readout->update();
+    TEST_ASSERT_LESS_OR_EQUAL(atlas.width('0') + 2, render());
+
+    // the same text, nothing to draw
+    speed = 123.51f;
+    readout->update();
+    TEST_ASSERT_EQUAL(0, render());
+    lv_obj_delete(readout);
+}
+
+void test_render_benchmark(void) {
+    const int changes = 500;
+    float speed = 0.f;
+
+    lv_obj_t * label = lv_label_create(lv_screen_active());
+    lv_obj_set_style_text_font(label, LV_FONT_DEFAULT, 0);
+    auto text = new TextWidget<float>(label, "%5.1f km/h", &speed);
+    render();
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < changes; i++) {
+        speed = i * 0.7f;
+        text->update();
+        render();
+    }
+    int64_t label_us = esp_timer_get_time() - start;
+    delete text;
+    lv_obj_delete(label);
+
+    GlyphAtlas atlas(LV_FONT_DEFAULT, "km/h");
+    auto readout = new DigitReadout<float>(lv_screen_active(), atlas, "%5.1f km/h", &speed);
+    lv_obj_set_width(readout, WIDTH);
+    render();
+    start = esp_timer_get_time();
+    for (int i = 0; i < changes; i++) {
+        speed = i * 0.7f;
+        readout->update();
+        render();
+    }
+    int64_t readout_us = esp_timer_get_time() - start;
+    lv_obj_delete(readout);
+
+    char message[128];
+    snprintf(message, sizeof(message), "%d changes: label %.1f us/frame, glyph atlas %.1f us/frame (atlas %u bytes)",
+        changes, label_us / (double)changes, readout_us / (double)changes, (unsigned)atlas.memory());
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_atlas_has_coverage);
+    RUN_TEST(test_invalidates_changed_digits);
+    RUN_TEST(test_render_benchmark);
+    UNITY_END();
+
+    return 0;
+}
+
+#else
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_render_benchmark(void) {
+    TEST_IGNORE_MESSAGE("LVGL isn't available in this environment");
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_render_benchmark);
+    UNITY_END();
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <mb3/dirty_region.hpp>
+
+constexpr int32_t WIDTH = 800;
+constexpr int32_t HEIGHT = 480;
+
+/// @brief Every pixel of rect is in one of region's rects
+template <size_t N>
+static bool covered(const DirtyRegion<N> & region, const DirtyRect & rect) {
+    for (int32_t y = rect.y1; y <= rect.y2; y++) {
+        for (int32_t x = rect.x1; x <= rect.x2; x++) {
+            bool in = false;
+            for (size_t i = 0; i < region.size() && !in; i++) {
+                in = region[i].contains({x, y, x, y});
+            }
+            if (!in)
+                return false;
+        }
+    }
+    return true;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_merges(void) {
+    DirtyRegion<4> region;
+    region.add({0, 0, 9, 9});
+    // inside, nothing new
+    region.add({2, 2, 5, 5});
+    TEST_ASSERT_EQUAL(1, region.size());
+    TEST_ASSERT_EQUAL(100, region.pixels());
+
+    // overlapping a lot: one rect
+    region.add({5, 0, 14, 9});
+    TEST_ASSERT_EQUAL(1, region.size());
+    TEST_ASSERT_EQUAL(150, region.pixels());
+
+    // far away: kept apart
+    region.add({100, 100, 109, 109});
+    TEST_ASSERT_EQUAL(2, region.size());
+    TEST_ASSERT_EQUAL(250, region.pixels());
+
+    // empty ignored
+    region.add({5, 5, 4, 4});
+    TEST_ASSERT_EQUAL(2, region.size());
+
+    // a rect covering both swallows them
+    region.add({0, 0, 200, 200});
+    TEST_ASSERT_EQUAL(1, region.size());
+    TEST_ASSERT_EQUAL(201 * 201, region.pixels());
+}
+
+void test_cap(void) {
+    DirtyRegion<4> region;
+    std::vector<DirtyRect> added;
+    srand(3);
+    for (int i = 0; i < 40; i++) {
+        int32_t x = rand() % 180, y = rand() % 180;
+        DirtyRect rect = {x, y, x + (rand() % 20), y + (rand() % 20)};
+        region.add(rect);
+        added.push_back(rect);
+        TEST_ASSERT_TRUE(region.size() <= 4);
+    }
+    for (auto & rect : added) {
+        TEST_ASSERT_TRUE(covered(region, rect));
+    }
+    // merging the closest pairs costs far less than the bounding box
+    DirtyRect box = region.bounds();
+    TEST_ASSERT_TRUE(region.pixels() <= box.area());
+}
+
+/// @brief A dashboard frame on an 800x480 canvas: a needle sweeping, two
+/// readouts and a warning light, cleared and invalidated the tracker's way
+/// (last frame's region plus this one's) against the whole canvas
+void test_dashboard_frames(void) {
+    DirtyRegion<8> previous;
+    const int frames = 300;
+    int64_t cleared = 0, invalidated = 0;
+    for (int f = 0; f < frames; f++) {
+        DirtyRegion<8> drawn;
+        // needle from the centre of a 200 px gauge
+        float angle = 0.02f * f;
+        float cx = 200.f, cy = 240.f, tip_x = cx + (90.f * cosf(angle)), tip_y = cy + (90.f * sinf(angle));
+        drawn.add({(int32_t)fminf(cx, tip_x) - 4, (int32_t)fminf(cy, tip_y) - 4, (int32_t)fmaxf(cx, tip_x) + 4, (int32_t)fmaxf(cy, tip_y) + 4});
+        // readouts, a couple of digits each
+        drawn.add({560, 100, 560 + 48, 100 + 40});
+        drawn.add({560, 300, 560 + 32, 300 + 40});
+        if ((f / 30) % 2)
+            drawn.add({700, 20, 740, 60});
+
+        DirtyRegion<8> changed = previous;
+        changed.add(drawn);
+        cleared += previous.pixels();
+        invalidated += changed.pixels();
+        previous = drawn;
+    }
+    double full = (double)WIDTH * HEIGHT * frames;
+    char message[128];
+    snprintf(message, sizeof(message), "cleared %.1f%%, invalidated %.1f%% of the canvas per frame", 100.0 * cleared / full, 100.0 * invalidated / full);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(invalidated < full / 10);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_merges);
+    RUN_TEST(test_cap);
+    RUN_TEST(test_dashboard_frames);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <unity.h>
+
+// Needs LVGL (and the project's lv_conf/config.hpp) in the native environment
+#if __has_include(<lvgl.h>) && __has_include(<config.hpp>)
+
+#include <mb3/lvgl_mb3.hpp>
+
+static lv_display_t * display;
+static uint8_t frame[320 * 40 * 2];
+
+static void flush(lv_display_t * display, const lv_area_t * area, uint8_t * pixels) {
+    lv_display_flush_ready(display);
+}
+
+void setUp(void) {
+    lv_init();
+    display = lv_display_create(320, 240);
+    lv_display_set_buffers(display, frame, nullptr, sizeof(frame), LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_set_flush_cb(display, flush);
+}
+
+void tearDown(void) {
+    DrawBuffers::trim();
+    lv_display_delete(display);
+    lv_deinit();
+}
+
+void test_screens_share_buffers(void) {
+    lv_obj_t * first = lv_obj_create(nullptr);
+    lv_draw_buf_t * a = DrawBuffers::borrow(first, 200, 100, LV_COLOR_FORMAT_RGB565);
+    lv_draw_buf_t * b = DrawBuffers::borrow(first, 64, 64, LV_COLOR_FORMAT_ARGB8888, BufferPlacement::Internal);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+    TEST_ASSERT_EQUAL(200, a->header.w);
+    TEST_ASSERT_EQUAL(LV_COLOR_FORMAT_ARGB8888, b->header.cf);
+    TEST_ASSERT_EQUAL(2, DrawBuffers::allocated());
+    size_t memory = DrawBuffers::memory();
+    memset(a->data, 0xAA, a->data_size);
+
+    // the first screen goes, the second gets the same memory, cleared
+    lv_obj_delete(first);
+    lv_obj_t * second = lv_obj_create(nullptr);
+    lv_draw_buf_t * c = DrawBuffers::borrow(second, 200, 100, LV_COLOR_FORMAT_RGB565);
+    lv_draw_buf_t * d = DrawBuffers::borrow(second, 180, 100, LV_COLOR_FORMAT_RGB565);
+    TEST_ASSERT_EQUAL_PTR(a, c);
+    TEST_ASSERT_EQUAL(0, c->data[0]);
+    TEST_ASSERT_TRUE(d != a);
+    TEST_ASSERT_EQUAL(3, DrawBuffers::allocated());
+
+    DrawBuffers::giveBack(d);
+    lv_draw_buf_t * e = DrawBuffers::borrow(second, 100, 100, LV_COLOR_FORMAT_RGB565);
+    // smaller fits in the returned buffer
+    TEST_ASSERT_EQUAL_PTR(d, e);
+    TEST_ASSERT_EQUAL(100, e->header.w);
+    TEST_ASSERT_EQUAL(3, DrawBuffers::allocated());
+    TEST_ASSERT_TRUE(DrawBuffers::memory() > memory);
+    DrawBuffers::report();
+    lv_obj_delete(second);
+}
+
+void test_one_delete_callback_per_owner(void) {
+    lv_obj_t * screen = lv_obj_create(nullptr);
+    uint32_t events = lv_obj_get_event_count(screen);
+    for (int i = 0; i < 10; i++) {
+        DrawBuffers::giveBack(DrawBuffers::borrow(screen, 32, 32, LV_COLOR_FORMAT_RGB565));
+        TEST_ASSERT_EQUAL(events, lv_obj_get_event_count(screen));
+    }
+    DrawBuffers::borrow(screen, 32, 32, LV_COLOR_FORMAT_RGB565);
+    DrawBuffers::borrow(screen, 16, 16, LV_COLOR_FORMAT_RGB565);
+    TEST_ASSERT_EQUAL(events + 1, lv_obj_get_event_count(screen));
+    DrawBuffers::giveBack(screen);
+    TEST_ASSERT_EQUAL(events, lv_obj_get_event_count(screen));
+    lv_obj_delete(screen);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_screens_share_buffers);
+    RUN_TEST(test_one_delete_callback_per_owner);
+    UNITY_END();
+
+    return 0;
+}
+
+#else
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_screens_share_buffers(void) {
+    TEST_IGNORE_MESSAGE("LVGL isn't available in this environment");
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_screens_share_buffers);
+    UNITY_END();
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,160 @@
+#include <unity.h>
+#include <cmath>
+#include <vector>
+#include <mb3/fixed_point.hpp>
+#include <mb3/observable.hpp>
+#include <mb3/platform.hpp>
+
+using Rpm = FixedConversion<QRatio<1, 2>, std::ratio<0>, 4>;                     // 0.25 rpm/bit
+using Coolant = FixedConversion<std::ratio<1>, std::ratio<-40>, 8, 8>;
+using Pressure = FixedConversion<std::ratio<1, 10>, std::ratio<-1013, 10>, 8>;
+using Third = FixedConversion<std::ratio<1, 3>, std::ratio<0>, 12>;
+using Large = FixedConversion<std::ratio<1000>, std::ratio<0>, 0, 16>;
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+template <typename Conversion>
+void check_conversion(void) {
+    double lsb = 1.0 / (1 << Conversion::value_type::fraction_bits);
+    double worst = 0;
+    for (uint32_t raw = 0; raw <= Conversion::raw_max; raw++) {
+        auto value = Conversion::decode(raw);
+        using Scale = typename Conversion::scale_ratio;
+        using Offset = typename Conversion::offset_ratio;
+        double exact = raw * (double)Scale::num / Scale::den + (double)Offset::num / Offset::den;
+        worst = std::max(worst, std::fabs(value.value * lsb - exact));
+        if (Conversion::encode(value) != raw) {
+            TEST_FAIL_MESSAGE("round trip");
+            return;
+        }
+    }
+    // within one LSB of the exact value
+    TEST_ASSERT_TRUE(worst <= lsb);
+}
+
+void test_decode_encode_exhaustive(void) {
+    check_conversion<Rpm>();
+    check_conversion<Coolant>();
+    check_conversion<Pressure>();
+    check_conversion<Third>();
+    check_conversion<Large>();
+}
+
+void test_known_values(void) {
+    static_assert(Coolant::decode(130) == Coolant::value_type::from_int(90), "constexpr");
+    TEST_ASSERT_EQUAL(90, Coolant::decode(130).round());
+    TEST_ASSERT_EQUAL(-40, Coolant::decode(0).round());
+    TEST_ASSERT_EQUAL_FLOAT(2000.f, Rpm::decode(8000).to_float());
+    TEST_ASSERT_EQUAL(2000000, Large::decode(2000).value);
+    // clamping and nearest
+    TEST_ASSERT_EQUAL(0, Coolant::encode(Coolant::value_type::from_int(-100)));
+    TEST_ASSERT_EQUAL(255, Coolant::encode(Coolant::value_type::from_int(400)));
+    TEST_ASSERT_EQUAL(10133, Pressure::encode(Pressure::value_type::from_int(912)));
+}
+
+void test_format(void) {
+    char buffer[16];
+    TEST_ASSERT_EQUAL(5, fixed_format(buffer, sizeof(buffer), Coolant::decode(130), 2));
+    TEST_ASSERT_EQUAL_STRING("90.00", buffer);
+    fixed_format(buffer, sizeof(buffer), Coolant::decode(5), 1);
+    TEST_ASSERT_EQUAL_STRING("-35.0", buffer);
+    fixed_format(buffer, sizeof(buffer), Pressure::decode(1), 1);
+    TEST_ASSERT_EQUAL_STRING("-101.2", buffer);
+    fixed_format(buffer, sizeof(buffer), Fixed<8>::from_q(-1), 1);
+    TEST_ASSERT_EQUAL_STRING("0.0", buffer);
+    fixed_format(buffer, sizeof(buffer), Rpm::decode(8001), 0);
+    TEST_ASSERT_EQUAL_STRING("2000", buffer);
+    TEST_ASSERT_EQUAL(3, fixed_format(buffer, 4, Large::decode(12), 0));
+    TEST_ASSERT_EQUAL_STRING("120", buffer);
+
+    // agrees with printf away from ties
+    for (uint32_t raw = 0; raw < 20000; raw += 7) {
+        char expected[16];
+        auto value = Pressure::decode(raw);
+        snprintf(expected, sizeof(expected), "%.2f", value.to_float());
+        fixed_format(buffer, sizeof(buffer), value, 2);
+        TEST_ASSERT_EQUAL_STRING(expected, buffer);
+    }
+}
+
+void test_observable(void) {
+    uint16_t raw = 130;
+    auto observable = new TFixedObservable<Coolant, uint16_t>(&raw);
+    observable->hasChanged();
+    raw = 140;
+    observable->update();
+    TEST_ASSERT_TRUE(observable->hasChanged());
+    TEST_ASSERT_EQUAL(100, observable->get().round());
+    char buffer[8];
+    observable->format(buffer, sizeof(buffer), 1);
+    TEST_ASSERT_EQUAL_STRING("100.0", buffer);
+}
+
+void test_throughput(void) {
+    const size_t count = 1 << 16;
+    const size_t rounds = 200;
+    std::vector<uint16_t> raws(count);
+    for (size_t i = 0; i < count; i++) {
+        raws[i] = (i * 2654435761u) >> 16;
+    }
+    // volatile parameters stop the compiler folding the float path into constants
+    volatile float scale_v = 0.1f, offset_v = -101.3f;
+    float scale = scale_v, offset = offset_v;
+
+    std::vector<float> floats(count);
+    auto start = esp_timer_get_time();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < count; i++) {
+            floats[i] = (raws[i] * scale) + offset;
+        }
+    }
+    auto float_time = esp_timer_get_time() - start;
+
+    std::vector<Pressure::value_type> fixed(count);
+    start = esp_timer_get_time();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < count; i++) {
+            fixed[i] = Pressure::decode(raws[i]);
+        }
+    }
+    auto fixed_time = esp_timer_get_time() - start;
+
+    std::vector<uint16_t> encoded(count);
+    start = esp_timer_get_time();
+    for (size_t r = 0; r < rounds / 10; r++) {
+        for (size_t i = 0; i < count; i++) {
+            encoded[i] = std::round((floats[i] - offset) / scale);
+        }
+    }
+    auto float_encode = esp_timer_get_time() - start;
+    start = esp_timer_get_time();
+    for (size_t r = 0; r < rounds / 10; r++) {
+        for (size_t i = 0; i < count; i++) {
+            encoded[i] = Pressure::encode(fixed[i]);
+        }
+    }
+    auto fixed_encode = esp_timer_get_time() - start;
+    TEST_ASSERT_EQUAL_MEMORY(raws.data(), encoded.data(), count * sizeof(uint16_t));
+
+    char buffer[200];
+    double n = count * rounds;
+    snprintf(buffer, sizeof(buffer), "decode: float %.2f ns, fixed %.2f ns; encode: float %.2f ns, fixed %.2f ns (this host has an FPU)",
+        float_time * 1000.0 / n, fixed_time * 1000.0 / n, float_encode * 10000.0 / n, fixed_encode * 10000.0 / n);
+    TEST_MESSAGE(buffer);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_decode_encode_exhaustive);
+    RUN_TEST(test_known_values);
+    RUN_TEST(test_format);
+    RUN_TEST(test_observable);
+    RUN_TEST(test_throughput);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include <unity.h>
+#include <mb3/can_table.hpp>
+#include <mb3/history.hpp>
+
+constexpr CanSignalInfo ENGINE[] = {
+    {"rpm", "rpm", 0, 16, 0.25f},
+};
+
+static int64_t now_us;
+static int64_t fake_clock() {
+    return now_us;
+}
+
+static uint32_t now_ms() {
+    return now_us / 1000;
+}
+
+// 10 Hz for 20 minutes, a sawtooth with a spike every 7 s
+static float value_at(uint32_t ms) {
+    float value = (ms % 60000) / 100.f;
+    return (ms % 7000) == 0 ? value + 1000.f : value;
+}
+
+static void feed(SignalHistory & history, uint32_t minutes) {
+    for (uint32_t i = 0; i < minutes * 600; i++) {
+        now_us += 100000;
+        history.record(value_at(now_ms()));
+    }
+}
+
+void setUp(void) {
+    now_us = 0;
+    SignalHistory::clock = fake_clock;
+}
+
+void tearDown(void) {
+}
+
+void test_ten_minutes(void) {
+    SignalHistory history("rpm");
+    feed(history, 20);
+
+    // 10 minutes at 240 points: one 2.5 s bucket per point, ending just
+    // before a bucket boundary so points and buckets line up
+    HistoryPoint points[240];
+    uint32_t end = now_ms() - 1;
+    TEST_ASSERT_EQUAL(240, history.fetch(10 * 60 * 1000, points, 240, end));
+    TEST_ASSERT_TRUE(history.last_scanned() <= 242);
+
+    uint32_t start = end + 1 - (240 * 2500);
+    for (size_t i = 0; i < 240; i++) {
+        TEST_ASSERT_EQUAL(start + (i * 2500), points[i].time_ms);
+        float min = INFINITY, max = -INFINITY, sum = 0.f;
+        uint32_t count = 0;
+        for (uint32_t ms = points[i].time_ms; ms < points[i].time_ms + 2500; ms += 100) {
+            float value = value_at(ms);
+            min = value < min ? value : min;
+            max = value > max ? value : max;
+            sum += value;
+            count++;
+        }
+        TEST_ASSERT_EQUAL(count, points[i].count);
+        TEST_ASSERT_EQUAL_FLOAT(min, points[i].min);
+        TEST_ASSERT_EQUAL_FLOAT(max, points[i].max);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, sum / count, points[i].mean);
+    }
+
+    // and by default up to now, the latest sample included
+    history.fetch(10 * 60 * 1000, points, 240);
+    TEST_ASSERT_EQUAL_FLOAT(value_at(now_ms()), points[239].max);
+}
+
+void test_cost_follows_points(void) {
+    SignalHistory history("rpm");
+    feed(history, 40);
+    HistoryPoint points[240];
+    // spans the coarsest level (12.5 s buckets) can resolve at 24 points
+    const uint32_t spans[] = {20000, 60000, 300000};
+    for (auto span : spans) {
+        history.fetch(span, points, 24);
+        // at most factor buckets per point, plus the one straddling the start
+        TEST_ASSERT_TRUE(history.last_scanned() <= (24 * 5) + 2);
+        history.fetch(span, points, 240);
+        TEST_ASSERT_TRUE(history.last_scanned() <= (240 * 5) + 2);
+    }
+    // beyond the coarsest level: whatever it still holds
+    TEST_ASSERT_EQUAL(120, history.fetch(3 * 3600 * 1000, points, 120));
+    TEST_ASSERT_EQUAL(0, points[0].count);
+    TEST_ASSERT_TRUE(points[119].count > 0);
+}
+
+void test_raw_samples(void) {
+    SignalHistory history("rpm");
+    feed(history, 1);
+    // 2 s at 40 points is finer than the first level: raw samples
+    HistoryPoint points[40];
+    history.fetch(2000, points, 40);
+    size_t filled = 0;
+    for (auto & point : points) {
+        if (point.count) {
+            filled++;
+            TEST_ASSERT_EQUAL_FLOAT(value_at(point.time_ms - (point.time_ms % 100) + (point.time_ms % 100 ? 100 : 0)), point.min);
+        }
+    }
+    TEST_ASSERT_EQUAL(20, filled);
+}
+
+void test_gaps(void) {
+    SignalHistory history("rpm");
+    feed(history, 1);
+    now_us += 30 * 1000000LL;
+    feed(history, 1);
+    HistoryPoint points[150];
+    history.fetch(150000, points, 150);
+    size_t empty = 0;
+    for (auto & point : points) {
+        empty += point.count == 0;
+    }
+    TEST_ASSERT_INT_WITHIN(1, 30, empty);
+}
+
+void test_memory(void) {
+    HistoryConfig small;
+    small.samples = 64;
+    small.buckets = 60;
+    small.levels = 2;
+    {
+        SignalHistory history("rpm");
+        SignalHistory coolant("coolant", small);
+        TEST_ASSERT_EQUAL(256 * 8 + 4 * 256 * 20, history.memory());
+        TEST_ASSERT_EQUAL(64 * 8 + 2 * 60 * 20, coolant.memory());
+        TEST_ASSERT_EQUAL(2, HistoryStore::size());
+        TEST_ASSERT_EQUAL(history.memory() + coolant.memory(), HistoryStore::memory());
+        HistoryStore::report();
+    }
+    TEST_ASSERT_EQUAL(0, HistoryStore::size());
+}
+
+void test_signal(void) {
+    CanTableFrame<1> engine("Engine", 0x100, ENGINE);
+    TSignalHistory<CanTableSignal> history("rpm", &engine[0]);
+    for (int i = 1; i <= 50; i++) {
+        now_us += 100000;
+        uint16_t raw = ENGINE[0].encode(i * 100.f);
+        engine.data()[0] = raw & 0xFF;
+        engine.data()[1] = raw >> 8;
+        engine.update();
+    }
+    HistoryPoint points[1];
+    history.fetch(5000, points, 1);
+    TEST_ASSERT_EQUAL(50, points[0].count);
+    TEST_ASSERT_EQUAL_FLOAT(100.f, points[0].min);
+    TEST_ASSERT_EQUAL_FLOAT(5000.f, points[0].max);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ten_minutes);
+    RUN_TEST(test_cost_follows_points);
+    RUN_TEST(test_raw_samples);
+    RUN_TEST(test_gaps);
+    RUN_TEST(test_memory);
+    RUN_TEST(test_signal);
+    UNITY_END();
+
+    return 0;
+}
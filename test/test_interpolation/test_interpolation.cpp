@@ -0,0 +1,193 @@
+#include <unity.h>
+#include <mb3/can_table.hpp>
+#include <mb3/interpolation.hpp>
+
+constexpr CanSignalInfo ENGINE[] = {
+    {"rpm", "rpm", 0, 16, 0.25f},
+};
+
+static int64_t now_us;
+static int64_t fake_clock() {
+    return now_us;
+}
+
+static std::unique_ptr<CanTableFrame<1>> engine;
+
+using Interpolated = TInterpolatedObservable<CanTableSignal>;
+
+// write a received frame, as the bus would
+static void receive(float rpm) {
+    uint16_t raw = ENGINE[0].encode(rpm);
+    engine->data()[0] = raw & 0xFF;
+    engine->data()[1] = raw >> 8;
+    engine->update();
+}
+
+// display frames every 10 ms
+static void frames(int count) {
+    for (int i = 0; i < count; i++) {
+        ObservableManager::update();
+        now_us += 10000;
+    }
+}
+
+// CAN frames every 100 ms
+static void run(float rpm) {
+    receive(rpm);
+    frames(10);
+}
+
+void setUp(void) {
+    now_us = 1000000;
+    Interpolated::clock = fake_clock;
+    engine.reset(new CanTableFrame<1>("Engine", 0x100, ENGINE));
+}
+
+void tearDown(void) {
+    engine.reset();
+}
+
+void test_linear(void) {
+    Interpolated rpm(&(*engine)[0]);
+    TEST_ASSERT_TRUE(rpm.isNotified());
+    run(1000.f);
+    run(2000.f);
+    TEST_ASSERT_EQUAL(100000, rpm.interval());
+    // one interval behind, the next sample arrives as it gets there
+    TEST_ASSERT_EQUAL_FLOAT(1900.f, rpm.get());
+
+    // glides over the next interval
+    receive(3000.f);
+    float last = rpm.get();
+    for (int i = 0; i < 10; i++) {
+        ObservableManager::update();
+        TEST_ASSERT_TRUE(rpm.get() >= last);
+        TEST_ASSERT_TRUE(rpm.get() < 3000.f);
+        last = rpm.get();
+        now_us += 10000;
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1.f, 1900.f + (1100.f * 0.9f), rpm.get());
+    // no next sample: it lands on the last one and stops
+    ObservableManager::update();
+    TEST_ASSERT_EQUAL_FLOAT(3000.f, rpm.get());
+    TEST_ASSERT_FALSE(rpm.isAnimating());
+}
+
+void test_idle_not_redrawn(void) {
+    Interpolated rpm(&(*engine)[0]);
+    size_t notified = 0;
+    Subscription redraw([](void * count) { (*(size_t*)count)++; }, &notified);
+    rpm.subscribe(redraw);
+    run(1000.f);
+    run(2000.f);
+    frames(1);
+    size_t moving = notified;
+    TEST_ASSERT_TRUE(moving > 5);
+    // no new samples: nothing moves, nothing is queued
+    frames(100);
+    TEST_ASSERT_EQUAL(moving, notified);
+    TEST_ASSERT_FALSE(rpm.hasChanged() && rpm.isAnimating());
+}
+
+void test_extrapolation_clamped(void) {
+    Interpolated rpm(&(*engine)[0]);
+    rpm.setExtrapolation(0.5f).setRange(0.f, 3200.f);
+    run(1000.f);
+    run(2000.f);
+    run(3000.f);
+    // heading on at 1000 rpm per interval, stopped by the range
+    frames(3);
+    TEST_ASSERT_EQUAL_FLOAT(3200.f, rpm.get());
+    frames(10);
+    TEST_ASSERT_EQUAL_FLOAT(3200.f, rpm.get());
+    TEST_ASSERT_FALSE(rpm.isAnimating());
+}
+
+void test_extrapolation_limit(void) {
+    Interpolated rpm(&(*engine)[0]);
+    rpm.setExtrapolation(0.5f);
+    run(1000.f);
+    run(2000.f);
+    run(3000.f);
+    // half an interval past the last sample, then it holds
+    frames(20);
+    TEST_ASSERT_EQUAL_FLOAT(3500.f, rpm.get());
+    TEST_ASSERT_FALSE(rpm.isAnimating());
+}
+
+void test_damped(void) {
+    Interpolated rpm(&(*engine)[0], Interpolation::Damped);
+    run(1000.f);
+    run(1000.f);
+    receive(1000.25f);
+    receive(1000.f);
+    receive(2000.f);
+    frames(1);
+    TEST_ASSERT_TRUE(rpm.isAnimating());
+    // a step from rest approaches without overshoot, and settles
+    float last = rpm.get();
+    for (int i = 0; i < 100 && rpm.isAnimating(); i++) {
+        ObservableManager::update();
+        TEST_ASSERT_TRUE(rpm.get() >= last);
+        TEST_ASSERT_TRUE(rpm.get() <= 2000.f);
+        last = rpm.get();
+        now_us += 10000;
+    }
+    TEST_ASSERT_FALSE(rpm.isAnimating());
+    TEST_ASSERT_EQUAL_FLOAT(2000.f, rpm.get());
+}
+
+// counts the updates it gets
+class Counted : public Interpolated {
+public:
+    using Interpolated::Interpolated;
+    virtual void update() override {
+        updates++;
+        Interpolated::update();
+    }
+    static inline size_t updates = 0;
+};
+
+void test_cost_follows_animating(void) {
+    constexpr size_t N = 200;
+    std::unique_ptr<CanTableFrame<1>> sources[N];
+    std::unique_ptr<Counted> observables[N];
+    for (size_t i = 0; i < N; i++) {
+        sources[i].reset(new CanTableFrame<1>("Engine", 0x100, ENGINE));
+        observables[i].reset(new Counted(&(*sources[i])[0]));
+    }
+    // two samples 100 ms apart, then time to settle
+    auto step = [&](size_t changing) {
+        Counted::updates = 0;
+        for (int sample = 0; sample < 2; sample++) {
+            for (size_t i = 0; i < changing; i++) {
+                sources[i]->data()[0]++;
+                sources[i]->update();
+            }
+            frames(sample ? 20 : 10);
+        }
+        return Counted::updates;
+    };
+    step(N);
+    step(N);
+    // five glide for at most every frame, the other 195 cost nothing
+    size_t five = step(5);
+    TEST_ASSERT_LESS_OR_EQUAL(5 * 30, five);
+    TEST_ASSERT_EQUAL(0, step(0));
+    for (auto & observable : observables) {
+        observable.reset();
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_linear);
+    RUN_TEST(test_idle_not_redrawn);
+    RUN_TEST(test_extrapolation_clamped);
+    RUN_TEST(test_extrapolation_limit);
+    RUN_TEST(test_damped);
+    RUN_TEST(test_cost_follows_animating);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,243 @@
+#include <unity.h>
+#include <mb3/j1939.hpp>
+
+static std::vector<twai_message_t> sent;
+
+static twai_message_t make_frame(uint8_t priority, uint32_t pgn, uint8_t source, uint8_t destination, std::initializer_list<uint8_t> data) {
+    twai_message_t frame = {};
+    J1939Id id;
+    id.priority = priority;
+    id.pgn = pgn;
+    id.source = source;
+    id.destination = destination;
+    frame.extd = 1;
+    frame.identifier = id.identifier();
+    frame.data_length_code = data.size();
+    std::copy(data.begin(), data.end(), frame.data);
+    return frame;
+}
+
+static void send_transfer(J1939 & j1939, uint8_t control, uint8_t source, uint8_t destination, uint32_t pgn, const std::vector<uint8_t> & payload, int64_t & now) {
+    uint8_t packets = (payload.size() + 6) / 7;
+    j1939.receive(make_frame(7, J1939_PGN_TP_CM, source, destination, {control, (uint8_t)payload.size(), (uint8_t)(payload.size() >> 8), packets, 0xFF,
+        (uint8_t)pgn, (uint8_t)(pgn >> 8), (uint8_t)(pgn >> 16)}), now);
+    for (uint8_t seq = 1; seq <= packets; seq++) {
+        twai_message_t dt = make_frame(7, J1939_PGN_TP_DT, source, destination, {seq, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+        for (size_t i = 0; i < 7 && (seq - 1) * 7 + i < payload.size(); i++) {
+            dt.data[1 + i] = payload[(seq - 1) * 7 + i];
+        }
+        now += 50000;
+        j1939.receive(dt, now);
+    }
+}
+
+void setUp(void) {
+    sent.clear();
+}
+
+void tearDown(void) {
+}
+
+void test_id_parse(void) {
+    // EEC1 from engine #1: 0x0CF00400
+    auto eec1 = J1939Id::parse(0x0CF00400);
+    TEST_ASSERT_EQUAL(3, eec1.priority);
+    TEST_ASSERT_EQUAL_HEX32(0xF004, eec1.pgn);
+    TEST_ASSERT_EQUAL(0x00, eec1.source);
+    TEST_ASSERT_EQUAL(J1939_ADDRESS_GLOBAL, eec1.destination);
+    TEST_ASSERT_EQUAL_HEX32(0x0CF00400, eec1.identifier());
+
+    // request to address 0x17 from 0xF9
+    auto request = J1939Id::parse(0x18EA17F9);
+    TEST_ASSERT_EQUAL_HEX32(J1939_PGN_REQUEST, request.pgn);
+    TEST_ASSERT_EQUAL(0x17, request.destination);
+    TEST_ASSERT_EQUAL(0xF9, request.source);
+    TEST_ASSERT_EQUAL_HEX32(0x18EA17F9, request.identifier());
+}
+
+void test_dispatch_per_source(void) {
+    J1939 j1939;
+    int any = 0, specific = 0;
+    j1939.add(0xF004, [&](const J1939Message &) { any++; });
+    j1939.add(0xF004, [&](const J1939Message &) { specific++; }, 0x17);
+
+    TEST_ASSERT_TRUE(j1939.receive(make_frame(3, 0xF004, 0x00, 0xFF, {1, 2, 3, 4, 5, 6, 7, 8}), 0));
+    TEST_ASSERT_TRUE(j1939.receive(make_frame(3, 0xF004, 0x17, 0xFF, {1, 2, 3, 4, 5, 6, 7, 8}), 0));
+    TEST_ASSERT_FALSE(j1939.receive(make_frame(3, 0xFEF1, 0x00, 0xFF, {1, 2, 3, 4, 5, 6, 7, 8}), 0));
+    TEST_ASSERT_EQUAL(1, any);
+    TEST_ASSERT_EQUAL(1, specific);
+    TEST_ASSERT_EQUAL(1, j1939.unhandled);
+}
+
+void test_bam_reassembly(void) {
+    J1939 j1939;
+    std::vector<uint8_t> received;
+    uint8_t source = 0;
+    j1939.add(0xFEEC, [&](const J1939Message & message) {
+        received.assign(message.data, message.data + message.size);
+        source = message.id.source;
+    });
+
+    std::vector<uint8_t> vin(17);
+    for (size_t i = 0; i < vin.size(); i++)
+        vin[i] = 'A' + i;
+    int64_t now = 0;
+    send_transfer(j1939, J1939_TP_CM_BAM, 0x00, J1939_ADDRESS_GLOBAL, 0xFEEC, vin, now);
+
+    TEST_ASSERT_EQUAL(17, received.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(vin.data(), received.data(), vin.size());
+    TEST_ASSERT_EQUAL(0x00, source);
+    TEST_ASSERT_EQUAL(1, j1939.transport.completed);
+    TEST_ASSERT_EQUAL(0, j1939.transport.active());
+}
+
+void test_bam_timeout(void) {
+    J1939 j1939;
+    j1939.receive(make_frame(7, J1939_PGN_TP_CM, 0x00, 0xFF, {J1939_TP_CM_BAM, 17, 0, 3, 0xFF, 0xEC, 0xFE, 0x00}), 0);
+    TEST_ASSERT_EQUAL(1, j1939.transport.active());
+    j1939.poll(J1939Transport::T1_US + 1);
+    TEST_ASSERT_EQUAL(0, j1939.transport.active());
+    TEST_ASSERT_EQUAL(1, j1939.transport.timeouts);
+}
+
+void test_cmdt_to_us(void) {
+    J1939 j1939(0x28);
+    j1939.transport.transmit = [](const twai_message_t & frame) {
+        sent.push_back(frame);
+        return true;
+    };
+    size_t size = 0;
+    j1939.add(0xFECA, [&](const J1939Message & message) { size = message.size; });
+
+    std::vector<uint8_t> payload(40, 0x5A);
+    int64_t now = 0;
+    send_transfer(j1939, J1939_TP_CM_RTS, 0x00, 0x28, 0xFECA, payload, now);
+
+    TEST_ASSERT_EQUAL(40, size);
+    TEST_ASSERT_EQUAL(2, sent.size());
+    auto cts = J1939Id::parse(sent[0].identifier);
+    TEST_ASSERT_EQUAL_HEX32(J1939_PGN_TP_CM, cts.pgn);
+    TEST_ASSERT_EQUAL(0x28, cts.source);
+    TEST_ASSERT_EQUAL(0x00, cts.destination);
+    TEST_ASSERT_EQUAL(J1939_TP_CM_CTS, sent[0].data[0]);
+    TEST_ASSERT_EQUAL(6, sent[0].data[1]);
+    TEST_ASSERT_EQUAL(1, sent[0].data[2]);
+    TEST_ASSERT_EQUAL(J1939_TP_CM_EOMA, sent[1].data[0]);
+}
+
+void test_cmdt_sequence_error(void) {
+    J1939 j1939;
+    j1939.receive(make_frame(7, J1939_PGN_TP_CM, 0x00, 0x17, {J1939_TP_CM_RTS, 17, 0, 3, 0xFF, 0xEC, 0xFE, 0x00}), 0);
+    j1939.receive(make_frame(7, J1939_PGN_TP_DT, 0x00, 0x17, {2, 0, 0, 0, 0, 0, 0, 0}), 0);
+    TEST_ASSERT_EQUAL(1, j1939.transport.sequence_errors);
+    TEST_ASSERT_EQUAL(0, j1939.transport.active());
+    // passive: never answer transfers that aren't ours
+    TEST_ASSERT_EQUAL(0, sent.size());
+}
+
+void test_cmdt_abort_reasons(void) {
+    J1939 j1939(0x28);
+    j1939.transport.transmit = [](const twai_message_t & frame) {
+        sent.push_back(frame);
+        return true;
+    };
+    // 2000 bytes, more than the transport protocol can carry
+    j1939.receive(make_frame(7, J1939_PGN_TP_CM, 0x00, 0x28, {J1939_TP_CM_RTS, 0xD0, 0x07, 255, 0xFF, 0xCA, 0xFE, 0x00}), 0);
+    // 17 bytes announced in 2 packets
+    j1939.receive(make_frame(7, J1939_PGN_TP_CM, 0x00, 0x28, {J1939_TP_CM_RTS, 17, 0, 2, 0xFF, 0xCA, 0xFE, 0x00}), 0);
+    TEST_ASSERT_EQUAL(2, j1939.transport.malformed);
+    TEST_ASSERT_EQUAL(2, sent.size());
+    TEST_ASSERT_EQUAL(J1939_TP_CM_ABORT, sent[0].data[0]);
+    TEST_ASSERT_EQUAL(J1939_ABORT_SIZE, sent[0].data[1]);
+    TEST_ASSERT_EQUAL(J1939_ABORT_OTHER, sent[1].data[1]);
+    TEST_ASSERT_EQUAL(0xCA, sent[1].data[5]);
+    TEST_ASSERT_EQUAL(0xFE, sent[1].data[6]);
+
+    // packet 2 where 1 is expected
+    sent.clear();
+    j1939.receive(make_frame(7, J1939_PGN_TP_CM, 0x00, 0x28, {J1939_TP_CM_RTS, 17, 0, 3, 0xFF, 0xCA, 0xFE, 0x00}), 0);
+    j1939.receive(make_frame(7, J1939_PGN_TP_DT, 0x00, 0x28, {2, 0, 0, 0, 0, 0, 0, 0}), 0);
+    TEST_ASSERT_EQUAL(2, sent.size());
+    TEST_ASSERT_EQUAL(J1939_TP_CM_CTS, sent[0].data[0]);
+    TEST_ASSERT_EQUAL(J1939_TP_CM_ABORT, sent[1].data[0]);
+    TEST_ASSERT_EQUAL(J1939_ABORT_SEQUENCE, sent[1].data[1]);
+}
+
+void test_address_claim(void) {
+    J1939 j1939;
+    uint64_t high = 0xA000000000000001ULL, low = 0x8000000000000001ULL;
+    auto claim = [&](uint8_t address, uint64_t name) {
+        twai_message_t frame = make_frame(6, J1939_PGN_ADDRESS_CLAIM, address, J1939_ADDRESS_GLOBAL, {0, 0, 0, 0, 0, 0, 0, 0});
+        memcpy(frame.data, &name, 8);
+        j1939.receive(frame, 0);
+    };
+
+    claim(0x80, high);
+    TEST_ASSERT_EQUAL(high, j1939.addresses.name(0x80));
+    // lower NAME wins the contested address
+    claim(0x80, low);
+    TEST_ASSERT_EQUAL(low, j1939.addresses.name(0x80));
+    // loser moves
+    claim(0x81, high);
+    TEST_ASSERT_EQUAL(0x81, j1939.addresses.address(high));
+    TEST_ASSERT_EQUAL(2, j1939.addresses.count());
+    // cannot claim releases
+    claim(J1939_ADDRESS_NULL, high);
+    TEST_ASSERT_FALSE(j1939.addresses.is_claimed(0x81));
+    TEST_ASSERT_EQUAL(1, j1939.addresses.count());
+}
+
+void test_dispatch_benchmark(void) {
+    static const uint32_t pgns[] = {0xF004, 0xF003, 0xFEEE, 0xFEF1, 0xFEF2, 0xFEEF, 0xFEF5, 0xFEF6, 0xF000, 0xFEBF, 0xFE6C, 0xFEFC};
+    const size_t sources = 160;
+    J1939 j1939;
+    uint32_t decoded = 0;
+    for (auto pgn : pgns) {
+        j1939.add(pgn, [&](const J1939Message & message) { decoded += message.data[0]; });
+    }
+    // plus a few per-source decoders to make the index realistic
+    for (size_t source = 0; source < sources; source += 8) {
+        j1939.add(0xFEF1, [&](const J1939Message & message) { decoded += message.data[1]; }, source);
+    }
+
+    std::vector<twai_message_t> traffic;
+    for (size_t source = 0; source < sources; source++) {
+        for (auto pgn : pgns) {
+            traffic.push_back(make_frame(3, pgn, source, 0xFF, {1, 1, 0, 0, 0, 0, 0, 0}));
+        }
+        // and something nobody listens to
+        traffic.push_back(make_frame(6, 0xFF00 | (source & 0xFF), source, 0xFF, {1, 1, 0, 0, 0, 0, 0, 0}));
+    }
+
+    const size_t rounds = 500;
+    auto start = esp_timer_get_time();
+    for (size_t round = 0; round < rounds; round++) {
+        for (auto const & frame : traffic) {
+            j1939.receive(frame, 0);
+        }
+    }
+    auto elapsed = esp_timer_get_time() - start;
+    size_t frames = rounds * traffic.size();
+
+    TEST_ASSERT_EQUAL(rounds * sources * (sizeof(pgns) / sizeof(pgns[0])), decoded);
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "J1939 dispatch: %zu frames from %zu sources in %lld us (%.2f Mframes/s)",
+        frames, sources, (long long)elapsed, elapsed ? frames / (double)elapsed : 0.0);
+    TEST_MESSAGE(buffer);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_id_parse);
+    RUN_TEST(test_dispatch_per_source);
+    RUN_TEST(test_bam_reassembly);
+    RUN_TEST(test_bam_timeout);
+    RUN_TEST(test_cmdt_to_us);
+    RUN_TEST(test_cmdt_sequence_error);
+    RUN_TEST(test_cmdt_abort_reasons);
+    RUN_TEST(test_address_claim);
+    RUN_TEST(test_dispatch_benchmark);
+    UNITY_END();
+
+    return 0;
+}
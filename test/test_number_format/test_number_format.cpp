@@ -0,0 +1,167 @@
+#include <unity.h>
+#include <mb3/number_format.hpp>
+#include <mb3/platform.hpp>
+
+static char expected[64];
+static char actual[64];
+
+template <typename T>
+static void check(const char * format, T value) {
+    NumberFormat number{format};
+    TEST_ASSERT_TRUE(number.supported());
+    int length = snprintf(expected, sizeof(expected), format, value);
+    TEST_ASSERT_EQUAL(length, number.format(actual, sizeof(actual), value));
+    TEST_ASSERT_EQUAL_STRING(expected, actual);
+}
+
+/// @brief value formatted the way printf shows printed, the argument it reads
+template <typename T, typename P>
+static void check_as_printf(const char * format, T value, P printed) {
+    NumberFormat number{format};
+    snprintf(expected, sizeof(expected), format, printed);
+    number.format(actual, sizeof(actual), value);
+    TEST_ASSERT_EQUAL_STRING(expected, actual);
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_integers(void) {
+    check("%d", 0);
+    check("%d", -1);
+    check("%d", 2147483647);
+    check("%d", (int)-2147483648LL);
+    check("%u", 4000000000u);
+    check("%5d", 42);
+    check("%-5d|", 42);
+    check("%05d", -42);
+    check("%+d", 7);
+    check("% d", 7);
+    check("%ld rpm", 6500L);
+    check("Gear %d", 3);
+    check("%d%%", 99);
+}
+
+void test_floats(void) {
+    check("%f", 3.14159f);
+    check("%.0f", 2.5f);
+    check("%.0f", 3.5f);
+    check("%.1f", 0.05f);
+    check("%.2f", 0.125f);
+    check("%.1f", -0.04f);
+    check("%.1f", -0.f);
+    check("%5.1f km/h", 88.25f);
+    check("%-7.2f|", -1.5f);
+    check("%08.3f", -12.3456f);
+    check("%+.1f", 1.25f);
+    check("%.3f", 1e-8f);
+    check("%.1f", 123456789.f);
+    check("%.9f", 0.1f);
+    check("%.1f", 1e-40f);
+}
+
+void test_against_snprintf(void) {
+    // every float the widgets are likely to show, in a handful of formats
+    const char * formats[] = {"%.0f", "%.1f", "%.2f", "%6.3f C", "%f"};
+    uint32_t seed = 1;
+    for (auto format : formats) {
+        NumberFormat number{format};
+        for (int i = 0; i < 20000; i++) {
+            seed = seed * 1664525 + 1013904223;
+            float value = ((int32_t)seed / 2147483648.f) * ((i % 7) == 0 ? 1e6f : (i % 3) == 0 ? 10.f : 1000.f);
+            snprintf(expected, sizeof(expected), format, value);
+            number.format(actual, sizeof(actual), value);
+            if (strcmp(expected, actual) != 0) {
+                char message[160];
+                snprintf(message, sizeof(message), "%s of %.9g: \"%s\" != \"%s\"", format, value, actual, expected);
+                TEST_FAIL_MESSAGE(message);
+            }
+        }
+    }
+    // integers take the signedness of the conversion, as printf reads them
+    check_as_printf("%u", -5, (unsigned)-5);
+    check_as_printf("%+u", 5, 5u);
+    check_as_printf("% u", 5u, 5u);
+    check_as_printf("%d", 3000000000u, (int)3000000000u);
+    check_as_printf("%i", INT32_MIN, INT32_MIN);
+    check_as_printf("%+5d", (int16_t)-300, -300);
+    check_as_printf("%-11u|", UINT32_MAX, UINT32_MAX);
+}
+
+void test_fallback(void) {
+    NumberFormat general{"%g"};
+    TEST_ASSERT_FALSE(general.supported());
+    general.format(actual, sizeof(actual), 0.5f);
+    TEST_ASSERT_EQUAL_STRING("0.5", actual);
+
+    TEST_ASSERT_FALSE(NumberFormat{"%d/%d"}.supported());
+    TEST_ASSERT_FALSE(NumberFormat{"%.3d"}.supported());
+    TEST_ASSERT_FALSE(NumberFormat{"no conversion"}.supported());
+
+    NumberFormat fixed{"%.1f"};
+    fixed.format(actual, sizeof(actual), 1.f / 0.f);
+    TEST_ASSERT_EQUAL_STRING("inf", actual);
+}
+
+void test_truncation(void) {
+    NumberFormat number{"%.2f km/h"};
+    char small[6];
+    bool truncated;
+    TEST_ASSERT_EQUAL(5, number.format(small, sizeof(small), 123.456f, &truncated));
+    TEST_ASSERT_EQUAL_STRING("123.4", small);
+    TEST_ASSERT_TRUE(truncated);
+    number.format(actual, sizeof(actual), 123.456f, &truncated);
+    TEST_ASSERT_FALSE(truncated);
+
+    // exactly full isn't truncated
+    NumberFormat plain{"%d"};
+    plain.format(small, sizeof(small), 12345, &truncated);
+    TEST_ASSERT_FALSE(truncated);
+    NumberFormat general{"%g"};
+    general.format(small, sizeof(small), 0.0625f, &truncated);
+    TEST_ASSERT_TRUE(truncated);
+}
+
+void test_benchmark(void) {
+    const int count = 200000;
+    float values[256];
+    for (int i = 0; i < 256; i++) {
+        values[i] = (i * 7.37f) - 300.f;
+    }
+    NumberFormat number{"%5.1f km/h"};
+    volatile size_t sink = 0;
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < count; i++) {
+        sink = sink + snprintf(actual, sizeof(actual), "%5.1f km/h", values[i & 255]);
+    }
+    int64_t printf_us = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (int i = 0; i < count; i++) {
+        sink = sink + number.format(actual, sizeof(actual), values[i & 255]);
+    }
+    int64_t fast_us = esp_timer_get_time() - start;
+
+    char message[128];
+    snprintf(message, sizeof(message), "\"%%5.1f km/h\": snprintf %.1f ns, NumberFormat %.1f ns",
+        printf_us * 1000.0 / count, fast_us * 1000.0 / count);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(printf_us, fast_us);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_integers);
+    RUN_TEST(test_floats);
+    RUN_TEST(test_against_snprintf);
+    RUN_TEST(test_fallback);
+    RUN_TEST(test_truncation);
+    RUN_TEST(test_benchmark);
+    UNITY_END();
+
+    return 0;
+}
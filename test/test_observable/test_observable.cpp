@@ -0,0 +1,263 @@
+#include <unity.h>
+#include <thread>
+#include <vector>
+#include <mb3/observable.hpp>
+#include <mb3/can_table.hpp>
+
+static CanSignalInfo BYTES[8] = {
+    {"a", nullptr, 0, 8}, {"b", nullptr, 8, 8}, {"c", nullptr, 16, 8}, {"d", nullptr, 24, 8},
+    {"e", nullptr, 32, 8}, {"f", nullptr, 40, 8}, {"g", nullptr, 48, 8}, {"h", nullptr, 56, 8},
+};
+
+class Counter : public IUpdatable {
+public:
+    virtual void update() override {
+        count++;
+    }
+    int count = 0;
+};
+
+// observable that counts its own updates
+class CountingObservable : public TObservable<float, CanTableSignal> {
+public:
+    using TObservable::TObservable;
+    virtual void update() override {
+        updates++;
+        TObservable::update();
+    }
+    int updates = 0;
+};
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+    ObservableManager::update();
+}
+
+void test_only_dirty_are_updated(void) {
+    CanTableFrame<8> frame("Frame", 0x100, BYTES);
+    auto changed = new CountingObservable(&frame[2]);
+    auto unchanged = new CountingObservable(&frame[5]);
+    uint8_t plain = 1;
+    auto polled = new TObservable<uint8_t>(&plain);
+    TEST_ASSERT_TRUE(changed->isNotified());
+    TEST_ASSERT_FALSE(polled->isNotified());
+
+    Counter listener;
+    Subscription subscription(&listener);
+    changed->subscribe(subscription);
+
+    frame.data()[2] = 7;
+    frame.update();
+    frame.update();
+    plain = 2;
+    ObservableManager::update();
+
+    TEST_ASSERT_EQUAL(1, changed->updates);
+    TEST_ASSERT_EQUAL(0, unchanged->updates);
+    TEST_ASSERT_EQUAL_FLOAT(7.f, changed->get());
+    TEST_ASSERT_EQUAL(2, polled->get());
+    TEST_ASSERT_EQUAL(1, listener.count);
+
+    // nothing changed: nothing to do
+    ObservableManager::update();
+    TEST_ASSERT_EQUAL(1, changed->updates);
+    TEST_ASSERT_EQUAL(1, listener.count);
+
+    delete changed;
+    delete unchanged;
+    delete polled;
+}
+
+void test_destroyed_while_queued(void) {
+    CanTableFrame<8> frame("Frame", 0x100, BYTES);
+    auto first = new TObservable<float, CanTableSignal>(&frame[0]);
+    auto second = std::unique_ptr<TObservable<float, CanTableSignal>>(new TObservable<float, CanTableSignal>(&frame[1]));
+
+    frame.data()[0] = 1;
+    frame.data()[1] = 1;
+    frame.update();
+    second.reset();
+    ObservableManager::update();
+    TEST_ASSERT_EQUAL_FLOAT(1.f, first->get());
+    delete first;
+}
+
+void test_registry(void) {
+    size_t before = ObservableManager::size();
+    size_t polled_before = ObservableManager::polledCount();
+    CanTableFrame<8> frame("Frame", 0x100, BYTES);
+    uint8_t plain = 0;
+    {
+        TObservable<float, CanTableSignal> a(&frame[0]);
+        TObservable<uint8_t> b(&plain);
+        TAdjustedObservable<float, CanTableSignal> c(&frame[1], 2.f, 0.f);
+        TEST_ASSERT_EQUAL(before + 3, ObservableManager::size());
+        TEST_ASSERT_EQUAL(polled_before + 1, ObservableManager::polledCount());
+
+        // registration order within each list
+        std::vector<IObservable *> order;
+        ObservableManager::each([&](IObservable & observable) { order.push_back(&observable); });
+        TEST_ASSERT_EQUAL_PTR(&b, order[polled_before]);
+        TEST_ASSERT_EQUAL_PTR(&a, order[order.size() - 2]);
+        TEST_ASSERT_EQUAL_PTR(&c, order[order.size() - 1]);
+
+        // explicit add is harmless
+        ObservableManager::add(&a);
+        TEST_ASSERT_EQUAL(before + 3, ObservableManager::size());
+    }
+    // stack observables unregistered themselves
+    TEST_ASSERT_EQUAL(before, ObservableManager::size());
+    TEST_ASSERT_EQUAL(polled_before, ObservableManager::polledCount());
+    ObservableManager::update();
+}
+
+void test_screen_churn(void) {
+    // build and tear down a "screen" of observables repeatedly: nothing leaks
+    CanTableFrame<8> frame("Frame", 0x100, BYTES);
+    size_t before = ObservableManager::size();
+    for (int screen = 0; screen < 100; screen++) {
+        std::vector<std::unique_ptr<IObservable>> observables;
+        for (size_t i = 0; i < 40; i++) {
+            observables.emplace_back(new TObservable<float, CanTableSignal>(&frame[i % 8]));
+        }
+        frame.data()[screen % 8] = screen + 1;
+        frame.update();
+        if (screen % 2)
+            ObservableManager::update();
+    }
+    TEST_ASSERT_EQUAL(before, ObservableManager::size());
+    TEST_ASSERT_FALSE(frame[0].has_subscribers());
+    ObservableManager::update();
+}
+
+void test_concurrent_producers(void) {
+    const size_t frames = 16;
+    std::vector<std::unique_ptr<CanTableFrame<8>>> tables;
+    std::vector<CountingObservable *> observables;
+    for (size_t i = 0; i < frames; i++) {
+        tables.emplace_back(new CanTableFrame<8>("Frame", 0x100 + i, BYTES));
+        for (size_t s = 0; s < 8; s++) {
+            observables.push_back(new CountingObservable(&(*tables.back())[s]));
+        }
+    }
+
+    std::atomic<bool> done{false};
+    auto produce = [&](size_t first, size_t last) {
+        for (uint32_t round = 1; round <= 20000; round++) {
+            for (size_t i = first; i < last; i++) {
+                uint64_t payload = (round & 0xFF) * 0x0101010101010101ULL;
+                memcpy(tables[i]->data(), &payload, 8);
+                tables[i]->update();
+            }
+        }
+    };
+    std::thread consumer([&]() {
+        while (!done.load()) {
+            ObservableManager::update();
+        }
+        ObservableManager::update();
+    });
+    std::thread a(produce, 0, frames / 2), b(produce, frames / 2, frames);
+    a.join();
+    b.join();
+    done = true;
+    consumer.join();
+
+    // whatever was coalesced, every observable ends on the last value
+    for (auto observable : observables) {
+        TEST_ASSERT_EQUAL_FLOAT((float)(20000 & 0xFF), observable->get());
+        delete observable;
+    }
+}
+
+void test_destroy_while_producing(void) {
+    CanTableFrame<8> table("Frame", 0x100, BYTES);
+    std::atomic<bool> done{false};
+    std::thread producer([&]() {
+        for (uint32_t round = 1; !done.load(); round++) {
+            uint64_t payload = (round & 0xFF) * 0x0101010101010101ULL;
+            memcpy(table.data(), &payload, 8);
+            table.update();
+        }
+    });
+    // screens come and go on the UI task while the bus keeps notifying
+    for (int screen = 0; screen < 2000; screen++) {
+        std::vector<std::unique_ptr<CountingObservable>> observables;
+        for (size_t s = 0; s < 8; s++) {
+            observables.emplace_back(new CountingObservable(&table[s]));
+        }
+        ObservableManager::update();
+    }
+    done = true;
+    producer.join();
+    ObservableManager::update();
+    TEST_ASSERT_EQUAL(0, ObservableManager::size());
+}
+
+void test_update_benchmark(void) {
+    const size_t frames = 50;
+    std::vector<std::unique_ptr<CanTableFrame<8>>> tables;
+    std::vector<IObservable *> observables;
+    for (size_t i = 0; i < frames; i++) {
+        tables.emplace_back(new CanTableFrame<8>("Frame", 0x100 + i, BYTES));
+        for (size_t s = 0; s < 8; s++) {
+            observables.push_back(new TObservable<float, CanTableSignal>(&(*tables.back())[s]));
+        }
+    }
+    ObservableManager::update();
+
+    // ~30 signal changes per UI frame: 4 frames, most of their bytes
+    const size_t rounds = 20000;
+    auto change = [&](size_t round) {
+        for (size_t f = 0; f < 4; f++) {
+            auto & table = *tables[(round * 4 + f) % frames];
+            uint64_t payload = ((round + 1) & 0xFF) * 0x0001010101010101ULL;
+            memcpy(table.data(), &payload, 8);
+            table.update();
+        }
+    };
+
+    // time only the UI side, the CAN side is the same for both
+    int64_t polling = 0, dirty = 0;
+    for (size_t round = 0; round < rounds; round++) {
+        change(round);
+        auto start = esp_timer_get_time();
+        for (auto observable : observables) {
+            observable->update();
+        }
+        polling += esp_timer_get_time() - start;
+    }
+    ObservableManager::update();
+
+    for (size_t round = 0; round < rounds; round++) {
+        change(round);
+        auto start = esp_timer_get_time();
+        ObservableManager::update();
+        dirty += esp_timer_get_time() - start;
+    }
+
+    char buffer[160];
+    snprintf(buffer, sizeof(buffer), "%zu observables, ~28 changes per frame: polling %.2f us/frame, dirty list %.2f us/frame",
+        observables.size(), polling / (double)rounds, dirty / (double)rounds);
+    TEST_MESSAGE(buffer);
+    TEST_ASSERT_LESS_THAN(polling, dirty);
+    for (auto observable : observables) {
+        delete observable;
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_only_dirty_are_updated);
+    RUN_TEST(test_destroyed_while_queued);
+    RUN_TEST(test_registry);
+    RUN_TEST(test_screen_churn);
+    RUN_TEST(test_concurrent_producers);
+    RUN_TEST(test_destroy_while_producing);
+    RUN_TEST(test_update_benchmark);
+    UNITY_END();
+
+    return 0;
+}
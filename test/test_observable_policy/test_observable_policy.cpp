@@ -0,0 +1,168 @@
+#include <unity.h>
+#include <mb3/observable.hpp>
+#include <mb3/can_table.hpp>
+
+static int64_t now_us = 0;
+static int64_t fake_clock() {
+    return now_us;
+}
+
+constexpr CanSignalInfo SENSORS[] = {
+    {"coolant", "C", 0, 16, 0.1f, -40.f},
+};
+
+static float value;
+static std::unique_ptr<TObservable<float>> observable;
+static ObservablePolicy policy;
+
+// write a received coolant frame, as the bus would
+static void receive(CanTableFrame<1> & frame, float celsius) {
+    uint16_t raw = SENSORS[0].encode(celsius);
+    frame.data()[0] = raw & 0xFF;
+    frame.data()[1] = raw >> 8;
+    frame.update();
+}
+
+// feed one value, return whether it was shown
+static bool feed(float v) {
+    value = v;
+    observable->update();
+    return observable->hasChanged();
+}
+
+void setUp(void) {
+    now_us = 0;
+    ObservablePolicy::clock = fake_clock;
+    value = 0.f;
+    observable.reset(new TObservable<float>(&value));
+    policy = ObservablePolicy();
+}
+
+void tearDown(void) {
+    observable.reset();
+}
+
+void test_deadband(void) {
+    observable->setPolicy(policy.withDeadband(0.5f));
+    TEST_ASSERT_TRUE(feed(90.f));
+    TEST_ASSERT_FALSE(feed(90.3f));
+    TEST_ASSERT_FALSE(feed(89.6f));
+    // drift accumulates against the shown value
+    TEST_ASSERT_TRUE(feed(90.6f));
+    TEST_ASSERT_EQUAL_FLOAT(90.6f, observable->get());
+}
+
+void test_relative_deadband(void) {
+    observable->setPolicy(policy.withRelativeDeadband(0.01f));
+    TEST_ASSERT_TRUE(feed(2000.f));
+    TEST_ASSERT_FALSE(feed(2015.f));
+    TEST_ASSERT_TRUE(feed(2025.f));
+    TEST_ASSERT_TRUE(feed(10.f));
+    TEST_ASSERT_FALSE(feed(10.05f));
+}
+
+void test_hysteresis(void) {
+    observable->setPolicy(policy.withHysteresis(1.f));
+    TEST_ASSERT_TRUE(feed(10.f));
+    TEST_ASSERT_TRUE(feed(10.5f));      // rising
+    TEST_ASSERT_TRUE(feed(10.8f));
+    TEST_ASSERT_FALSE(feed(10.2f));     // small reversal
+    TEST_ASSERT_TRUE(feed(9.5f));       // large reversal
+    TEST_ASSERT_TRUE(feed(9.2f));       // falling continues freely
+}
+
+void test_min_interval_requeues(void) {
+    CanTableFrame<1> frame("Sensors", 0x100, SENSORS);
+    TObservable<float, CanTableSignal> coolant(&frame[0]);
+    coolant.setPolicy(policy.withMinInterval(100000));
+    auto set = [&](float celsius) {
+        receive(frame, celsius);
+    };
+
+    set(80.f);
+    ObservableManager::update();
+    TEST_ASSERT_TRUE(coolant.hasChanged());
+
+    now_us = 10000;
+    set(81.f);
+    ObservableManager::update();
+    TEST_ASSERT_FALSE(coolant.hasChanged());
+    TEST_ASSERT_EQUAL_FLOAT(80.f, coolant.get());
+
+    // no new CAN data, but the suppressed value was re-queued
+    now_us = 60000;
+    ObservableManager::update();
+    TEST_ASSERT_FALSE(coolant.hasChanged());
+    now_us = 110000;
+    ObservableManager::update();
+    TEST_ASSERT_TRUE(coolant.hasChanged());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 81.f, coolant.get());
+
+    // and it stops once shown
+    now_us = 300000;
+    ObservableManager::update();
+    TEST_ASSERT_FALSE(coolant.hasChanged());
+}
+
+void test_smoothing_settles(void) {
+    CanTableFrame<1> frame("Sensors", 0x100, SENSORS);
+    TObservable<float, CanTableSignal> coolant(&frame[0]);
+    coolant.setPolicy(policy.withSmoothing(0.5f).withDeadband(0.2f));
+    receive(frame, 80.f);
+    ObservableManager::update();
+    receive(frame, 90.f);
+
+    // a single step keeps converging over the following frames, then stops exactly on it
+    int frames = 0;
+    for (; frames < 100; frames++) {
+        ObservableManager::update();
+        coolant.hasChanged();
+        if (coolant.get() == 90.f)
+            break;
+    }
+    TEST_ASSERT_LESS_THAN(20, frames);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 90.f, coolant.get());
+    ObservableManager::update();
+    TEST_ASSERT_FALSE(coolant.hasChanged());
+}
+
+void test_noisy_signal(void) {
+    // 0.1 C resolution coolant with +-0.2 C of noise, at 100 Hz for 10 s
+    auto run = [&](ObservablePolicy * policy) {
+        CanTableFrame<1> frame("Sensors", 0x100, SENSORS);
+        TObservable<float, CanTableSignal> coolant(&frame[0]);
+        if (policy)
+            coolant.setPolicy(*policy);
+        uint32_t noise = 12345, redraws = 0;
+        for (int sample = 0; sample < 1000; sample++) {
+            now_us = sample * 10000LL;
+            noise = noise * 1103515245 + 12345;
+            float celsius = 85.f + sample * 0.005f + (int)((noise >> 16) % 5 - 2) * 0.1f;
+            receive(frame, celsius);
+            ObservableManager::update();
+            redraws += coolant.hasChanged();
+        }
+        return redraws;
+    };
+    uint32_t unfiltered = run(nullptr);
+    ObservablePolicy filtered = ObservablePolicy().withDeadband(0.3f).withHysteresis(0.5f).withMinInterval(250000);
+    uint32_t with_policy = run(&filtered);
+    TEST_ASSERT_LESS_THAN(unfiltered / 10, with_policy);
+
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "noisy coolant, 1000 samples: %u redraws unfiltered, %u with deadband+hysteresis+rate cap", unfiltered, with_policy);
+    TEST_MESSAGE(buffer);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_deadband);
+    RUN_TEST(test_relative_deadband);
+    RUN_TEST(test_hysteresis);
+    RUN_TEST(test_min_interval_requeues);
+    RUN_TEST(test_smoothing_settles);
+    RUN_TEST(test_noisy_signal);
+    UNITY_END();
+
+    return 0;
+}
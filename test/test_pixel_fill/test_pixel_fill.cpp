@@ -0,0 +1,128 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <mb3/platform.hpp>
+#include <mb3/pixel_fill.hpp>
+
+constexpr int32_t WIDTH = 800;
+constexpr int32_t HEIGHT = 480;
+
+/// @brief Pixel by pixel, to check against
+static void reference_fill(uint8_t * data, uint32_t stride, int32_t x, int32_t y, int32_t w, int32_t h, uint8_t bpp, uint32_t pixel) {
+    for (int32_t j = y; j < y + h; j++) {
+        uint8_t * row = data + (j * stride);
+        for (int32_t i = x; i < x + w; i++) {
+            if (bpp < 8) {
+                uint32_t bit = i * bpp;
+                uint8_t shift = 8 - bpp - (bit % 8);
+                uint8_t mask = ((1u << bpp) - 1) << shift;
+                row[bit / 8] = (row[bit / 8] & ~mask) | ((pixel << shift) & mask);
+            } else {
+                for (uint8_t b = 0; b < bpp / 8; b++) {
+                    row[(i * (bpp / 8)) + b] = pixel >> (8 * b);
+                }
+            }
+        }
+    }
+}
+
+static uint32_t stride_for(int32_t width, uint8_t bpp) {
+    return (((width * bpp) + 7) / 8 + 63) & ~63u;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_matches_reference(void) {
+    const uint8_t depths[] = {1, 2, 4, 8, 16, 24, 32};
+    const uint32_t pixels[] = {0, 0xFFFFFFFF, 0x12345678, 0x00F800, 0x5};
+    srand(1);
+    for (uint8_t bpp : depths) {
+        uint32_t stride = stride_for(61, bpp);
+        std::vector<uint8_t> expected(stride * 17 + 8), actual(stride * 17 + 8);
+        for (uint32_t pixel : pixels) {
+            for (int n = 0; n < 50; n++) {
+                for (size_t i = 0; i < expected.size(); i++) {
+                    expected[i] = actual[i] = rand();
+                }
+                int32_t x = rand() % 61, y = rand() % 17;
+                int32_t w = 1 + (rand() % (61 - x)), h = 1 + (rand() % (17 - y));
+                uint32_t value = bpp == 32 ? pixel : pixel & ((1ull << bpp) - 1);
+                // every start alignment, through an offset base
+                size_t base = n % 8;
+                reference_fill(expected.data() + base, stride, x, y, w, h, bpp, value);
+                fillPixels(actual.data() + base, stride, x, y, w, h, bpp, value);
+                char message[64];
+                snprintf(message, sizeof(message), "%u bpp, %dx%d at %d,%d", bpp, w, h, x, y);
+                TEST_ASSERT_EQUAL_MEMORY_MESSAGE(expected.data(), actual.data(), expected.size(), message);
+            }
+        }
+    }
+}
+
+void test_full_buffer(void) {
+    uint32_t stride = WIDTH * 2;
+    std::vector<uint8_t> buffer(stride * 4, 0xAA);
+    fillPixels(buffer.data(), stride, 0, 1, WIDTH, 2, 16, 0);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        uint8_t expected = (i >= stride && i < stride * 3) ? 0 : 0xAA;
+        if (buffer[i] != expected)
+            TEST_FAIL_MESSAGE("rows outside the area touched");
+    }
+}
+
+struct Format {
+    const char * name;
+    uint8_t bpp;
+    uint32_t pixel;
+};
+
+/// @brief GB/s filling a full screen and a tenth of one, per format, zero and non-zero
+void test_benchmark(void) {
+    const Format formats[] = {
+        {"I1", 1, 1},
+        {"A4", 4, 0xF},
+        {"L8/A8", 8, 0x7F},
+        {"RGB565", 16, 0xF81F},
+        {"AL88", 16, 0xFF40},
+        {"RGB888", 24, 0x102030},
+        {"ARGB8888", 32, 0x80102030},
+    };
+    const int rounds = 20;
+    for (auto & format : formats) {
+        uint32_t stride = stride_for(WIDTH, format.bpp);
+        std::vector<uint8_t> buffer(stride * HEIGHT);
+        double rates[3];
+        const uint32_t pixels[] = {0, format.pixel, format.pixel};
+        for (int k = 0; k < 3; k++) {
+            // a full clear, a full fill, and a region at an odd x
+            int32_t x = k == 2 ? 37 : 0, y = k == 2 ? 100 : 0;
+            int32_t w = k == 2 ? 253 : WIDTH, h = k == 2 ? 152 : HEIGHT;
+            int64_t start = esp_timer_get_time();
+            for (int r = 0; r < rounds; r++) {
+                fillPixels(buffer.data(), stride, x, y, w, h, format.bpp, pixels[k]);
+            }
+            int64_t elapsed = esp_timer_get_time() - start;
+            double bytes = (double)w * h * format.bpp / 8 * rounds;
+            rates[k] = elapsed ? bytes / (elapsed * 1000.0) : 0.0;
+        }
+        char message[160];
+        snprintf(message, sizeof(message), "%-8s clear %.2f GB/s, fill %.2f GB/s, 253x152 region %.2f GB/s (byte %u)",
+            format.name, rates[0], rates[1], rates[2], buffer[stride * 200 + 100]);
+        TEST_MESSAGE(message);
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_reference);
+    RUN_TEST(test_full_buffer);
+    RUN_TEST(test_benchmark);
+    UNITY_END();
+
+    return 0;
+}
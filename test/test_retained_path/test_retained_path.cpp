@@ -0,0 +1,170 @@
+#include <unity.h>
+
+// Headless render benchmark, needs LVGL (and the project's lv_conf/config.hpp)
+// in the native environment
+#if __has_include(<lvgl.h>) && __has_include(<config.hpp>)
+
+#include <mb3/retained_path.hpp>
+
+constexpr int32_t WIDTH = 320;
+constexpr int32_t HEIGHT = 240;
+constexpr int BEZELS = 12;
+
+static lv_display_t * display;
+static uint8_t frame[WIDTH * HEIGHT * 2];
+static lv_obj_t * canvas;
+
+LV_DRAW_BUF_DEFINE_STATIC(canvas_buf, WIDTH, HEIGHT, LV_COLOR_FORMAT_ARGB8888);
+
+static void flush(lv_display_t * display, const lv_area_t * area, uint8_t * pixels) {
+    lv_display_flush_ready(display);
+}
+
+static uint32_t tick() {
+    return esp_timer_get_time() / 1000;
+}
+
+/// @brief A gauge bezel: rounded rectangle outline
+static Shape & bezel(Shape && shape) {
+    return shape.start(10, 0).line(60).round(10).line(40).round(10).line(60).round(10).line(40).round(10)
+        .stroke(2, lv_color_hex(0x808080));
+}
+
+static int64_t time_frames(int frames, void (*body)(lv_layer_t * layer, int i)) {
+    int64_t start = esp_timer_get_time();
+    for (int f = 0; f < frames; f++) {
+        clearCanvas(canvas);
+        CanvasLayer layer(canvas);
+        for (int i = 0; i < BEZELS; i++) {
+            body(layer, i);
+        }
+    }
+    return esp_timer_get_time() - start;
+}
+
+static RetainedPath * retained;
+
+void setUp(void) {
+    lv_init();
+    lv_tick_set_cb(tick);
+    display = lv_display_create(WIDTH, HEIGHT);
+    lv_display_set_color_format(display, LV_COLOR_FORMAT_RGB565);
+    lv_display_set_buffers(display, frame, nullptr, sizeof(frame), LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_set_flush_cb(display, flush);
+    LV_DRAW_BUF_INIT_STATIC(canvas_buf);
+    canvas = lv_canvas_create(lv_screen_active());
+    lv_canvas_set_draw_buf(canvas, &canvas_buf);
+}
+
+void tearDown(void) {
+    lv_obj_delete(canvas);
+    lv_display_delete(display);
+    lv_deinit();
+}
+
+void test_draws_like_rebuilt(void) {
+    RetainedPath path;
+    bezel(path.record()).finish();
+    lv_area_t area;
+    TEST_ASSERT_TRUE(path.bounds(area));
+    // 80 x 60 outline from (10, 0), plus the stroke
+    TEST_ASSERT_TRUE(area.x1 <= 0 && area.y1 <= 0);
+    TEST_ASSERT_TRUE(area.x2 >= 80 && area.y2 >= 60);
+
+    path.cache();
+    TEST_ASSERT_TRUE(path.isCached());
+    // single color: recolored at blit time, kept
+    path.setStrokeColor(lv_color_hex(0xFF0000));
+    TEST_ASSERT_TRUE(path.isCached());
+    size_t coverage = path.memory();
+    // two colors need ARGB, re-rasterised
+    path.setFillColor(lv_color_hex(0x00FF00));
+    TEST_ASSERT_TRUE(path.isCached());
+    TEST_ASSERT_TRUE(path.memory() > coverage * 3);
+}
+
+/// @brief The pixel on the top edge of a bezel drawn at (0, 10)
+static lv_color32_t top_edge(RetainedPath & path) {
+    clearCanvas(canvas);
+    {
+        CanvasLayer layer(canvas);
+        path.draw(layer, 0.f, 10.f);
+    }
+    return lv_canvas_get_px(canvas, 40, 10);
+}
+
+void test_cached_opacity(void) {
+    RetainedPath drawn;
+    bezel(drawn.record()).finish();
+    drawn.setStrokeColor(lv_color_hex(0xFF0000), LV_OPA_50);
+    lv_color32_t expected = top_edge(drawn);
+
+    RetainedPath path;
+    bezel(path.record()).finish();
+    path.cache();
+    // coverage is kept and faded at blit time
+    path.setStrokeColor(lv_color_hex(0xFF0000), LV_OPA_50);
+    TEST_ASSERT_TRUE(path.isCached());
+    lv_color32_t blitted = top_edge(path);
+    TEST_ASSERT_TRUE(expected.alpha > 0 && expected.alpha < 255);
+    TEST_ASSERT_INT_WITHIN(8, expected.alpha, blitted.alpha);
+    TEST_ASSERT_INT_WITHIN(8, expected.red, blitted.red);
+}
+
+void test_render_benchmark(void) {
+    const int frames = 200;
+    int64_t rebuilt_us = time_frames(frames, [](lv_layer_t * layer, int i) {
+        bezel(Shape(layer)).finish();
+    });
+
+    retained = new RetainedPath();
+    bezel(retained->record()).finish();
+    int64_t retained_us = time_frames(frames, [](lv_layer_t * layer, int i) {
+        retained->draw(layer, (i % 4) * 80.f, (i / 4) * 80.f);
+    });
+
+    retained->cache();
+    int64_t cached_us = time_frames(frames, [](lv_layer_t * layer, int i) {
+        retained->draw(layer, (i % 4) * 80.f, (i / 4) * 80.f);
+    });
+    size_t memory = retained->memory();
+    delete retained;
+
+    char message[192];
+    snprintf(message, sizeof(message), "%d bezels: rebuilt %.1f us/frame, retained %.1f us/frame, cached %.1f us/frame (%u bytes)",
+        BEZELS, rebuilt_us / (double)frames, retained_us / (double)frames, cached_us / (double)frames, (unsigned)memory);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(cached_us < rebuilt_us);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_draws_like_rebuilt);
+    RUN_TEST(test_cached_opacity);
+    RUN_TEST(test_render_benchmark);
+    UNITY_END();
+
+    return 0;
+}
+
+#else
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_render_benchmark(void) {
+    TEST_IGNORE_MESSAGE("LVGL isn't available in this environment");
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_render_benchmark);
+    UNITY_END();
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,153 @@
+#include <unity.h>
+
+// Swipe soak test, needs LVGL (and the project's lv_conf/config.hpp) in the
+// native environment. Arenas are only used with MB3_SCREEN_ARENA and
+// -Wl,--wrap=lv_free_core (env:native's build_flags), otherwise this
+// measures the lv_malloc baseline.
+#if __has_include(<lvgl.h>) && __has_include(<config.hpp>)
+
+#include <stdio.h>
+#include <mb3/widget.hpp>
+
+constexpr int SWIPES = 1000;
+constexpr int WIDGETS = 40;
+
+static lv_display_t * display;
+static uint8_t frame[320 * 40 * 2];
+
+class Tile : public Widget<Tile> {
+public:
+    Tile(lv_obj_t * parent, int i) : Widget(parent) {
+        lv_obj_set_size(this, 20 + (i % 5) * 4, 20);
+        // a label per tile, so the LVGL heap sees mixed sizes
+        label = lv_label_create(this);
+        lv_label_set_text_fmt(label, "%d", i);
+    }
+
+    lv_obj_t * label;
+    uint8_t state[(WIDGETS % 7) * 8];
+};
+
+static void flush(lv_display_t * display, const lv_area_t * area, uint8_t * pixels) {
+    lv_display_flush_ready(display);
+}
+
+static uint32_t tick() {
+    return esp_timer_get_time() / 1000;
+}
+
+static lv_obj_t * build_screen(int swipe, bool arena) {
+    lv_obj_t * screen = lv_obj_create(nullptr);
+    lv_obj_set_flex_flow(screen, LV_FLEX_FLOW_ROW_WRAP);
+    if (arena) {
+        ScreenArena::Scope scope(screen);
+        for (int i = 0; i < WIDGETS - swipe % 3; i++) {
+            new Tile(screen, i);
+        }
+    }
+    else {
+        for (int i = 0; i < WIDGETS - swipe % 3; i++) {
+            new Tile(screen, i);
+        }
+    }
+    return screen;
+}
+
+/// @brief Swipe between screens built from scratch, then report the heap
+static void soak(bool arena) {
+    lv_mem_monitor_t before, after;
+    lv_mem_monitor(&before);
+    uint32_t allocations = ScreenArena::allocations();
+    // something long lived among the churn, like a status bar
+    lv_obj_t * keep = nullptr;
+    for (int s = 0; s < SWIPES; s++) {
+        lv_obj_t * old = lv_screen_active();
+        lv_screen_load(build_screen(s, arena));
+        if (s % 100 == 50) {
+            if (keep)
+                lv_obj_delete(keep);
+            keep = lv_label_create(lv_layer_top());
+            lv_label_set_text_fmt(keep, "swipe %d", s);
+        }
+        lv_obj_delete(old);
+        lv_refr_now(display);
+        lv_timer_handler();
+    }
+    if (keep)
+        lv_obj_delete(keep);
+    lv_timer_handler();
+    lv_mem_monitor(&after);
+
+    char message[200];
+    snprintf(message, sizeof(message), "%s: %d swipes, %u widgets from arenas, LVGL heap fragmentation %u%% -> %u%%, biggest free %u -> %u bytes",
+        arena ? "screen arena" : "lv_malloc", SWIPES, (unsigned)(ScreenArena::allocations() - allocations),
+        (unsigned)before.frag_pct, (unsigned)after.frag_pct, (unsigned)before.free_biggest_size, (unsigned)after.free_biggest_size);
+    TEST_MESSAGE(message);
+    ScreenArena::report();
+}
+
+void setUp(void) {
+    lv_init();
+    lv_tick_set_cb(tick);
+    display = lv_display_create(320, 240);
+    lv_display_set_buffers(display, frame, nullptr, sizeof(frame), LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_set_flush_cb(display, flush);
+}
+
+void tearDown(void) {
+    lv_display_delete(display);
+    lv_deinit();
+}
+
+void test_arena_released_with_screen(void) {
+    lv_obj_t * screen = build_screen(0, true);
+    if (!ScreenArena::allocations())
+        TEST_IGNORE_MESSAGE("not linked with -Wl,--wrap=lv_free_core");
+    TEST_ASSERT_TRUE(ScreenArena::owns(lv_obj_get_child(screen, 0)));
+    TEST_ASSERT_TRUE(ScreenArena::memory() > 0);
+    uint32_t releases = ScreenArena::releases();
+    lv_obj_delete(screen);
+    lv_timer_handler();
+    TEST_ASSERT_EQUAL(releases + 1, ScreenArena::releases());
+    TEST_ASSERT_EQUAL(0, ScreenArena::memory());
+}
+
+void test_soak_lv_malloc(void) {
+    soak(false);
+}
+
+void test_soak_screen_arena(void) {
+    soak(true);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_arena_released_with_screen);
+    RUN_TEST(test_soak_lv_malloc);
+    RUN_TEST(test_soak_screen_arena);
+    UNITY_END();
+
+    return 0;
+}
+
+#else
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_soak_screen_arena(void) {
+    TEST_IGNORE_MESSAGE("LVGL isn't available in this environment");
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_soak_screen_arena);
+    UNITY_END();
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,195 @@
+#include <unity.h>
+
+// Headless render benchmark, needs LVGL (and the project's lv_conf/config.hpp)
+// in the native environment
+#if __has_include(<lvgl.h>) && __has_include(<config.hpp>)
+
+#include <mb3/strip_chart.hpp>
+
+constexpr int32_t WIDTH = 320;
+constexpr int32_t HEIGHT = 120;
+constexpr uint32_t COLUMN_MS = 50;
+
+static lv_display_t * display;
+static uint8_t frame[WIDTH * HEIGHT * 2];
+static lv_area_t flushed;
+static uint32_t flushes;
+static int64_t now_us;
+
+static void flush(lv_display_t * display, const lv_area_t * area, uint8_t * pixels) {
+    if (flushes++ == 0)
+        flushed = *area;
+    else
+        lv_area_join(&flushed, &flushed, area);
+    lv_display_flush_ready(display);
+}
+
+static uint32_t tick() {
+    return esp_timer_get_time() / 1000;
+}
+
+static int64_t fake_clock() {
+    return now_us;
+}
+
+/// @brief Render one frame, returning the flushed width
+static int32_t render() {
+    flushes = 0;
+    lv_refr_now(display);
+    return flushes ? lv_area_get_width(&flushed) : 0;
+}
+
+static float signal_at(int i) {
+    return 3000.f + (2000.f * sinf(i * 0.05f)) + ((i % 37) == 0 ? 800.f : 0.f);
+}
+
+static StripChart<> * create_chart(StripMode mode, float * a, float * b) {
+    auto chart = new StripChart<>(lv_screen_active(), COLUMN_MS, mode);
+    lv_obj_set_style_pad_all(chart, 0, 0);
+    lv_obj_set_style_border_width(chart, 0, 0);
+    lv_obj_set_style_radius(chart, 0, 0);
+    lv_obj_set_size(chart, WIDTH, HEIGHT);
+    chart->addSeries(a, lv_color_hex(0xFF0000));
+    chart->addSeries(b, lv_color_hex(0x00FF00));
+    return chart;
+}
+
+void setUp(void) {
+    lv_init();
+    lv_tick_set_cb(tick);
+    display = lv_display_create(WIDTH, HEIGHT);
+    lv_display_set_color_format(display, LV_COLOR_FORMAT_RGB565);
+    lv_display_set_buffers(display, frame, nullptr, sizeof(frame), LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_set_flush_cb(display, flush);
+    now_us = 0;
+    StripChart<>::clock = fake_clock;
+}
+
+void tearDown(void) {
+    StripChart<>::clock = esp_timer_get_time;
+    lv_display_delete(display);
+    lv_deinit();
+}
+
+void test_sweep_invalidates_new_columns(void) {
+    float a = 10.f, b = 20.f;
+    auto chart = create_chart(StripMode::Sweep, &a, &b);
+    chart->setRange(0.f, 100.f).setSweepGap(4);
+    render();
+
+    for (int i = 0; i < 50; i++) {
+        a = 10.f + i;
+        now_us += COLUMN_MS * 1000;
+        chart->update();
+        // the new column and the gap ahead of it
+        TEST_ASSERT_LESS_OR_EQUAL(5, render());
+    }
+    lv_obj_delete(chart);
+}
+
+void test_redraws_on_range_change_only(void) {
+    float a = 10.f, b = 20.f;
+    auto chart = create_chart(StripMode::Scroll, &a, &b);
+    render();
+
+    // the first data sets the range
+    now_us += COLUMN_MS * 1000;
+    chart->update();
+    uint32_t redraws = chart->redrawCount();
+
+    for (int i = 0; i < 100; i++) {
+        a = 10.f + (i % 5);
+        now_us += COLUMN_MS * 1000;
+        chart->update();
+    }
+    TEST_ASSERT_EQUAL(redraws, chart->redrawCount());
+
+    // growing past the range redraws once
+    a = 500.f;
+    now_us += COLUMN_MS * 1000;
+    chart->update();
+    TEST_ASSERT_EQUAL(redraws + 1, chart->redrawCount());
+    TEST_ASSERT_TRUE(chart->rangeMax() >= 500.f);
+    lv_obj_delete(chart);
+}
+
+void test_render_benchmark(void) {
+    const int frames = 1000;
+    float a = 0.f, b = 0.f;
+
+    // lv_chart shifting its points: every point is re-drawn as a line each frame
+    lv_obj_t * naive = lv_chart_create(lv_screen_active());
+    lv_obj_set_size(naive, WIDTH, HEIGHT);
+    lv_chart_set_point_count(naive, WIDTH);
+    lv_chart_set_update_mode(naive, LV_CHART_UPDATE_MODE_SHIFT);
+    lv_chart_set_range(naive, LV_CHART_AXIS_PRIMARY_Y, 0, 6000);
+    lv_chart_series_t * naive_a = lv_chart_add_series(naive, lv_color_hex(0xFF0000), LV_CHART_AXIS_PRIMARY_Y);
+    lv_chart_series_t * naive_b = lv_chart_add_series(naive, lv_color_hex(0x00FF00), LV_CHART_AXIS_PRIMARY_Y);
+    render();
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < frames; i++) {
+        lv_chart_set_next_value(naive, naive_a, (int32_t)signal_at(i));
+        lv_chart_set_next_value(naive, naive_b, (int32_t)(6000.f - signal_at(i)));
+        render();
+    }
+    int64_t naive_us = esp_timer_get_time() - start;
+    lv_obj_delete(naive);
+
+    size_t memory = 0;
+    int64_t chart_us[2];
+    const StripMode modes[] = {StripMode::Scroll, StripMode::Sweep};
+    for (int m = 0; m < 2; m++) {
+        auto chart = create_chart(modes[m], &a, &b);
+        chart->setRange(0.f, 6000.f);
+        render();
+        start = esp_timer_get_time();
+        for (int i = 0; i < frames; i++) {
+            a = signal_at(i);
+            b = 6000.f - signal_at(i);
+            now_us += COLUMN_MS * 1000;
+            chart->update();
+            render();
+        }
+        chart_us[m] = esp_timer_get_time() - start;
+        memory = chart->memory();
+        lv_obj_delete(chart);
+    }
+
+    char message[192];
+    snprintf(message, sizeof(message), "%d frames: lv_chart %.1f us/frame, strip chart %.1f us/frame scrolling, %.1f us/frame sweeping (%u bytes)",
+        frames, naive_us / (double)frames, chart_us[0] / (double)frames, chart_us[1] / (double)frames, (unsigned)memory);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(chart_us[0] < naive_us);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sweep_invalidates_new_columns);
+    RUN_TEST(test_redraws_on_range_change_only);
+    RUN_TEST(test_render_benchmark);
+    UNITY_END();
+
+    return 0;
+}
+
+#else
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_render_benchmark(void) {
+    TEST_IGNORE_MESSAGE("LVGL isn't available in this environment");
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_render_benchmark);
+    UNITY_END();
+
+    return 0;
+}
+
+#endif
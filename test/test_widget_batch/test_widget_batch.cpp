@@ -0,0 +1,167 @@
+#include <unity.h>
+
+// Screen build benchmark, needs LVGL: env:native builds it with
+// test/native's lv_conf.h and config.hpp
+#if __has_include(<lvgl.h>) && __has_include(<config.hpp>)
+
+#include <stdio.h>
+#include <mb3/widget.hpp>
+
+constexpr int WIDGETS = 200;
+
+static lv_display_t * display;
+static uint8_t frame[320 * 40 * 2];
+static int created_events;
+
+class Tile : public Widget<Tile> {
+public:
+    Tile(lv_obj_t * parent, int i) : Widget(parent) {
+        lv_obj_set_size(this, 30, 20);
+        lv_obj_set_style_bg_color(this, lv_color_hex(0x101010 * (i % 15)), 0);
+        lv_obj_set_style_radius(this, 4, 0);
+    }
+};
+
+static void flush(lv_display_t * display, const lv_area_t * area, uint8_t * pixels) {
+    lv_display_flush_ready(display);
+}
+
+static uint32_t tick() {
+    return esp_timer_get_time() / 1000;
+}
+
+static void on_child_created(lv_event_t * e) {
+    created_events++;
+}
+
+/// @brief Build a flex screen of tiles and show it
+static int64_t load_screen(bool batched, lv_obj_t ** out) {
+    int64_t start = esp_timer_get_time();
+    lv_obj_t * screen = lv_obj_create(nullptr);
+    lv_obj_set_flex_flow(screen, LV_FLEX_FLOW_ROW_WRAP);
+    lv_obj_add_event_cb(screen, on_child_created, LV_EVENT_CHILD_CREATED, nullptr);
+    if (batched) {
+        WidgetBatch batch(screen, WIDGETS);
+        for (int i = 0; i < WIDGETS; i++) {
+            new Tile(screen, i);
+        }
+    }
+    else {
+        for (int i = 0; i < WIDGETS; i++) {
+            new Tile(screen, i);
+        }
+    }
+    lv_screen_load(screen);
+    lv_refr_now(display);
+    *out = screen;
+    return esp_timer_get_time() - start;
+}
+
+void setUp(void) {
+    lv_init();
+    lv_tick_set_cb(tick);
+    display = lv_display_create(320, 240);
+    lv_display_set_buffers(display, frame, nullptr, sizeof(frame), LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_set_flush_cb(display, flush);
+}
+
+void tearDown(void) {
+    lv_display_delete(display);
+    lv_deinit();
+}
+
+void test_same_screen(void) {
+    lv_obj_t * plain;
+    lv_obj_t * batched;
+    load_screen(false, &plain);
+    created_events = 0;
+    load_screen(true, &batched);
+    TEST_ASSERT_EQUAL(WIDGETS, created_events);
+    TEST_ASSERT_FALSE(WidgetBatch::active());
+    TEST_ASSERT_EQUAL(lv_obj_get_child_count(plain), lv_obj_get_child_count(batched));
+    for (int i = 0; i < WIDGETS; i += 17) {
+        lv_area_t a, b;
+        lv_obj_get_coords(lv_obj_get_child(plain, i), &a);
+        lv_obj_get_coords(lv_obj_get_child(batched, i), &b);
+        TEST_ASSERT_EQUAL_MEMORY(&a, &b, sizeof(a));
+        TEST_ASSERT_EQUAL(lv_obj_get_style_radius(lv_obj_get_child(plain, i), 0),
+            lv_obj_get_style_radius(lv_obj_get_child(batched, i), 0));
+    }
+    lv_obj_delete(plain);
+}
+
+void test_nested_and_grown(void) {
+    lv_obj_t * screen = lv_obj_create(nullptr);
+    lv_obj_t * panel = lv_obj_create(screen);
+    {
+        WidgetBatch outer(screen, 4);
+        for (int i = 0; i < 10; i++) {
+            new Tile(screen, i);
+        }
+        {
+            WidgetBatch inner(panel);
+            for (int i = 0; i < 20; i++) {
+                new Tile(panel, i);
+            }
+            TEST_ASSERT_TRUE(WidgetBatch::active());
+        }
+        TEST_ASSERT_TRUE(WidgetBatch::active());
+        // reserved once, then doubled
+        TEST_ASSERT_TRUE(WidgetBatch::reallocations() <= 6);
+    }
+    TEST_ASSERT_EQUAL(11, lv_obj_get_child_count(screen));
+    TEST_ASSERT_EQUAL(20, lv_obj_get_child_count(panel));
+    TEST_ASSERT_EQUAL_PTR(panel, lv_obj_get_child(screen, 0));
+    lv_obj_delete(screen);
+}
+
+void test_load_benchmark(void) {
+    const int rounds = 10;
+    int64_t plain_us = 0, batched_us = 0;
+    for (int r = 0; r < rounds; r++) {
+        lv_obj_t * screen;
+        plain_us += load_screen(false, &screen);
+        lv_screen_load(lv_obj_create(nullptr));
+        lv_obj_delete(screen);
+        batched_us += load_screen(true, &screen);
+        lv_screen_load(lv_obj_create(nullptr));
+        lv_obj_delete(screen);
+    }
+
+    char message[160];
+    snprintf(message, sizeof(message), "%d widgets: screen load %.1f us one by one, %.1f us batched",
+        WIDGETS, plain_us / (double)rounds, batched_us / (double)rounds);
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_same_screen);
+    RUN_TEST(test_nested_and_grown);
+    RUN_TEST(test_load_benchmark);
+    UNITY_END();
+
+    return 0;
+}
+
+#else
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_load_benchmark(void) {
+    TEST_IGNORE_MESSAGE("LVGL isn't available in this environment");
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_load_benchmark);
+    UNITY_END();
+
+    return 0;
+}
+
+#endif